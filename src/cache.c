@@ -0,0 +1,851 @@
+#include "qvmd.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+/*
+    The cache file is a flat image of the analysis: a header followed by
+    fixed size records for the opcodes, opblocks, functions and syscalls,
+    jumppoints, variables, function arrays and cross references. All pointers are stored as
+    record indexes (-1 for NULL) so the file can be mapped and relinked
+    without any parsing.
+*/
+
+typedef struct {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned long long  key;
+    unsigned int        instructions_count;
+    unsigned int        opblocks_count;
+    unsigned int        functions_count;
+    unsigned int        syscalls_count;
+    unsigned int        jumppoints_count;
+    unsigned int        globals_count;
+    unsigned int        locals_count;
+    unsigned int        refs_count;
+    unsigned int        xrefs_count;
+    int                 opblocks;
+    int                 syscalls;
+    int                 syscalls_table;
+    int                 jumppoints;
+    int                 globals;
+    int                 calls_total;
+    int                 calls_restored;
+    float               restored_calls_perc;
+} cache_header_t;
+
+typedef struct {
+    int                 info;
+    int                 value;
+    int                 global;
+} cache_opcode_t;
+
+typedef struct {
+    int                 info;
+    int                 opcode;
+    int                 prev;
+    int                 next;
+    int                 child;
+    int                 op1;
+    int                 op2;
+    int                 function;
+    int                 opcodes;
+    unsigned int        opcodes_count;
+    int                 function_called;
+    int                 jumppoint;
+    int                 variable;
+    int                 return_goto;
+    int                 function_arg;
+} cache_opblock_t;
+
+typedef struct {
+    unsigned int        address;
+    char                name[64];
+    unsigned int        stack_size;
+    unsigned int        return_size;
+    int                 opblock_start;
+    int                 opblock_end;
+    int                 locals;
+    int                 next;
+    int                 calls;
+    unsigned int        calls_count;
+    int                 called_by;
+    unsigned int        called_by_count;
+    int                 xrefs;
+    unsigned int        xrefs_count;
+    unsigned int        op_size;
+    unsigned int        opstack_depth;
+    unsigned int        locals_count;
+    unsigned int        args_count;
+    int                 variadic;
+} cache_function_t;
+
+typedef struct {
+    unsigned int        address;
+    char                name[32];
+    int                 parents_count;
+    int                 opblock;
+    int                 next;
+} cache_jumppoint_t;
+
+typedef struct {
+    char                name[64];
+    unsigned int        address;
+    unsigned int        prob_size[5];
+    unsigned int        size;
+    int                 content;
+    int                 next;
+    int                 parents;
+    unsigned int        parents_count;
+    int                 xrefs;
+    unsigned int        xrefs_count;
+    int                 status;
+    int                 type;
+    int                 variadic;
+    int                 cut;
+} cache_variable_t;
+
+typedef struct {
+    unsigned int        address;
+    int                 kind;
+    int                 function;
+} cache_xref_t;
+
+typedef struct {
+    qvm_t               *qvm;
+    qvm_cache_t         *cache;
+    cache_header_t      *header;
+    cache_opcode_t      *opcodes;
+    cache_opblock_t     *opblocks;
+    cache_function_t    *functions;
+    cache_jumppoint_t   *jumppoints;
+    cache_variable_t    *variables;
+    int                 *refs;
+    unsigned int        refs_count;
+    cache_xref_t        *xrefs;
+    unsigned int        xrefs_count;
+    char                error;
+} cache_image_t;
+
+unsigned long long          cache_get_key(qvm_t *qvm, char *map_filename, char *signatures_filename);
+static void                 cache_get_filename(char *filename, size_t size, char *dirname, unsigned long long key);
+static size_t               cache_image_size(cache_header_t *header);
+static void                 cache_image_set(cache_image_t *image, char *content);
+int                         cache_load(qvm_t *qvm, char *dirname, unsigned long long key);
+static int                  cache_load_image(cache_image_t *image);
+static void                 cache_load_reset(qvm_t *qvm);
+static void                 cache_load_function(cache_image_t *image, qvm_function_t *func, cache_function_t *rec);
+static qvm_opblock_t        *cache_load_opblock_ref(cache_image_t *image, int id);
+static qvm_function_t       *cache_load_function_ref(cache_image_t *image, int id);
+static qvm_jumppoint_t      *cache_load_jumppoint_ref(cache_image_t *image, int id);
+static qvm_variable_t       *cache_load_variable_ref(cache_image_t *image, int id);
+static void                 cache_load_array(cache_image_t *image, qvm_function_array_t *array, int start, unsigned int count);
+static void                 cache_load_xrefs(cache_image_t *image, qvm_xref_array_t *array, int start, unsigned int count);
+int                         cache_save(qvm_t *qvm, char *dirname, unsigned long long key);
+static void                 cache_save_image(cache_image_t *image);
+static void                 cache_save_opblock(qvm_t *qvm, cache_opblock_t *rec, qvm_opblock_t *opb);
+static void                 cache_save_function(cache_image_t *image, cache_function_t *rec, qvm_function_t *func);
+static void                 cache_save_variables(cache_image_t *image, qvm_variable_t *var);
+static int                  cache_save_opblock_ref(qvm_t *qvm, qvm_opblock_t *opb);
+static int                  cache_save_array(cache_image_t *image, qvm_function_array_t *array, unsigned int *count);
+static int                  cache_save_xrefs(cache_image_t *image, qvm_xref_array_t *array, unsigned int *count);
+void                        cache_free(qvm_cache_t *cache);
+
+unsigned long long cache_get_key(qvm_t *qvm, char *map_filename, char *signatures_filename)
+{
+    unsigned long long  key = HASH_INIT;
+    file_t              *map;
+    file_t              *signatures;
+
+    // hash the qvmd version
+    key = hash_str(key, QVMD_VERSION);
+
+    // hash the qvm content
+    key = hash_data(key, qvm->file->content, qvm->file->size);
+
+    // hash the map content if any
+    if (map_filename && (map = file_read(map_filename))) {
+        key = hash_data(key, map->content, map->size);
+        file_free(map);
+    }
+
+    // hash the signatures database if any, it names the functions
+    if (signatures_filename && (signatures = file_map(signatures_filename))) {
+        key = hash_data(key, signatures->content, signatures->size);
+        file_free(signatures);
+    }
+
+    // return the cache key
+    return key;
+}
+
+static void cache_get_filename(char *filename, size_t size, char *dirname, unsigned long long key)
+{
+    snprintf(filename, size, "%s/%016llx.qvmc", dirname, key);
+}
+
+static size_t cache_image_size(cache_header_t *header)
+{
+    // get the size of all the records
+    return sizeof(cache_header_t) +
+        sizeof(cache_opcode_t) * (size_t)header->instructions_count +
+        sizeof(cache_opblock_t) * (size_t)header->opblocks_count +
+        sizeof(cache_function_t) * ((size_t)header->functions_count + header->syscalls_count) +
+        sizeof(cache_jumppoint_t) * (size_t)header->jumppoints_count +
+        sizeof(cache_variable_t) * ((size_t)header->globals_count + header->locals_count) +
+        sizeof(int) * (size_t)header->refs_count +
+        sizeof(cache_xref_t) * (size_t)header->xrefs_count;
+}
+
+static void cache_image_set(cache_image_t *image, char *content)
+{
+    // set each records array from the image content
+    image->header = (cache_header_t *)content;
+    image->opcodes = (cache_opcode_t *)(image->header + 1);
+    image->opblocks = (cache_opblock_t *)(image->opcodes + image->header->instructions_count);
+    image->functions = (cache_function_t *)(image->opblocks + image->header->opblocks_count);
+    image->jumppoints = (cache_jumppoint_t *)(image->functions + image->header->functions_count + image->header->syscalls_count);
+    image->variables = (cache_variable_t *)(image->jumppoints + image->header->jumppoints_count);
+    image->refs = (int *)(image->variables + image->header->globals_count + image->header->locals_count);
+    image->xrefs = (cache_xref_t *)(image->refs + image->header->refs_count);
+}
+
+int cache_load(qvm_t *qvm, char *dirname, unsigned long long key)
+{
+    char            filename[PATH_MAX];
+    file_t          *file;
+    cache_header_t  *header;
+    cache_image_t   image;
+
+    printf("Loading cache...");
+
+    // map the cache file
+    cache_get_filename(filename, sizeof(filename), dirname, key);
+    if (!(file = file_map(filename))) {
+        printf("Not found.\n");
+        return 0;
+    }
+
+    // check the cache header
+    header = (cache_header_t *)file->content;
+    if (file->size < sizeof(*header) ||
+        header->magic != CACHE_MAGIC ||
+        header->version != CACHE_VERSION ||
+        header->key != key ||
+        header->instructions_count != qvm->header->instructions_count ||
+        header->opblocks_count != header->instructions_count + header->jumppoints_count ||
+        (header->syscalls_table != -1 && !syscalls_table_get(header->syscalls_table)) ||
+        file->size != cache_image_size(header)) {
+        printf("Warning: %s: Invalid cache file.\n", filename);
+        file_free(file);
+        return 0;
+    }
+
+    // set the image records
+    image.qvm = qvm;
+    image.error = 0;
+    cache_image_set(&image, file->content);
+
+    // relink the analysis from the image
+    if (!cache_load_image(&image)) {
+        printf("Warning: %s: Corrupted cache file.\n", filename);
+        cache_load_reset(qvm);
+        file_free(file);
+        return 0;
+    }
+
+    // free the mapped file
+    file_free(file);
+
+    printf("Success: %i functions and %i variables loaded.\n", qvm->functions_count, qvm->globals_count + qvm->locals_count);
+
+    // success
+    return 1;
+}
+
+static int cache_load_image(cache_image_t *image)
+{
+    qvm_t               *qvm = image->qvm;
+    cache_header_t      *header = image->header;
+    qvm_cache_t         *cache;
+    qvm_opblock_t       *opb;
+    qvm_variable_t      *var;
+    qvm_jumppoint_t     *jmp;
+
+    // allocate the cache storage
+    if (!(qvm->cache = cache = calloc(1, sizeof(*cache))) ||
+        !(cache->opblocks = malloc(sizeof(*cache->opblocks) * (header->opblocks_count + 1))) ||
+        !(cache->syscalls = malloc(sizeof(*cache->syscalls) * (header->syscalls_count + 1))) ||
+        !(cache->jumppoints = malloc(sizeof(*cache->jumppoints) * (header->jumppoints_count + 1))) ||
+        !(cache->variables = malloc(sizeof(*cache->variables) * (header->globals_count + header->locals_count + 1))) ||
+        !(cache->adjacency = malloc(sizeof(*cache->adjacency) * (header->refs_count + 1))) ||
+        !(cache->xrefs = malloc(sizeof(*cache->xrefs) * (header->xrefs_count + 1))) ||
+        !(qvm->opcodes = malloc(sizeof(*qvm->opcodes) * (header->instructions_count + 1))) ||
+        !(qvm->functions = malloc(sizeof(*qvm->functions) * (header->functions_count + 1)))) {
+        printf("Error: Couldn't allocate the cached analysis.\n");
+        return 0;
+    }
+    image->cache = cache;
+    image->refs_count = 0;
+    image->xrefs_count = 0;
+
+    // set the qvm counts
+    qvm->functions_count = header->functions_count;
+    qvm->syscalls_count = header->syscalls_count;
+    qvm->syscalls_table = syscalls_table_get(header->syscalls_table);
+    qvm->jumppoints_count = header->jumppoints_count;
+    qvm->globals_count = header->globals_count;
+    qvm->locals_count = header->locals_count;
+    qvm->calls_total = header->calls_total;
+    qvm->calls_restored = header->calls_restored;
+    qvm->restored_calls_perc = header->restored_calls_perc;
+
+    // load the opcodes
+    for (unsigned int i = 0; i < header->instructions_count; i++) {
+        if (image->opcodes[i].info < 0 || image->opcodes[i].info >= OP_MAX)
+            return 0;
+        qvm->opcodes[i].qvm = qvm;
+        qvm->opcodes[i].address = i;
+        qvm->opcodes[i].info = &qvm_opcodes_info[image->opcodes[i].info];
+        qvm->opcodes[i].value = image->opcodes[i].value;
+        qvm->opcodes[i].global = (char)image->opcodes[i].global;
+        qvm->opcodes[i].opblock = &cache->opblocks[i];
+    }
+
+    // load the opblocks
+    for (unsigned int i = 0; i < header->opblocks_count; i++) {
+        cache_opblock_t *rec = &image->opblocks[i];
+
+        opb = &cache->opblocks[i];
+        if (rec->info < 0 || rec->info >= OPB_MAX)
+            return 0;
+        opb->qvm = qvm;
+        opb->info = &qvm_opblocks_info[rec->info];
+        opb->opcode = NULL;
+        opb->opcodes = NULL;
+        opb->opcodes_count = rec->opcodes_count;
+        if (rec->opcode != -1) {
+            if (rec->opcode < 0 || (unsigned int)rec->opcode >= header->instructions_count)
+                return 0;
+            opb->opcode = &qvm->opcodes[rec->opcode];
+        }
+        if (rec->opcodes != -1) {
+            if (rec->opcodes < 0 || (unsigned int)rec->opcodes + rec->opcodes_count > header->instructions_count)
+                return 0;
+            opb->opcodes = &qvm->opcodes[rec->opcodes];
+        }
+        opb->prev = cache_load_opblock_ref(image, rec->prev);
+        opb->next = cache_load_opblock_ref(image, rec->next);
+        opb->child = cache_load_opblock_ref(image, rec->child);
+        opb->op1 = cache_load_opblock_ref(image, rec->op1);
+        opb->op2 = cache_load_opblock_ref(image, rec->op2);
+        opb->function = cache_load_function_ref(image, rec->function);
+        opb->function_called = cache_load_function_ref(image, rec->function_called);
+        opb->jumppoint = cache_load_jumppoint_ref(image, rec->jumppoint);
+        opb->variable = cache_load_variable_ref(image, rec->variable);
+        opb->return_goto = cache_load_opblock_ref(image, rec->return_goto);
+        opb->function_arg = cache_load_opblock_ref(image, rec->function_arg);
+    }
+
+    // load the functions and the syscalls
+    for (unsigned int i = 0; i < header->functions_count; i++)
+        cache_load_function(image, &qvm->functions[i], &image->functions[i]);
+    for (unsigned int i = 0; i < header->syscalls_count; i++)
+        cache_load_function(image, &cache->syscalls[i], &image->functions[header->functions_count + i]);
+
+    // load the jumppoints
+    for (unsigned int i = 0; i < header->jumppoints_count; i++) {
+        cache_jumppoint_t   *rec = &image->jumppoints[i];
+
+        jmp = &cache->jumppoints[i];
+        jmp->id = i;
+        jmp->address = rec->address;
+        memcpy(jmp->name, rec->name, sizeof(jmp->name));
+        jmp->name[sizeof(jmp->name) - 1] = 0;
+        jmp->parents_count = rec->parents_count;
+        jmp->opblock = cache_load_opblock_ref(image, rec->opblock);
+        jmp->next = cache_load_jumppoint_ref(image, rec->next);
+    }
+
+    // load the variables
+    for (unsigned int i = 0; i < header->globals_count + header->locals_count; i++) {
+        cache_variable_t    *rec = &image->variables[i];
+
+        var = &cache->variables[i];
+        if (rec->status < 0 || rec->status >= VS_MAX || rec->type < -1 || rec->type >= T_MAX ||
+            rec->content < -1 || rec->content > (int)(qvm->sections[S_DATA].length + qvm->sections[S_LIT].length))
+            return 0;
+        var->id = i;
+        memcpy(var->name, rec->name, sizeof(var->name));
+        var->name[sizeof(var->name) - 1] = 0;
+        var->address = rec->address;
+        memcpy(var->prob_size, rec->prob_size, sizeof(var->prob_size));
+        var->size = rec->size;
+        var->content = rec->content != -1 ? qvm->sections[S_DATA].content + rec->content : NULL;
+        var->next = cache_load_variable_ref(image, rec->next);
+        cache_load_array(image, &var->parents, rec->parents, rec->parents_count);
+        cache_load_xrefs(image, &var->xrefs, rec->xrefs, rec->xrefs_count);
+        var->status = rec->status;
+        var->type = rec->type != -1 ? &qvm_types[rec->type] : NULL;
+        var->variadic = rec->variadic;
+        var->cut = rec->cut;
+    }
+
+    // load the lists heads
+    qvm->opblocks = cache_load_opblock_ref(image, header->opblocks);
+    qvm->syscalls = cache_load_function_ref(image, header->syscalls);
+    qvm->jumppoints = cache_load_jumppoint_ref(image, header->jumppoints);
+    qvm->globals = cache_load_variable_ref(image, header->globals);
+
+    // check for invalid references
+    return !image->error;
+}
+
+static void cache_load_reset(qvm_t *qvm)
+{
+    // free the partially loaded analysis
+    cache_free(qvm->cache);
+    free(qvm->opcodes);
+    free(qvm->functions);
+
+    // reset the qvm analysis
+    qvm->cache = NULL;
+    qvm->opcodes = NULL;
+    qvm->functions = NULL;
+    qvm->functions_count = 0;
+    qvm->syscalls = NULL;
+    qvm->syscalls_count = 0;
+    qvm->syscalls_table = NULL;
+    qvm->jumppoints = NULL;
+    qvm->jumppoints_count = 0;
+    qvm->opblocks = NULL;
+    qvm->globals = NULL;
+    qvm->globals_count = 0;
+    qvm->locals_count = 0;
+}
+
+static void cache_load_function(cache_image_t *image, qvm_function_t *func, cache_function_t *rec)
+{
+    // initialize the function
+    func_init(func);
+
+    // set the function infos
+    func->qvm = image->qvm;
+    func->id = rec - image->functions;
+    func->address = rec->address;
+    memcpy(func->name, rec->name, sizeof(func->name));
+    func->name[sizeof(func->name) - 1] = 0;
+    func->stack_size = rec->stack_size;
+    func->return_size = rec->return_size;
+    func->opblock_start = cache_load_opblock_ref(image, rec->opblock_start);
+    func->opblock_end = cache_load_opblock_ref(image, rec->opblock_end);
+    func->locals = cache_load_variable_ref(image, rec->locals);
+    func->next = cache_load_function_ref(image, rec->next);
+    cache_load_array(image, &func->calls, rec->calls, rec->calls_count);
+    cache_load_array(image, &func->called_by, rec->called_by, rec->called_by_count);
+    cache_load_xrefs(image, &func->xrefs, rec->xrefs, rec->xrefs_count);
+    func->op_size = rec->op_size;
+    func->opstack_depth = rec->opstack_depth;
+    func->locals_count = rec->locals_count;
+    func->args_count = rec->args_count;
+    func->variadic = rec->variadic;
+}
+
+static qvm_opblock_t *cache_load_opblock_ref(cache_image_t *image, int id)
+{
+    // check for a null reference
+    if (id == -1)
+        return NULL;
+
+    // check for an invalid reference
+    if (id < 0 || (unsigned int)id >= image->header->opblocks_count) {
+        image->error = 1;
+        return NULL;
+    }
+
+    // return the opblock
+    return &image->cache->opblocks[id];
+}
+
+static qvm_function_t *cache_load_function_ref(cache_image_t *image, int id)
+{
+    // check for a null reference
+    if (id == -1)
+        return NULL;
+
+    // check for an invalid reference
+    if (id < 0 || (unsigned int)id >= image->header->functions_count + image->header->syscalls_count) {
+        image->error = 1;
+        return NULL;
+    }
+
+    // return the function or the syscall
+    if ((unsigned int)id < image->header->functions_count)
+        return &image->qvm->functions[id];
+    return &image->cache->syscalls[id - image->header->functions_count];
+}
+
+static qvm_jumppoint_t *cache_load_jumppoint_ref(cache_image_t *image, int id)
+{
+    // check for a null reference
+    if (id == -1)
+        return NULL;
+
+    // check for an invalid reference
+    if (id < 0 || (unsigned int)id >= image->header->jumppoints_count) {
+        image->error = 1;
+        return NULL;
+    }
+
+    // return the jumppoint
+    return &image->cache->jumppoints[id];
+}
+
+static qvm_variable_t *cache_load_variable_ref(cache_image_t *image, int id)
+{
+    // check for a null reference
+    if (id == -1)
+        return NULL;
+
+    // check for an invalid reference
+    if (id < 0 || (unsigned int)id >= image->header->globals_count + image->header->locals_count) {
+        image->error = 1;
+        return NULL;
+    }
+
+    // return the variable
+    return &image->cache->variables[id];
+}
+
+static void cache_load_array(cache_image_t *image, qvm_function_array_t *array, int start, unsigned int count)
+{
+    // check for an empty array
+    array->functions = NULL;
+    array->count = 0;
+    if (!count)
+        return;
+
+    // check for an invalid array
+    if (start < 0 || (unsigned int)start + count > image->header->refs_count ||
+        image->refs_count + count > image->header->refs_count) {
+        image->error = 1;
+        return;
+    }
+
+    // load the array functions in order
+    array->functions = &image->cache->adjacency[image->refs_count];
+    array->count = count;
+    for (unsigned int i = 0; i < count; i++)
+        array->functions[i] = cache_load_function_ref(image, image->refs[start + i]);
+    image->refs_count += count;
+}
+
+static void cache_load_xrefs(cache_image_t *image, qvm_xref_array_t *array, int start, unsigned int count)
+{
+    cache_xref_t    *rec;
+    qvm_xref_t      *xref;
+
+    // check for an empty array
+    array->xrefs = NULL;
+    array->count = 0;
+    if (!count)
+        return;
+
+    // check for an invalid array
+    if (start < 0 || (unsigned int)start + count > image->header->xrefs_count ||
+        image->xrefs_count + count > image->header->xrefs_count) {
+        image->error = 1;
+        return;
+    }
+
+    // load the array references in order
+    array->xrefs = &image->cache->xrefs[image->xrefs_count];
+    array->count = count;
+    for (unsigned int i = 0; i < count; i++) {
+        rec = &image->xrefs[start + i];
+        xref = &array->xrefs[i];
+        if (rec->kind < 0 || rec->kind >= XREF_MAX || rec->address >= image->header->instructions_count) {
+            image->error = 1;
+            return;
+        }
+        xref->address = rec->address;
+        xref->kind = rec->kind;
+        xref->function = cache_load_function_ref(image, rec->function);
+    }
+    image->xrefs_count += count;
+}
+
+int cache_save(qvm_t *qvm, char *dirname, unsigned long long key)
+{
+    char            filename[PATH_MAX];
+    char            tmp_filename[PATH_MAX + 16];
+    cache_header_t  header;
+    cache_image_t   image;
+    qvm_function_t  *func;
+    qvm_variable_t  *var;
+    char            *content;
+    file_t          *file;
+    size_t          size;
+    int             success;
+
+    printf("Saving cache...");
+
+    // count the function arrays elements and the cross references
+    header.refs_count = 0;
+    header.xrefs_count = 0;
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        func = &qvm->functions[i];
+        header.refs_count += func->calls.count + func->called_by.count;
+        header.xrefs_count += func->xrefs.count;
+        for (var = func->locals; var; var = var->next) {
+            header.refs_count += var->parents.count;
+            header.xrefs_count += var->xrefs.count;
+        }
+    }
+    for (func = qvm->syscalls; func; func = func->next) {
+        header.refs_count += func->calls.count + func->called_by.count;
+        header.xrefs_count += func->xrefs.count;
+    }
+    for (var = qvm->globals; var; var = var->next) {
+        header.refs_count += var->parents.count;
+        header.xrefs_count += var->xrefs.count;
+    }
+
+    // set the cache header
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.instructions_count = qvm->header->instructions_count;
+    header.opblocks_count = qvm->header->instructions_count + qvm->jumppoints_count;
+    header.functions_count = qvm->functions_count;
+    header.syscalls_count = qvm->syscalls_count;
+    header.jumppoints_count = qvm->jumppoints_count;
+    header.globals_count = qvm->globals_count;
+    header.locals_count = qvm->locals_count;
+    header.opblocks = cache_save_opblock_ref(qvm, qvm->opblocks);
+    header.syscalls = qvm->syscalls ? (int)qvm->syscalls->id : -1;
+    header.syscalls_table = syscalls_table_id(qvm->syscalls_table);
+    header.jumppoints = qvm->jumppoints ? (int)qvm->jumppoints->id : -1;
+    header.globals = qvm->globals ? (int)qvm->globals->id : -1;
+    header.calls_total = qvm->calls_total;
+    header.calls_restored = qvm->calls_restored;
+    header.restored_calls_perc = qvm->restored_calls_perc;
+
+    // allocate the cache image
+    size = cache_image_size(&header);
+    if (!(content = calloc(1, size))) {
+        printf("Warning: Couldn't allocate the cache image.\n");
+        return 0;
+    }
+
+    // fill the cache image
+    memcpy(content, &header, sizeof(header));
+    image.qvm = qvm;
+    image.refs_count = 0;
+    image.xrefs_count = 0;
+    cache_image_set(&image, content);
+    cache_save_image(&image);
+
+    // create the cache directory if needed
+    if (mkdir(dirname, 0755) == -1 && errno != EEXIST) {
+        printf("Warning: Couldn't create cache directory %s.\n", dirname);
+        free(content);
+        return 0;
+    }
+
+    // write the image in a temporary file
+    cache_get_filename(filename, sizeof(filename), dirname, key);
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%i", filename, (int)getpid());
+    if (!(file = file_create(tmp_filename))) {
+        printf("Warning: Couldn't create cache file %s.\n", tmp_filename);
+        free(content);
+        return 0;
+    }
+    success = file_write(file, content, size);
+    file_free(file);
+    free(content);
+
+    // replace the cache file atomically
+    if (!success || rename(tmp_filename, filename) == -1) {
+        printf("Warning: Couldn't write cache file %s.\n", filename);
+        unlink(tmp_filename);
+        return 0;
+    }
+
+    printf("Success.\n");
+
+    // success
+    return 1;
+}
+
+static void cache_save_image(cache_image_t *image)
+{
+    qvm_t               *qvm = image->qvm;
+    qvm_function_t      *func;
+    qvm_jumppoint_t     *jmp;
+
+    // save the opcodes and their opblocks
+    for (unsigned int i = 0; i < qvm->header->instructions_count; i++) {
+        image->opcodes[i].info = qvm->opcodes[i].info->id;
+        image->opcodes[i].value = qvm->opcodes[i].value;
+        image->opcodes[i].global = qvm->opcodes[i].global;
+        cache_save_opblock(qvm, &image->opblocks[i], qvm->opcodes[i].opblock);
+    }
+
+    // save the jumppoints opblocks after the opcodes ones
+    for (jmp = qvm->jumppoints; jmp; jmp = jmp->next)
+        cache_save_opblock(qvm, &image->opblocks[qvm->header->instructions_count + jmp->id], jmp->opblock);
+
+    // save the functions and the syscalls
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        cache_save_function(image, &image->functions[i], &qvm->functions[i]);
+        cache_save_variables(image, qvm->functions[i].locals);
+    }
+    for (func = qvm->syscalls; func; func = func->next)
+        cache_save_function(image, &image->functions[func->id], func);
+
+    // save the jumppoints
+    for (jmp = qvm->jumppoints; jmp; jmp = jmp->next) {
+        cache_jumppoint_t   *rec = &image->jumppoints[jmp->id];
+
+        rec->address = jmp->address;
+        snprintf(rec->name, sizeof(rec->name), "%s", jmp->name);
+        rec->parents_count = jmp->parents_count;
+        rec->opblock = cache_save_opblock_ref(qvm, jmp->opblock);
+        rec->next = jmp->next ? (int)jmp->next->id : -1;
+    }
+
+    // save the globals
+    cache_save_variables(image, qvm->globals);
+}
+
+static void cache_save_opblock(qvm_t *qvm, cache_opblock_t *rec, qvm_opblock_t *opb)
+{
+    // save an empty record for a missing opblock
+    if (!opb) {
+        rec->info = OPB_UNDEF;
+        rec->opcode = rec->prev = rec->next = rec->child = rec->op1 = rec->op2 = -1;
+        rec->function = rec->opcodes = rec->function_called = rec->jumppoint = -1;
+        rec->variable = rec->return_goto = rec->function_arg = -1;
+        return;
+    }
+
+    // save the opblock record
+    rec->info = opb->info->id;
+    rec->opcode = opb->opcode ? (int)opb->opcode->address : -1;
+    rec->prev = cache_save_opblock_ref(qvm, opb->prev);
+    rec->next = cache_save_opblock_ref(qvm, opb->next);
+    rec->child = cache_save_opblock_ref(qvm, opb->child);
+    rec->op1 = cache_save_opblock_ref(qvm, opb->op1);
+    rec->op2 = cache_save_opblock_ref(qvm, opb->op2);
+    rec->function = opb->function ? (int)opb->function->id : -1;
+    rec->opcodes = opb->opcodes ? (int)opb->opcodes->address : -1;
+    rec->opcodes_count = opb->opcodes_count;
+    rec->function_called = opb->function_called ? (int)opb->function_called->id : -1;
+    rec->jumppoint = opb->jumppoint ? (int)opb->jumppoint->id : -1;
+    rec->variable = opb->variable ? (int)opb->variable->id : -1;
+    rec->return_goto = cache_save_opblock_ref(qvm, opb->return_goto);
+    rec->function_arg = cache_save_opblock_ref(qvm, opb->function_arg);
+}
+
+static void cache_save_function(cache_image_t *image, cache_function_t *rec, qvm_function_t *func)
+{
+    rec->address = func->address;
+    snprintf(rec->name, sizeof(rec->name), "%s", func->name);
+    rec->stack_size = func->stack_size;
+    rec->return_size = func->return_size;
+    rec->opblock_start = cache_save_opblock_ref(func->qvm, func->opblock_start);
+    rec->opblock_end = cache_save_opblock_ref(func->qvm, func->opblock_end);
+    rec->locals = func->locals ? (int)func->locals->id : -1;
+    rec->next = func->next ? (int)func->next->id : -1;
+    rec->calls = cache_save_array(image, &func->calls, &rec->calls_count);
+    rec->called_by = cache_save_array(image, &func->called_by, &rec->called_by_count);
+    rec->xrefs = cache_save_xrefs(image, &func->xrefs, &rec->xrefs_count);
+    rec->op_size = func->op_size;
+    rec->opstack_depth = func->opstack_depth;
+    rec->locals_count = func->locals_count;
+    rec->args_count = func->args_count;
+    rec->variadic = func->variadic;
+}
+
+static void cache_save_variables(cache_image_t *image, qvm_variable_t *var)
+{
+    cache_variable_t    *rec;
+
+    // save all the variables of the list
+    for (; var; var = var->next) {
+        rec = &image->variables[var->id];
+        snprintf(rec->name, sizeof(rec->name), "%s", var->name);
+        rec->address = var->address;
+        rec->prob_size[1] = var->prob_size[1];
+        rec->prob_size[2] = var->prob_size[2];
+        rec->prob_size[4] = var->prob_size[4];
+        rec->size = var->size;
+        rec->content = var->content ? (int)(var->content - image->qvm->sections[S_DATA].content) : -1;
+        rec->next = var->next ? (int)var->next->id : -1;
+        rec->parents = cache_save_array(image, &var->parents, &rec->parents_count);
+        rec->xrefs = cache_save_xrefs(image, &var->xrefs, &rec->xrefs_count);
+        rec->status = var->status;
+        rec->type = var->type ? var->type->id : -1;
+        rec->variadic = var->variadic;
+        rec->cut = var->cut;
+    }
+}
+
+static int cache_save_opblock_ref(qvm_t *qvm, qvm_opblock_t *opb)
+{
+    // check for a null reference
+    if (!opb)
+        return -1;
+
+    // opcode opblocks are stored at their address
+    if (opb->opcode)
+        return opb->opcode->address;
+
+    // jumppoint opblocks are stored after all the opcodes
+    return qvm->header->instructions_count + opb->jumppoint->id;
+}
+
+static int cache_save_array(cache_image_t *image, qvm_function_array_t *array, unsigned int *count)
+{
+    int     start = image->refs_count;
+
+    // save the array functions in order
+    for (*count = 0; *count < array->count; (*count)++)
+        image->refs[image->refs_count++] = array->functions[*count]->id;
+
+    // return the first element index
+    return start;
+}
+
+static int cache_save_xrefs(cache_image_t *image, qvm_xref_array_t *array, unsigned int *count)
+{
+    int             start = image->xrefs_count;
+    cache_xref_t    *rec;
+
+    // save the array references in order
+    for (*count = 0; *count < array->count; (*count)++) {
+        rec = &image->xrefs[image->xrefs_count++];
+        rec->address = array->xrefs[*count].address;
+        rec->kind = array->xrefs[*count].kind;
+        rec->function = array->xrefs[*count].function ? (int)array->xrefs[*count].function->id : -1;
+    }
+
+    // return the first element index
+    return start;
+}
+
+void cache_free(qvm_cache_t *cache)
+{
+    // check the cache
+    if (!cache)
+        return;
+
+    // free all the cache storage
+    free(cache->opblocks);
+    free(cache->syscalls);
+    free(cache->jumppoints);
+    free(cache->variables);
+    free(cache->adjacency);
+    free(cache->xrefs);
+    free(cache);
+}
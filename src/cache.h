@@ -0,0 +1,23 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#define CACHE_MAGIC     0x434d5651
+#define CACHE_VERSION   8
+
+typedef struct qvm_cache_s  qvm_cache_t;
+
+typedef struct qvm_cache_s {
+    qvm_opblock_t       *opblocks;
+    qvm_function_t      *syscalls;
+    qvm_jumppoint_t     *jumppoints;
+    qvm_variable_t      *variables;
+    qvm_function_t      **adjacency;
+    qvm_xref_t          *xrefs;
+} qvm_cache_t;
+
+unsigned long long  cache_get_key(qvm_t *qvm, char *map_filename, char *signatures_filename);
+int                 cache_load(qvm_t *qvm, char *dirname, unsigned long long key);
+int                 cache_save(qvm_t *qvm, char *dirname, unsigned long long key);
+void                cache_free(qvm_cache_t *cache);
+
+#endif
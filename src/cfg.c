@@ -0,0 +1,615 @@
+#include "qvmd.h"
+
+#define CFG_TABLE_CHECKS    16
+
+/*
+    The control flow graph of a function is built from its opcodes in a
+    single scan. The leaders are the first opcode, the targets of the
+    compares and constant jumps, and the opcodes following a compare, a
+    jump or a return. The blocks and their successors and predecessors
+    are stored in contiguous arrays, each block pointing to its range of
+    block indexes. A jump without a constant target is marked as indirect.
+    When it loads its target from a switch jump table of the data section,
+    found from the index bounds checked just before, the table entries are
+    leaders and its successors. Otherwise it may go to any leader that no
+    other block reaches, like the verifier assumes.
+
+    The dominators are computed with the Cooper, Harvey and Kennedy
+    iterative algorithm over the reverse post order of the blocks. A back
+    edge goes to a block dominating its source, and the natural loop of a
+    header gathers the blocks reaching its back edges. The headers are
+    browsed in reverse post order so the outer loops are found before the
+    loops they contain, which gives the nesting in the same pass.
+*/
+
+int                 cfg_load(qvm_cfg_t *cfg, qvm_function_t *func);
+static unsigned int cfg_load_table(qvm_cfg_t *cfg, unsigned int address, unsigned int **table);
+static void         cfg_load_succs(qvm_cfg_t *cfg, qvm_cfg_block_t *block, char *reached);
+static void         cfg_load_preds(qvm_cfg_t *cfg);
+int                 cfg_load_dominators(qvm_cfg_t *cfg);
+static unsigned int cfg_intersect(qvm_cfg_t *cfg, unsigned int *ranks, unsigned int a, unsigned int b);
+int                 cfg_load_loops(qvm_cfg_t *cfg);
+static int          cfg_load_loops_block(qvm_cfg_t *cfg, unsigned int block, unsigned int *size);
+unsigned int        cfg_find(qvm_cfg_t *cfg, unsigned int address);
+int                 cfg_dominates(qvm_cfg_t *cfg, unsigned int dom, unsigned int block);
+unsigned int        cfg_depth(qvm_cfg_t *cfg, unsigned int block);
+unsigned long long  cfg_shape(qvm_cfg_t *cfg);
+void                cfg_free(qvm_cfg_t *cfg);
+
+int cfg_load(qvm_cfg_t *cfg, qvm_function_t *func)
+{
+    qvm_opcode_t    *opcodes = &func->qvm->opcodes[func->address];
+    qvm_opcode_t    *op;
+    unsigned int    *table;
+    unsigned int    size = func->op_size;
+    unsigned int    count = 0;
+    unsigned int    tables_count = 0;
+    unsigned int    unknown_count = 0;
+    unsigned int    entries_count;
+    unsigned int    edges_size;
+    char            *reached;
+
+    // initialize the graph
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->function = func;
+
+    // allocate the block index of each opcode, used first to mark the leaders, and the opcodes reached by a branch
+    cfg->index = calloc(size + 1, sizeof(*cfg->index));
+    reached = calloc(size + 1, sizeof(*reached));
+    if (!cfg->index || !reached) {
+        printf("Error: Couldn't allocate control flow graph of %s.\n", func->name);
+        free(cfg->index);
+        free(reached);
+        cfg->index = NULL;
+        return 0;
+    }
+
+    // mark the leaders
+    if (size)
+        cfg->index[0] = 1;
+    for (unsigned int i = 0; i < size; i++) {
+        op = &opcodes[i];
+
+        // a compare starts a block at its target and after it
+        if (op->info->opblock_id == OPB_COMPARE) {
+            if ((unsigned int)op->value >= func->address && (unsigned int)op->value < func->address + size)
+                cfg->index[op->value - func->address] = reached[op->value - func->address] = 1;
+            cfg->index[i + 1] = 1;
+        }
+
+        // a jump starts a block at its constant target or at its jump table targets, and after it
+        else if (op->info->id == OP_JUMP) {
+            if (i && opcodes[i - 1].info->id == OP_CONST && (unsigned int)opcodes[i - 1].value >= func->address && (unsigned int)opcodes[i - 1].value < func->address + size)
+                cfg->index[opcodes[i - 1].value - func->address] = reached[opcodes[i - 1].value - func->address] = 1;
+            else if ((entries_count = cfg_load_table(cfg, func->address + i, &table))) {
+                for (unsigned int j = 0; j < entries_count; j++)
+                    cfg->index[table[j] - func->address] = reached[table[j] - func->address] = 1;
+                tables_count += entries_count;
+            }
+            else
+                unknown_count++;
+            cfg->index[i + 1] = 1;
+        }
+
+        // a return starts a block after it
+        else if (op->info->id == OP_LEAVE)
+            cfg->index[i + 1] = 1;
+    }
+
+    // number the blocks of the opcodes
+    for (unsigned int i = 0; i < size; i++) {
+        if (cfg->index[i])
+            count++;
+        cfg->index[i] = count - 1;
+    }
+
+    // allocate the blocks and the edges, a block has 2 successors at most but the indirect jumps
+    edges_size = count * 2 + tables_count + unknown_count * count;
+    if (!(cfg->blocks = calloc(count + 1, sizeof(*cfg->blocks))) ||
+        !(cfg->succs = malloc(sizeof(*cfg->succs) * (edges_size + 1))) ||
+        !(cfg->preds = malloc(sizeof(*cfg->preds) * (edges_size + 1)))) {
+        printf("Error: Couldn't allocate control flow graph of %s.\n", func->name);
+        free(reached);
+        cfg_free(cfg);
+        return 0;
+    }
+    cfg->blocks_count = count;
+
+    // get the opcodes range of each block
+    for (unsigned int i = 0; i < size; i++) {
+        if (!i || cfg->index[i] != cfg->index[i - 1])
+            cfg->blocks[cfg->index[i]].start = func->address + i;
+        cfg->blocks[cfg->index[i]].end = func->address + i + 1;
+    }
+
+    // the blocks following a block falling through are reached
+    for (unsigned int i = 1; i < count; i++) {
+        op = &func->qvm->opcodes[cfg->blocks[i - 1].end - 1];
+        if (op->info->id != OP_JUMP && op->info->id != OP_LEAVE)
+            reached[cfg->blocks[i].start - func->address] = 1;
+    }
+
+    // link the blocks to their successors, then to their predecessors
+    for (unsigned int i = 0; i < count; i++)
+        cfg_load_succs(cfg, &cfg->blocks[i], reached);
+    cfg_load_preds(cfg);
+
+    // free the opcodes reached
+    free(reached);
+
+    // success
+    return 1;
+}
+
+static unsigned int cfg_load_table(qvm_cfg_t *cfg, unsigned int address, unsigned int **table)
+{
+    qvm_t           *qvm = cfg->function->qvm;
+    qvm_opcode_t    *opcodes = qvm->opcodes;
+    qvm_section_t   *data = &qvm->sections[S_DATA];
+    unsigned int    start = cfg->function->address;
+    unsigned int    end = cfg->function->address + cfg->function->op_size;
+    unsigned int    count;
+    unsigned int    base;
+    qvm_opcode_e    id;
+    char            low_found = 0;
+    char            high_found = 0;
+    int             low = 0;
+    int             high = 0;
+
+    // a switch loads its target from the jump table address added to the scaled index
+    if (address < start + 3 || opcodes[address - 1].info->id != OP_LOAD4 || opcodes[address - 2].info->id != OP_ADD || opcodes[address - 3].info->id != OP_CONST)
+        return 0;
+
+    // the index is checked against the lowest and the highest cases just before
+    for (unsigned int i = address - 4; i > start && i + CFG_TABLE_CHECKS > address && (!low_found || !high_found); i--) {
+        id = opcodes[i].info->id;
+        if (opcodes[i - 1].info->id != OP_CONST)
+            continue;
+        if ((id == OP_LTI || id == OP_LTU) && !low_found) {
+            low = opcodes[i - 1].value;
+            low_found = 1;
+        }
+        else if ((id == OP_GTI || id == OP_GTU) && !high_found) {
+            high = opcodes[i - 1].value;
+            high_found = 1;
+        }
+    }
+    if (!low_found || !high_found || low < 0 || low > high)
+        return 0;
+
+    // the table holds a word for each case from the lowest one
+    base = (unsigned int)opcodes[address - 3].value + (unsigned int)low * 4;
+    count = (unsigned int)(high - low) + 1;
+    if (base & 3 || base >= data->length || count > (data->length - base) / 4)
+        return 0;
+
+    // all the entries must point inside the function, after its entry
+    *table = (unsigned int *)(data->content + base);
+    for (unsigned int i = 0; i < count; i++)
+        if ((*table)[i] <= start || (*table)[i] >= end)
+            return 0;
+
+    // return the entries count
+    return count;
+}
+
+static void cfg_load_succs(qvm_cfg_t *cfg, qvm_cfg_block_t *block, char *reached)
+{
+    qvm_function_t  *func = cfg->function;
+    qvm_opcode_t    *last = &func->qvm->opcodes[block->end - 1];
+    unsigned int    next = cfg_find(cfg, block->end);
+    unsigned int    target = CFG_NONE;
+    unsigned int    *table;
+    unsigned int    entries_count;
+    unsigned int    j;
+
+    // the successors of the block follow the previous block ones
+    block->succs_start = cfg->edges_count;
+
+    // a return leaves the function
+    if (last->info->id == OP_LEAVE) {
+        block->exit = 1;
+        return;
+    }
+
+    // a jump goes to its constant target only
+    if (last->info->id == OP_JUMP) {
+        if (block->end - 1 > func->address && last[-1].info->id == OP_CONST)
+            target = cfg_find(cfg, last[-1].value);
+        if (target != CFG_NONE)
+            cfg->succs[cfg->edges_count++] = target;
+
+        // an indirect jump goes to the targets of its jump table, each once
+        else if ((entries_count = cfg_load_table(cfg, block->end - 1, &table))) {
+            block->indirect = 1;
+            block->table = 1;
+            for (unsigned int i = 0; i < entries_count; i++) {
+                target = cfg_find(cfg, table[i]);
+                for (j = block->succs_start; j < cfg->edges_count && cfg->succs[j] != target; j++);
+                if (j == cfg->edges_count)
+                    cfg->succs[cfg->edges_count++] = target;
+            }
+        }
+
+        // without a known jump table it may go to any block not reached otherwise
+        else {
+            block->indirect = 1;
+            for (unsigned int i = 1; i < cfg->blocks_count; i++)
+                if (!reached[cfg->blocks[i].start - func->address])
+                    cfg->succs[cfg->edges_count++] = i;
+        }
+        block->succs_count = cfg->edges_count - block->succs_start;
+        return;
+    }
+
+    // a compare goes to the next block and to its target
+    if (last->info->opblock_id == OPB_COMPARE)
+        target = cfg_find(cfg, last->value);
+
+    // add the next block, the last block falling out of the function leaves it
+    if (next != CFG_NONE)
+        cfg->succs[cfg->edges_count++] = next;
+    else
+        block->exit = 1;
+
+    // add the compare target if it isn't the next block
+    if (target != CFG_NONE && target != next)
+        cfg->succs[cfg->edges_count++] = target;
+    block->succs_count = cfg->edges_count - block->succs_start;
+}
+
+static void cfg_load_preds(qvm_cfg_t *cfg)
+{
+    qvm_cfg_block_t *block;
+    unsigned int    start = 0;
+
+    // count the predecessors of each block
+    for (unsigned int i = 0; i < cfg->edges_count; i++)
+        cfg->blocks[cfg->succs[i]].preds_count++;
+
+    // give each block its range of predecessors
+    for (unsigned int i = 0; i < cfg->blocks_count; i++) {
+        cfg->blocks[i].preds_start = start;
+        start += cfg->blocks[i].preds_count;
+        cfg->blocks[i].preds_count = 0;
+    }
+
+    // fill the predecessors in the blocks order
+    for (unsigned int i = 0; i < cfg->blocks_count; i++)
+        for (unsigned int j = 0; j < cfg->blocks[i].succs_count; j++) {
+            block = &cfg->blocks[cfg->succs[cfg->blocks[i].succs_start + j]];
+            cfg->preds[block->preds_start + block->preds_count++] = i;
+        }
+}
+
+int cfg_load_dominators(qvm_cfg_t *cfg)
+{
+    unsigned int    *ranks = NULL;
+    unsigned int    *stack = NULL;
+    unsigned int    *cursors = NULL;
+    unsigned int    count = cfg->blocks_count;
+    unsigned int    stack_count = 0;
+    unsigned int    block;
+    unsigned int    succ;
+    unsigned int    pred;
+    unsigned int    idom;
+    char            changed = 1;
+
+    // allocate the blocks order, the immediate dominators and the walk arrays
+    if (!(cfg->order = malloc(sizeof(*cfg->order) * (count + 1))) ||
+        !(cfg->idoms = malloc(sizeof(*cfg->idoms) * (count + 1))) ||
+        !(ranks = malloc(sizeof(*ranks) * (count + 1))) ||
+        !(stack = malloc(sizeof(*stack) * (count + 1))) ||
+        !(cursors = calloc(count + 1, sizeof(*cursors)))) {
+        printf("Error: Couldn't allocate dominators of %s.\n", cfg->function->name);
+        free(ranks);
+        free(stack);
+        free(cursors);
+        return 0;
+    }
+
+    // the blocks not reached from the entry have no rank and no dominator
+    for (unsigned int i = 0; i < count; i++) {
+        ranks[i] = CFG_NONE;
+        cfg->idoms[i] = CFG_NONE;
+    }
+
+    // walk the blocks depth first from the entry to get their post order
+    cfg->order_count = 0;
+    if (count) {
+        stack[stack_count++] = 0;
+        ranks[0] = 0;
+    }
+    while (stack_count) {
+        block = stack[stack_count - 1];
+
+        // go to the next successor not walked yet
+        if (cursors[block] < cfg->blocks[block].succs_count) {
+            succ = cfg->succs[cfg->blocks[block].succs_start + cursors[block]++];
+            if (ranks[succ] == CFG_NONE) {
+                ranks[succ] = 0;
+                stack[stack_count++] = succ;
+            }
+            continue;
+        }
+
+        // the block is done once all its successors are
+        cfg->order[cfg->order_count++] = block;
+        stack_count--;
+    }
+
+    // reverse the post order and rank the blocks
+    for (unsigned int i = 0; i < cfg->order_count / 2; i++) {
+        block = cfg->order[i];
+        cfg->order[i] = cfg->order[cfg->order_count - i - 1];
+        cfg->order[cfg->order_count - i - 1] = block;
+    }
+    for (unsigned int i = 0; i < cfg->order_count; i++)
+        ranks[cfg->order[i]] = i;
+
+    // the entry dominates itself, then intersect the dominators of the predecessors until they are stable
+    if (cfg->order_count)
+        cfg->idoms[cfg->order[0]] = cfg->order[0];
+    while (changed) {
+        changed = 0;
+        for (unsigned int i = 1; i < cfg->order_count; i++) {
+            block = cfg->order[i];
+            idom = CFG_NONE;
+
+            // intersect the predecessors already processed
+            for (unsigned int j = 0; j < cfg->blocks[block].preds_count; j++) {
+                pred = cfg->preds[cfg->blocks[block].preds_start + j];
+                if (cfg->idoms[pred] == CFG_NONE)
+                    continue;
+                idom = idom == CFG_NONE ? pred : cfg_intersect(cfg, ranks, pred, idom);
+            }
+
+            // save the new dominator
+            if (idom != cfg->idoms[block]) {
+                cfg->idoms[block] = idom;
+                changed = 1;
+            }
+        }
+    }
+
+    // free the walk arrays
+    free(ranks);
+    free(stack);
+    free(cursors);
+
+    // success
+    return 1;
+}
+
+static unsigned int cfg_intersect(qvm_cfg_t *cfg, unsigned int *ranks, unsigned int a, unsigned int b)
+{
+    // climb the dominators of the latest block until both meet
+    while (a != b) {
+        while (ranks[a] > ranks[b])
+            a = cfg->idoms[a];
+        while (ranks[b] > ranks[a])
+            b = cfg->idoms[b];
+    }
+
+    // return the common dominator
+    return a;
+}
+
+int cfg_load_loops(qvm_cfg_t *cfg)
+{
+    qvm_cfg_loop_t  *loop;
+    qvm_cfg_loop_t  *loops;
+    unsigned int    *marks = NULL;
+    unsigned int    *stack = NULL;
+    unsigned int    stack_count;
+    unsigned int    loops_size = 0;
+    unsigned int    blocks_size = 0;
+    unsigned int    header;
+    unsigned int    block;
+    unsigned int    pred;
+
+    // allocate the innermost loop of each block and the walk arrays
+    if (!(cfg->inner = malloc(sizeof(*cfg->inner) * (cfg->blocks_count + 1))) ||
+        !(marks = calloc(cfg->blocks_count + 1, sizeof(*marks))) ||
+        !(stack = malloc(sizeof(*stack) * (cfg->blocks_count + 1)))) {
+        printf("Error: Couldn't allocate loops of %s.\n", cfg->function->name);
+        free(marks);
+        return 0;
+    }
+    for (unsigned int i = 0; i < cfg->blocks_count; i++)
+        cfg->inner[i] = CFG_NONE;
+
+    // browse the headers in reverse post order, the outer loops come first
+    for (unsigned int i = 0; i < cfg->order_count; i++) {
+        header = cfg->order[i];
+        stack_count = 0;
+
+        // find the back edges to the header
+        for (unsigned int j = 0; j < cfg->blocks[header].preds_count; j++) {
+            pred = cfg->preds[cfg->blocks[header].preds_start + j];
+            if (!cfg_dominates(cfg, header, pred))
+                continue;
+
+            // start the loop with its header
+            if (marks[header] != cfg->loops_count + 1) {
+                if (cfg->loops_count >= loops_size) {
+                    loops_size = loops_size ? loops_size * 2 : 8;
+                    if (!(loops = realloc(cfg->loops, sizeof(*loops) * loops_size))) {
+                        printf("Error: Couldn't allocate loops of %s.\n", cfg->function->name);
+                        free(marks);
+                        free(stack);
+                        return 0;
+                    }
+                    cfg->loops = loops;
+                }
+                loop = &cfg->loops[cfg->loops_count];
+                loop->header = header;
+                loop->blocks_start = cfg->loops_blocks_count;
+                marks[header] = cfg->loops_count + 1;
+                if (!cfg_load_loops_block(cfg, header, &blocks_size)) {
+                    free(marks);
+                    free(stack);
+                    return 0;
+                }
+            }
+
+            // add the source of the back edge
+            if (marks[pred] != cfg->loops_count + 1) {
+                marks[pred] = cfg->loops_count + 1;
+                stack[stack_count++] = pred;
+                if (!cfg_load_loops_block(cfg, pred, &blocks_size)) {
+                    free(marks);
+                    free(stack);
+                    return 0;
+                }
+            }
+        }
+
+        // there is no loop on this header
+        if (marks[header] != cfg->loops_count + 1)
+            continue;
+
+        // add the reachable blocks reaching the back edges
+        while (stack_count) {
+            block = stack[--stack_count];
+            for (unsigned int j = 0; j < cfg->blocks[block].preds_count; j++) {
+                pred = cfg->preds[cfg->blocks[block].preds_start + j];
+                if (marks[pred] == cfg->loops_count + 1 || cfg->idoms[pred] == CFG_NONE)
+                    continue;
+                marks[pred] = cfg->loops_count + 1;
+                stack[stack_count++] = pred;
+                if (!cfg_load_loops_block(cfg, pred, &blocks_size)) {
+                    free(marks);
+                    free(stack);
+                    return 0;
+                }
+            }
+        }
+
+        // nest the loop in the innermost loop of its header, its blocks are now in it
+        loop = &cfg->loops[cfg->loops_count];
+        loop->blocks_count = cfg->loops_blocks_count - loop->blocks_start;
+        loop->parent = cfg->inner[header];
+        loop->depth = loop->parent == CFG_NONE ? 1 : cfg->loops[loop->parent].depth + 1;
+        for (unsigned int j = 0; j < loop->blocks_count; j++)
+            cfg->inner[cfg->loops_blocks[loop->blocks_start + j]] = cfg->loops_count;
+        cfg->loops_count++;
+    }
+
+    // free the walk arrays
+    free(marks);
+    free(stack);
+
+    // success
+    return 1;
+}
+
+static int cfg_load_loops_block(qvm_cfg_t *cfg, unsigned int block, unsigned int *size)
+{
+    unsigned int    *blocks;
+
+    // grow the loops blocks if needed
+    if (cfg->loops_blocks_count >= *size) {
+        *size = *size ? *size * 2 : 64;
+        if (!(blocks = realloc(cfg->loops_blocks, sizeof(*blocks) * *size))) {
+            printf("Error: Couldn't allocate loops of %s.\n", cfg->function->name);
+            return 0;
+        }
+        cfg->loops_blocks = blocks;
+    }
+
+    // add the block to the current loop
+    cfg->loops_blocks[cfg->loops_blocks_count++] = block;
+
+    // success
+    return 1;
+}
+
+unsigned int cfg_find(qvm_cfg_t *cfg, unsigned int address)
+{
+    // the address must be in the function
+    if (address < cfg->function->address || address >= cfg->function->address + cfg->function->op_size)
+        return CFG_NONE;
+
+    // return the block of the opcode
+    return cfg->index[address - cfg->function->address];
+}
+
+int cfg_dominates(qvm_cfg_t *cfg, unsigned int dom, unsigned int block)
+{
+    // the blocks not reached from the entry are dominated by none
+    if (!cfg->idoms || cfg->idoms[block] == CFG_NONE || cfg->idoms[dom] == CFG_NONE)
+        return 0;
+
+    // climb the dominators of the block up to the entry
+    while (block != dom) {
+        if (cfg->idoms[block] == block)
+            return 0;
+        block = cfg->idoms[block];
+    }
+
+    // the block is dominated
+    return 1;
+}
+
+unsigned int cfg_depth(qvm_cfg_t *cfg, unsigned int block)
+{
+    // the blocks out of any loop have no depth
+    if (!cfg->inner || cfg->inner[block] == CFG_NONE)
+        return 0;
+
+    // return the depth of the innermost loop of the block
+    return cfg->loops[cfg->inner[block]].depth;
+}
+
+unsigned long long cfg_shape(qvm_cfg_t *cfg)
+{
+    qvm_cfg_block_t     *block;
+    unsigned long long  hash = HASH_INIT;
+    unsigned int        length;
+
+    // hash the blocks count
+    hash = hash_data(hash, &cfg->blocks_count, sizeof(cfg->blocks_count));
+
+    // hash the length, the exits and the successors of each block, the block indexes don't depend on the addresses
+    for (unsigned int i = 0; i < cfg->blocks_count; i++) {
+        block = &cfg->blocks[i];
+        length = block->end - block->start;
+        hash = hash_data(hash, &length, sizeof(length));
+        hash = hash_data(hash, &block->indirect, sizeof(block->indirect));
+        hash = hash_data(hash, &block->exit, sizeof(block->exit));
+        hash = hash_data(hash, &block->succs_count, sizeof(block->succs_count));
+        hash = hash_data(hash, &cfg->succs[block->succs_start], sizeof(*cfg->succs) * block->succs_count);
+    }
+
+    // return the shape hash
+    return hash;
+}
+
+void cfg_free(qvm_cfg_t *cfg)
+{
+    // free the graph arrays
+    free(cfg->index);
+    free(cfg->blocks);
+    free(cfg->succs);
+    free(cfg->preds);
+    free(cfg->order);
+    free(cfg->idoms);
+    free(cfg->loops);
+    free(cfg->loops_blocks);
+    free(cfg->inner);
+    cfg->index = NULL;
+    cfg->blocks = NULL;
+    cfg->succs = NULL;
+    cfg->preds = NULL;
+    cfg->order = NULL;
+    cfg->idoms = NULL;
+    cfg->loops = NULL;
+    cfg->loops_blocks = NULL;
+    cfg->inner = NULL;
+    cfg->blocks_count = 0;
+    cfg->edges_count = 0;
+    cfg->order_count = 0;
+    cfg->loops_count = 0;
+    cfg->loops_blocks_count = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef CFG_H
+#define CFG_H
+
+#define CFG_NONE    (unsigned int)-1
+
+typedef struct qvm_cfg_block_s  qvm_cfg_block_t;
+typedef struct qvm_cfg_loop_s   qvm_cfg_loop_t;
+typedef struct qvm_cfg_s        qvm_cfg_t;
+
+typedef struct qvm_cfg_block_s {
+    unsigned int    start;
+    unsigned int    end;
+    unsigned int    succs_start;
+    unsigned int    succs_count;
+    unsigned int    preds_start;
+    unsigned int    preds_count;
+    char            indirect;
+    char            table;
+    char            exit;
+} qvm_cfg_block_t;
+
+typedef struct qvm_cfg_loop_s {
+    unsigned int    header;
+    unsigned int    blocks_start;
+    unsigned int    blocks_count;
+    unsigned int    parent;
+    unsigned int    depth;
+} qvm_cfg_loop_t;
+
+typedef struct qvm_cfg_s {
+    qvm_function_t  *function;
+    qvm_cfg_block_t *blocks;
+    unsigned int    blocks_count;
+    unsigned int    *succs;
+    unsigned int    *preds;
+    unsigned int    edges_count;
+    unsigned int    *index;
+    unsigned int    *order;
+    unsigned int    order_count;
+    unsigned int    *idoms;
+    qvm_cfg_loop_t  *loops;
+    unsigned int    loops_count;
+    unsigned int    *loops_blocks;
+    unsigned int    loops_blocks_count;
+    unsigned int    *inner;
+} qvm_cfg_t;
+
+int                 cfg_load(qvm_cfg_t *cfg, qvm_function_t *func);
+int                 cfg_load_dominators(qvm_cfg_t *cfg);
+int                 cfg_load_loops(qvm_cfg_t *cfg);
+unsigned int        cfg_find(qvm_cfg_t *cfg, unsigned int address);
+int                 cfg_dominates(qvm_cfg_t *cfg, unsigned int dom, unsigned int block);
+unsigned int        cfg_depth(qvm_cfg_t *cfg, unsigned int block);
+unsigned long long  cfg_shape(qvm_cfg_t *cfg);
+void                cfg_free(qvm_cfg_t *cfg);
+
+#endif
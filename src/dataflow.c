@@ -0,0 +1,466 @@
+#include "qvmd.h"
+
+/*
+    The data flow framework solves the gen and kill problems of a function
+    over its control flow graph. The sets are dense bitsets, all the
+    blocks sets of a kind being stored in a single array, and the solver
+    only visits again the blocks whose predecessors (or successors going
+    backward) have changed, starting from the reverse post order. The
+    meet is the union, as for the may problems. An indirect jump whose
+    jump table isn't known may go anywhere, so going backward its meet has
+    all the bits, and going forward its result is merged in every block.
+
+    The reaching definitions and the liveness of the locals are the
+    reference problems. The statements are read from the opblocks of the
+    function, a definition being the assignation of a local address and a
+    use any other local address, including the arguments of the restored
+    calls. A partial assignation defines the local without killing its
+    other definitions, and the stores through pointers aren't tracked.
+*/
+
+int                 dataflow_init(qvm_dataflow_t *df, qvm_cfg_t *cfg, unsigned int bits_count, char forward);
+qvm_bitset_t        *dataflow_set(qvm_dataflow_t *df, qvm_bitset_t *sets, unsigned int block);
+void                dataflow_add(qvm_bitset_t *set, unsigned int bit);
+void                dataflow_remove(qvm_bitset_t *set, unsigned int bit);
+int                 dataflow_has(qvm_bitset_t *set, unsigned int bit);
+int                 dataflow_solve(qvm_dataflow_t *df);
+static int          dataflow_solve_block(qvm_dataflow_t *df, unsigned int block);
+void                dataflow_free(qvm_dataflow_t *df);
+int                 dataflow_locals_load(qvm_dataflow_locals_t *locals, qvm_cfg_t *cfg);
+static int          dataflow_locals_def(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, unsigned int block);
+static unsigned int dataflow_local(qvm_dataflow_locals_t *locals, qvm_variable_t *var);
+static unsigned int dataflow_statement_def(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, char *full);
+static void         dataflow_statement_uses(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, qvm_bitset_t *uses);
+int                 dataflow_reaching(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals);
+int                 dataflow_liveness(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals);
+void                dataflow_locals_free(qvm_dataflow_locals_t *locals);
+
+int dataflow_init(qvm_dataflow_t *df, qvm_cfg_t *cfg, unsigned int bits_count, char forward)
+{
+    size_t  size;
+
+    // initialize the problem
+    df->cfg = cfg;
+    df->forward = forward;
+    df->bits_count = bits_count;
+    df->words_count = (bits_count + DATAFLOW_BITS - 1) / DATAFLOW_BITS;
+    df->iterations = 0;
+
+    // allocate the empty sets of all blocks
+    size = (size_t)df->words_count * cfg->blocks_count + 1;
+    df->gen = calloc(size, sizeof(*df->gen));
+    df->kill = calloc(size, sizeof(*df->kill));
+    df->in = calloc(size, sizeof(*df->in));
+    df->out = calloc(size, sizeof(*df->out));
+    if (!df->gen || !df->kill || !df->in || !df->out) {
+        printf("Error: Couldn't allocate data flow sets of %s.\n", cfg->function->name);
+        dataflow_free(df);
+        return 0;
+    }
+
+    // success
+    return 1;
+}
+
+qvm_bitset_t *dataflow_set(qvm_dataflow_t *df, qvm_bitset_t *sets, unsigned int block)
+{
+    // return the set of the block
+    return sets + (size_t)block * df->words_count;
+}
+
+void dataflow_add(qvm_bitset_t *set, unsigned int bit)
+{
+    set[bit / DATAFLOW_BITS] |= 1ULL << (bit % DATAFLOW_BITS);
+}
+
+void dataflow_remove(qvm_bitset_t *set, unsigned int bit)
+{
+    set[bit / DATAFLOW_BITS] &= ~(1ULL << (bit % DATAFLOW_BITS));
+}
+
+int dataflow_has(qvm_bitset_t *set, unsigned int bit)
+{
+    return (set[bit / DATAFLOW_BITS] >> (bit % DATAFLOW_BITS)) & 1;
+}
+
+int dataflow_solve(qvm_dataflow_t *df)
+{
+    qvm_cfg_t       *cfg = df->cfg;
+    qvm_cfg_block_t *block;
+    unsigned int    *queue;
+    char            *queued;
+    unsigned int    count = cfg->blocks_count;
+    unsigned int    head = 0;
+    unsigned int    queue_count = 0;
+    unsigned int    current;
+    unsigned int    next;
+
+    // allocate the work queue and its flags
+    if (!(queue = malloc(sizeof(*queue) * (count + 1))) || !(queued = calloc(count + 1, sizeof(*queued)))) {
+        printf("Error: Couldn't allocate data flow queue of %s.\n", cfg->function->name);
+        free(queue);
+        return 0;
+    }
+
+    // queue the blocks in reverse post order, or its reverse going backward, then the blocks never reached
+    for (unsigned int i = 0; i < cfg->order_count; i++) {
+        current = cfg->order[df->forward ? i : cfg->order_count - i - 1];
+        queue[queue_count++] = current;
+        queued[current] = 1;
+    }
+    for (unsigned int i = 0; i < count; i++)
+        if (!queued[i]) {
+            queue[queue_count++] = i;
+            queued[i] = 1;
+        }
+
+    // solve the blocks until their sets are stable
+    while (queue_count) {
+        current = queue[head];
+        head = (head + 1) % count;
+        queue_count--;
+        queued[current] = 0;
+        df->iterations++;
+
+        // nothing else changes if the block result didn't change
+        if (!dataflow_solve_block(df, current))
+            continue;
+
+        // queue the blocks depending on it again, all of them after an indirect jump without a known table going forward
+        block = &cfg->blocks[current];
+        if (df->forward && block->indirect && !block->table)
+            for (unsigned int i = 1; i < count; i++)
+                if (!queued[i]) {
+                    queue[(head + queue_count++) % count] = i;
+                    queued[i] = 1;
+                }
+        for (unsigned int i = 0; i < (df->forward ? block->succs_count : block->preds_count); i++) {
+            next = df->forward ? cfg->succs[block->succs_start + i] : cfg->preds[block->preds_start + i];
+            if (queued[next])
+                continue;
+            queue[(head + queue_count++) % count] = next;
+            queued[next] = 1;
+        }
+    }
+
+    // free the work queue
+    free(queue);
+    free(queued);
+
+    // success
+    return 1;
+}
+
+static int dataflow_solve_block(qvm_dataflow_t *df, unsigned int current)
+{
+    qvm_cfg_t       *cfg = df->cfg;
+    qvm_cfg_block_t *block = &cfg->blocks[current];
+    qvm_bitset_t    *meet = dataflow_set(df, df->forward ? df->in : df->out, current);
+    qvm_bitset_t    *result = dataflow_set(df, df->forward ? df->out : df->in, current);
+    qvm_bitset_t    *gen = dataflow_set(df, df->gen, current);
+    qvm_bitset_t    *kill = dataflow_set(df, df->kill, current);
+    qvm_bitset_t    *other;
+    qvm_bitset_t    word;
+    unsigned int    count = df->forward ? block->preds_count : block->succs_count;
+    unsigned int    next;
+    int             changed = 0;
+
+    // merge the results of the predecessors, or of the successors going backward
+    memset(meet, 0, sizeof(*meet) * df->words_count);
+    for (unsigned int i = 0; i < count; i++) {
+        next = df->forward ? cfg->preds[block->preds_start + i] : cfg->succs[block->succs_start + i];
+        other = dataflow_set(df, df->forward ? df->out : df->in, next);
+        for (unsigned int j = 0; j < df->words_count; j++)
+            meet[j] |= other[j];
+    }
+
+    // an indirect jump without a known table may go to any block, or come to any block going forward
+    if (!df->forward && block->indirect && !block->table)
+        for (unsigned int i = 0; i < df->bits_count; i++)
+            dataflow_add(meet, i);
+    if (df->forward && current)
+        for (unsigned int i = 0; i < cfg->blocks_count; i++)
+            if (cfg->blocks[i].indirect && !cfg->blocks[i].table) {
+                other = dataflow_set(df, df->out, i);
+                for (unsigned int j = 0; j < df->words_count; j++)
+                    meet[j] |= other[j];
+            }
+
+    // apply the block transfer
+    for (unsigned int i = 0; i < df->words_count; i++) {
+        word = gen[i] | (meet[i] & ~kill[i]);
+        if (word != result[i]) {
+            result[i] = word;
+            changed = 1;
+        }
+    }
+
+    // return if the block result changed
+    return changed;
+}
+
+void dataflow_free(qvm_dataflow_t *df)
+{
+    // free the sets
+    free(df->gen);
+    free(df->kill);
+    free(df->in);
+    free(df->out);
+    df->gen = NULL;
+    df->kill = NULL;
+    df->in = NULL;
+    df->out = NULL;
+}
+
+int dataflow_locals_load(qvm_dataflow_locals_t *locals, qvm_cfg_t *cfg)
+{
+    qvm_function_t  *func = cfg->function;
+    qvm_variable_t  *var;
+    qvm_opblock_t   *opb;
+    unsigned int    local;
+    char            full;
+
+    // initialize the locals
+    memset(locals, 0, sizeof(*locals));
+    locals->cfg = cfg;
+
+    // index the locals sorted by address
+    for (var = func->locals; var; var = var->next)
+        locals->locals_count++;
+    if (!(locals->locals = malloc(sizeof(*locals->locals) * (locals->locals_count + 1)))) {
+        printf("Error: Couldn't allocate data flow locals of %s.\n", func->name);
+        return 0;
+    }
+    locals->locals_count = 0;
+    for (var = func->locals; var; var = var->next)
+        locals->locals[locals->locals_count++] = var;
+
+    // find the definitions of the statements in order
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
+        if (opb->opcode && dataflow_statement_def(locals, opb, &full) != CFG_NONE && !dataflow_locals_def(locals, opb, cfg_find(cfg, opb->opcode->address))) {
+            dataflow_locals_free(locals);
+            return 0;
+        }
+
+    // allocate the definitions of each local
+    if (!(locals->locals_defs = malloc(sizeof(*locals->locals_defs) * (locals->defs_count + 1))) ||
+        !(locals->locals_defs_starts = calloc(locals->locals_count + 2, sizeof(*locals->locals_defs_starts)))) {
+        printf("Error: Couldn't allocate data flow locals of %s.\n", func->name);
+        dataflow_locals_free(locals);
+        return 0;
+    }
+
+    // count the definitions of each local, then place them
+    for (unsigned int i = 0; i < locals->defs_count; i++)
+        locals->locals_defs_starts[locals->defs_locals[i] + 2]++;
+    for (unsigned int i = 2; i < locals->locals_count + 2; i++)
+        locals->locals_defs_starts[i] += locals->locals_defs_starts[i - 1];
+    for (unsigned int i = 0; i < locals->defs_count; i++) {
+        local = locals->defs_locals[i];
+        locals->locals_defs[locals->locals_defs_starts[local + 1]++] = i;
+    }
+
+    // success
+    return 1;
+}
+
+static int dataflow_locals_def(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, unsigned int block)
+{
+    qvm_opblock_t   **defs;
+    unsigned int    *defs_locals;
+    unsigned int    *defs_blocks;
+    unsigned int    size;
+    char            full;
+
+    // the statement must be in a block
+    if (block == CFG_NONE)
+        return 1;
+
+    // grow the definitions if needed
+    if (locals->defs_count >= locals->defs_size) {
+        size = locals->defs_size ? locals->defs_size * 2 : 16;
+        if ((defs = realloc(locals->defs, sizeof(*defs) * size)))
+            locals->defs = defs;
+        if ((defs_locals = realloc(locals->defs_locals, sizeof(*defs_locals) * size)))
+            locals->defs_locals = defs_locals;
+        if ((defs_blocks = realloc(locals->defs_blocks, sizeof(*defs_blocks) * size)))
+            locals->defs_blocks = defs_blocks;
+        if (!defs || !defs_locals || !defs_blocks) {
+            printf("Error: Couldn't allocate data flow definitions of %s.\n", locals->cfg->function->name);
+            return 0;
+        }
+        locals->defs_size = size;
+    }
+
+    // add the definition
+    locals->defs[locals->defs_count] = opb;
+    locals->defs_locals[locals->defs_count] = dataflow_statement_def(locals, opb, &full);
+    locals->defs_blocks[locals->defs_count] = block;
+    locals->defs_count++;
+
+    // success
+    return 1;
+}
+
+static unsigned int dataflow_local(qvm_dataflow_locals_t *locals, qvm_variable_t *var)
+{
+    unsigned int    start = 0;
+    unsigned int    end = locals->locals_count;
+    unsigned int    middle;
+
+    // search the local by address
+    while (start < end) {
+        middle = (start + end) / 2;
+        if (locals->locals[middle]->address < var->address)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+
+    // the variable must be this local
+    if (start < locals->locals_count && locals->locals[start] == var)
+        return start;
+    return CFG_NONE;
+}
+
+static unsigned int dataflow_statement_def(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, char *full)
+{
+    unsigned int    local;
+
+    // a definition is the assignation of a local address
+    if (opb->info->id != OPB_ASSIGNATION || !opb->op2 || opb->op2->info->id != OPB_LOCAL_ADR || !opb->op2->variable)
+        return CFG_NONE;
+    if ((local = dataflow_local(locals, opb->op2->variable)) == CFG_NONE)
+        return CFG_NONE;
+
+    // the local is killed only if it is fully assigned
+    *full = (unsigned int)opb->opcode->value >= opb->op2->variable->size;
+    return local;
+}
+
+static void dataflow_statement_uses(qvm_dataflow_locals_t *locals, qvm_opblock_t *opb, qvm_bitset_t *uses)
+{
+    qvm_opblock_t   *arg;
+    unsigned int    local;
+
+    if (!opb)
+        return;
+
+    // any other local address is a use
+    if (opb->info->id == OPB_LOCAL_ADR) {
+        if (opb->variable && (local = dataflow_local(locals, opb->variable)) != CFG_NONE)
+            dataflow_add(uses, local);
+        return;
+    }
+
+    // the assigned local address isn't a use
+    if (opb->info->id == OPB_ASSIGNATION && opb->op2 && opb->op2->info->id == OPB_LOCAL_ADR)
+        dataflow_statement_uses(locals, opb->op1, uses);
+    else {
+        dataflow_statement_uses(locals, opb->child, uses);
+        dataflow_statement_uses(locals, opb->op1, uses);
+        dataflow_statement_uses(locals, opb->op2, uses);
+    }
+
+    // the arguments of a restored call are out of the statements list
+    if (opb->info->id == OPB_FUNC_CALL)
+        for (arg = opb->function_arg; arg && arg->info->id == OPB_FUNC_ARG; arg = arg->next)
+            dataflow_statement_uses(locals, arg->child, uses);
+}
+
+int dataflow_reaching(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals)
+{
+    qvm_bitset_t    *gen;
+    qvm_bitset_t    *kill;
+    unsigned int    local;
+    unsigned int    other;
+    char            full;
+
+    // one bit per definition going forward
+    if (!dataflow_init(df, locals->cfg, locals->defs_count, 1))
+        return 0;
+
+    // a definition generates itself, a full one kills the other definitions of its local
+    for (unsigned int i = 0; i < locals->defs_count; i++) {
+        gen = dataflow_set(df, df->gen, locals->defs_blocks[i]);
+        kill = dataflow_set(df, df->kill, locals->defs_blocks[i]);
+        local = dataflow_statement_def(locals, locals->defs[i], &full);
+        if (full)
+            for (unsigned int j = locals->locals_defs_starts[local]; j < locals->locals_defs_starts[local + 1]; j++) {
+                other = locals->locals_defs[j];
+                dataflow_remove(gen, other);
+                dataflow_add(kill, other);
+            }
+        dataflow_add(gen, i);
+    }
+
+    // solve the problem
+    if (!dataflow_solve(df)) {
+        dataflow_free(df);
+        return 0;
+    }
+
+    // success
+    return 1;
+}
+
+int dataflow_liveness(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals)
+{
+    qvm_function_t  *func = locals->cfg->function;
+    qvm_opblock_t   *opb;
+    qvm_bitset_t    *uses;
+    qvm_bitset_t    *gen;
+    qvm_bitset_t    *kill;
+    unsigned int    block;
+    unsigned int    local;
+    char            full;
+
+    // one bit per local going backward
+    if (!dataflow_init(df, locals->cfg, locals->locals_count, 0))
+        return 0;
+    if (!(uses = malloc(sizeof(*uses) * (df->words_count + 1)))) {
+        printf("Error: Couldn't allocate data flow uses of %s.\n", func->name);
+        dataflow_free(df);
+        return 0;
+    }
+
+    // browse the statements in order
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next) {
+        if (!opb->opcode || (block = cfg_find(locals->cfg, opb->opcode->address)) == CFG_NONE)
+            continue;
+        gen = dataflow_set(df, df->gen, block);
+        kill = dataflow_set(df, df->kill, block);
+
+        // the locals used before their definition in the block are live at its start
+        memset(uses, 0, sizeof(*uses) * df->words_count);
+        dataflow_statement_uses(locals, opb, uses);
+        for (unsigned int i = 0; i < df->words_count; i++)
+            gen[i] |= uses[i] & ~kill[i];
+
+        // a full definition kills the local
+        if ((local = dataflow_statement_def(locals, opb, &full)) != CFG_NONE && full)
+            dataflow_add(kill, local);
+    }
+    free(uses);
+
+    // solve the problem
+    if (!dataflow_solve(df)) {
+        dataflow_free(df);
+        return 0;
+    }
+
+    // success
+    return 1;
+}
+
+void dataflow_locals_free(qvm_dataflow_locals_t *locals)
+{
+    // free the locals and their definitions
+    free(locals->locals);
+    free(locals->defs);
+    free(locals->defs_locals);
+    free(locals->defs_blocks);
+    free(locals->locals_defs);
+    free(locals->locals_defs_starts);
+    memset(locals, 0, sizeof(*locals));
+}
@@ -0,0 +1,47 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#define DATAFLOW_BITS   64
+
+typedef unsigned long long              qvm_bitset_t;
+typedef struct qvm_dataflow_s           qvm_dataflow_t;
+typedef struct qvm_dataflow_locals_s    qvm_dataflow_locals_t;
+
+typedef struct qvm_dataflow_s {
+    qvm_cfg_t       *cfg;
+    char            forward;
+    unsigned int    bits_count;
+    unsigned int    words_count;
+    qvm_bitset_t    *gen;
+    qvm_bitset_t    *kill;
+    qvm_bitset_t    *in;
+    qvm_bitset_t    *out;
+    unsigned int    iterations;
+} qvm_dataflow_t;
+
+typedef struct qvm_dataflow_locals_s {
+    qvm_cfg_t       *cfg;
+    qvm_variable_t  **locals;
+    unsigned int    locals_count;
+    qvm_opblock_t   **defs;
+    unsigned int    *defs_locals;
+    unsigned int    *defs_blocks;
+    unsigned int    defs_count;
+    unsigned int    defs_size;
+    unsigned int    *locals_defs;
+    unsigned int    *locals_defs_starts;
+} qvm_dataflow_locals_t;
+
+int             dataflow_init(qvm_dataflow_t *df, qvm_cfg_t *cfg, unsigned int bits_count, char forward);
+qvm_bitset_t    *dataflow_set(qvm_dataflow_t *df, qvm_bitset_t *sets, unsigned int block);
+void            dataflow_add(qvm_bitset_t *set, unsigned int bit);
+void            dataflow_remove(qvm_bitset_t *set, unsigned int bit);
+int             dataflow_has(qvm_bitset_t *set, unsigned int bit);
+int             dataflow_solve(qvm_dataflow_t *df);
+void            dataflow_free(qvm_dataflow_t *df);
+int             dataflow_locals_load(qvm_dataflow_locals_t *locals, qvm_cfg_t *cfg);
+int             dataflow_reaching(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals);
+int             dataflow_liveness(qvm_dataflow_t *df, qvm_dataflow_locals_t *locals);
+void            dataflow_locals_free(qvm_dataflow_locals_t *locals);
+
+#endif
@@ -1,123 +1,322 @@
 #include "qvmd.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+#define SPLIT_FILENAME_SIZE 80
+
+typedef struct {
+    qvm_t               *qvm;
+    char                *dirname;
+    char                (*filenames)[SPLIT_FILENAME_SIZE];
+    unsigned long long  *hashes;
+} qvm_decompile_split_t;
 
 int         qvm_decompile(qvm_t *qvm, char *filename);
-static void qvm_decompile_header(qvm_t *qvm);
-static void qvm_decompile_globals(qvm_t *qvm);
-static void qvm_decompile_functions(qvm_t *qvm);
-static void qvm_decompile_function_header(qvm_function_t *func);
-static void qvm_decompile_function_code(qvm_function_t *func);
-static void qvm_decompile_function_locals(qvm_function_t *func);
+int         qvm_decompile_split(qvm_t *qvm, char *dirname, unsigned int threads_count);
+static void qvm_decompile_split_filenames(qvm_decompile_split_t *split);
+static int  qvm_decompile_split_compare(const void *a, const void *b);
+static int  qvm_decompile_split_globals(qvm_decompile_split_t *split);
+static int  qvm_decompile_split_function(void *context, unsigned int index);
+static int  qvm_decompile_split_index(qvm_decompile_split_t *split);
+static void qvm_decompile_header(file_t *file, qvm_t *qvm);
+static void qvm_decompile_globals(file_t *file, qvm_t *qvm);
+static void qvm_decompile_functions(file_t *file, qvm_t *qvm);
+void        qvm_decompile_function(file_t *file, qvm_function_t *func);
+static void qvm_decompile_function_header(file_t *file, qvm_function_t *func);
+static void qvm_decompile_function_code(file_t *file, qvm_function_t *func);
+static void qvm_decompile_function_locals(file_t *file, qvm_function_t *func);
 
 int qvm_decompile(qvm_t *qvm, char *filename)
 {
-    printf("Decompilling QVM to %s...", filename);
+    file_t  *file;
 
     // create the output file
-    if (!(qvm->output_file = file_create(filename)))
+    if (!(file = file_create(filename))) {
+        printf("Decompilling QVM to %s...Error: Couldn't create file.\n", filename);
         return 0;
+    }
 
     // print the header in file
-    qvm_decompile_header(qvm);
+    qvm_decompile_header(file, qvm);
 
-    // print all globals in file
-    qvm_decompile_globals(qvm);
+    // print all globals in file if all functions are selected
+    if (qvm->selected_count == qvm->functions_count)
+        qvm_decompile_globals(file, qvm);
 
     // print all functions code in file
-    qvm_decompile_functions(qvm);
+    qvm_decompile_functions(file, qvm);
+
+    // free the created file
+    file_free(file);
+
+    printf("Decompilling QVM to %s...Success.\n", filename);
+
+    // success
+    return 1;
+}
+
+int qvm_decompile_split(qvm_t *qvm, char *dirname, unsigned int threads_count)
+{
+    qvm_decompile_split_t   split;
+    int                     success;
+
+    // create the output directory if needed
+    if (mkdir(dirname, 0755) == -1 && errno != EEXIST) {
+        printf("Splitting QVM to %s...Error: Couldn't create directory.\n", dirname);
+        return 0;
+    }
+
+    // allocate the functions filenames and hashes
+    split.qvm = qvm;
+    split.dirname = dirname;
+    split.filenames = malloc(sizeof(*split.filenames) * (qvm->functions_count + 1));
+    split.hashes = malloc(sizeof(*split.hashes) * (qvm->functions_count + 1));
+    if (!split.filenames || !split.hashes) {
+        printf("Splitting QVM to %s...Error: Couldn't allocate filenames.\n", dirname);
+        free(split.filenames);
+        free(split.hashes);
+        return 0;
+    }
+
+    // find an unique filename for each function
+    qvm_decompile_split_filenames(&split);
+
+    // print the globals file, all the functions files and the index file
+    success = (qvm->selected_count != qvm->functions_count || qvm_decompile_split_globals(&split)) &&
+        pool_run(qvm->functions_count, threads_count, &split, qvm_decompile_split_function) &&
+        qvm_decompile_split_index(&split);
+
+    // free the filenames and hashes
+    free(split.filenames);
+    free(split.hashes);
+
+    if (success)
+        printf("Splitting QVM to %s...Success: %u functions written.\n", dirname, qvm->selected_count);
+    else
+        printf("Splitting QVM to %s...Error: Couldn't write files.\n", dirname);
+
+    // return the status
+    return success;
+}
+
+static void qvm_decompile_split_filenames(qvm_decompile_split_t *split)
+{
+    char    **sorted;
+    char    *name;
+    char    *filename;
+
+    // set each filename from the function name
+    for (unsigned int i = 0; i < split->qvm->functions_count; i++) {
+        filename = split->filenames[i];
+        for (name = split->qvm->functions[i].name; *name; name++)
+            *filename++ = isalnum((unsigned char)*name) || *name == '_' ? *name : '_';
+        *filename = 0;
+
+        // keep the shared files names for the globals and the index
+        if (!strcmp(split->filenames[i], "globals") || !strcmp(split->filenames[i], "index"))
+            sprintf(filename, "_%x", split->qvm->functions[i].address);
+    }
+
+    // sort the filenames to find the duplicates
+    if (!(sorted = malloc(sizeof(*sorted) * (split->qvm->functions_count + 1)))) {
+        for (unsigned int i = 0; i < split->qvm->functions_count; i++)
+            sprintf(split->filenames[i], "sub_%x", split->qvm->functions[i].address);
+    } else {
+        for (unsigned int i = 0; i < split->qvm->functions_count; i++)
+            sorted[i] = split->filenames[i];
+        qsort(sorted, split->qvm->functions_count, sizeof(*sorted), qvm_decompile_split_compare);
+
+        // add the function address to the duplicated filenames
+        for (unsigned int i = split->qvm->functions_count; i > 1; i--)
+            if (!strcmp(sorted[i - 1], sorted[i - 2]))
+                sprintf(sorted[i - 1] + strlen(sorted[i - 1]), "_%x",
+                    split->qvm->functions[(sorted[i - 1] - split->filenames[0]) / SPLIT_FILENAME_SIZE].address);
+        free(sorted);
+    }
+
+    // add the filenames extension
+    for (unsigned int i = 0; i < split->qvm->functions_count; i++)
+        strcat(split->filenames[i], ".c");
+}
+
+static int qvm_decompile_split_compare(const void *a, const void *b)
+{
+    int     cmp;
+
+    // compare the filenames and keep the functions order
+    if ((cmp = strcmp(*(char **)a, *(char **)b)))
+        return cmp;
+    return *(char **)a < *(char **)b ? -1 : 1;
+}
+
+static int qvm_decompile_split_globals(qvm_decompile_split_t *split)
+{
+    char    filename[PATH_MAX];
+    file_t  *file;
+
+    // create the globals file
+    snprintf(filename, sizeof(filename), "%s/globals.c", split->dirname);
+    if (!(file = file_create(filename)))
+        return 0;
+
+    // print the header and all the globals
+    qvm_decompile_header(file, split->qvm);
+    qvm_decompile_globals(file, split->qvm);
+
+    // free the created file
+    file_free(file);
+
+    // success
+    return 1;
+}
+
+static int qvm_decompile_split_function(void *context, unsigned int index)
+{
+    qvm_decompile_split_t   *split = context;
+    qvm_function_t          *func = &split->qvm->functions[index];
+    char                    filename[PATH_MAX];
+    file_t                  *file;
+
+    // check if the function is selected
+    if (!func->selected)
+        return 1;
+
+    // load the function analysis if needed
+    if (!qvm_load_function(split->qvm, func))
+        return 0;
+
+    // create the function file
+    snprintf(filename, sizeof(filename), "%s/%s", split->dirname, split->filenames[index]);
+    if (!(file = file_create(filename))) {
+        qvm_unload_function(split->qvm, func);
+        return 0;
+    }
+
+    // print the function header and code
+    qvm_decompile_function(file, func);
+
+    // save the function file hash
+    file_flush(file);
+    split->hashes[index] = file->hash;
 
     // free the created file
-    file_free(qvm->output_file);
+    file_free(file);
 
-    printf("Success.\n");
+    // free the function analysis if needed
+    qvm_unload_function(split->qvm, func);
 
     // success
     return 1;
 }
 
-static void qvm_decompile_header(qvm_t *qvm)
+static int qvm_decompile_split_index(qvm_decompile_split_t *split)
 {
-    file_print(qvm->output_file, "/*\n");
-    file_print(qvm->output_file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
-    file_print(qvm->output_file, "\tName: %s\n", qvm->file->name);
-    file_print(qvm->output_file, "\tOpcodes Count: %i\n", qvm->header->instructions_count);
+    char            filename[PATH_MAX];
+    file_t          *file;
+    qvm_function_t  *func;
+
+    // create the index file
+    snprintf(filename, sizeof(filename), "%s/index", split->dirname);
+    if (!(file = file_create(filename)))
+        return 0;
+
+    // print one line per selected function
+    for (unsigned int i = 0; i < split->qvm->functions_count; i++) {
+        func = &split->qvm->functions[i];
+        if (func->selected)
+            file_print(file, "0x%x\t%s\t%s\t%016llx\n", func->address, func->name, split->filenames[i], split->hashes[i]);
+    }
+
+    // free the created file
+    file_free(file);
+
+    // success
+    return 1;
+}
+
+static void qvm_decompile_header(file_t *file, qvm_t *qvm)
+{
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tName: %s\n", qvm->file->name);
+    file_print(file, "\tOpcodes Count: %i\n", qvm->header->instructions_count);
     // TODO: Opblocks Count
-    file_print(qvm->output_file, "\tFunctions Count: %i\n", qvm->functions_count);
-    file_print(qvm->output_file, "\tSyscalls Count: %i\n", qvm->syscalls_count);
-    file_print(qvm->output_file, "\tGlobals Count: %i\n", qvm->globals_count);
-    file_print(qvm->output_file, "\tCalls Restored: %.2f\n", qvm->restored_calls_perc);
-    file_print(qvm->output_file, "*/\n\n");
+    file_print(file, "\tFunctions Count: %i\n", qvm->functions_count);
+    file_print(file, "\tSyscalls Count: %i\n", qvm->syscalls_count);
+    file_print(file, "\tGlobals Count: %i\n", qvm->globals_count);
+    file_print(file, "\tCalls Restored: %.2f\n", qvm->restored_calls_perc);
+    file_print(file, "*/\n\n");
 }
 
-static void qvm_decompile_globals(qvm_t *qvm)
+static void qvm_decompile_globals(file_t *file, qvm_t *qvm)
 {
-    qvm_variable_t      *var;
-    qvm_function_list_t *list;
+    qvm_variable_t  *var;
 
     // browse all variables
     for (var = qvm->globals; var; var = var->next) {
         // print variable type
-        file_print(qvm->output_file, "%s", var->type->pretty_name);
+        file_print(file, "%s", var->type->pretty_name);
 
         // print variable name
-        file_print(qvm->output_file, "%s", var->name);
+        file_print(file, "%s", var->name);
 
         // print variable size if needed
         if (var->type->flags & TF_ARRAY)
-            file_print(qvm->output_file, "[%u]", var->size);
+            file_print(file, "[%u]", var->size);
 
         // print variables content if needed
         if (var->status == VS_GLOBAL) {
-            file_print(qvm->output_file, " = ");
+            file_print(file, " = ");
             if (var->size == 1)
-                file_print(qvm->output_file, "%hhi", *var->content);
+                file_print(file, "%hhi", *var->content);
             else if (var->size == 2)
-                file_print(qvm->output_file, "%hi", *(short *)var->content);
+                file_print(file, "%hi", *(short *)var->content);
             else if (var->size == 4)
-                file_print(qvm->output_file, "%i", *(int *)var->content);
+                file_print(file, "%i", *(int *)var->content);
             else {
-                file_print(qvm->output_file, "\"");
+                file_print(file, "\"");
                 for (unsigned int i = 0; i < var->size; i++)
-                    file_print(qvm->output_file, "\\x%02hhx", var->content[i]);
-                file_print(qvm->output_file, "\"");
+                    file_print(file, "\\x%02hhx", var->content[i]);
+                file_print(file, "\"");
             }
         }
         else if (var->status == VS_LITERAL_TEXT) {
-            file_print(qvm->output_file, " = \"");
+            file_print(file, " = \"");
             for (unsigned int i = 0; i < var->size - 1; i++) {
                 if (var->content[i] == '\"' || var->content[i] == '\\')
-                    file_print(qvm->output_file, "\\");
-                file_print(qvm->output_file, "%c", var->content[i]);
+                    file_print(file, "\\");
+                file_print(file, "%c", var->content[i]);
             }
-            file_print(qvm->output_file, "\"");
+            file_print(file, "\"");
         }
         else if (var->status == VS_LITERAL) {
-            file_print(qvm->output_file, " = \"");
+            file_print(file, " = \"");
             for (unsigned int i = 0; i < var->size; i++)
-                file_print(qvm->output_file, "\\x%02hhx", var->content[i]);
-            file_print(qvm->output_file, "\"");
+                file_print(file, "\\x%02hhx", var->content[i]);
+            file_print(file, "\"");
         }
 
         // print a semicolon to end the line
-        file_print(qvm->output_file, ";");
+        file_print(file, ";");
 
         // print the variable 'used by' comments
-        if (var->parents)
-            file_print(qvm->output_file, " // Used by: ");
-        for (list = var->parents; list; list = list->next) {
-            if (list != var->parents)
-                file_print(qvm->output_file, ", ");
-            file_print(qvm->output_file, "%s", list->function->name);
+        if (var->parents.count)
+            file_print(file, " // Used by: ");
+        for (unsigned int i = 0; i < var->parents.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "%s", var->parents.functions[i]->name);
         }
 
         // go to the next line
-        file_print(qvm->output_file, "\n");
+        file_print(file, "\n");
     }
     
     // print an end of line after all the variables
-    file_print(qvm->output_file, "\n");
+    file_print(file, "\n");
 }
 
-static void qvm_decompile_functions(qvm_t *qvm)
+static void qvm_decompile_functions(file_t *file, qvm_t *qvm)
 {
     qvm_function_t  *func;
 
@@ -125,71 +324,84 @@ static void qvm_decompile_functions(qvm_t *qvm)
     for (unsigned int i = 0; i < qvm->functions_count; i++) {
         // get the current function
         func = &qvm->functions[i];
+        if (!func->selected)
+            continue;
 
-        // print the function header
-        qvm_decompile_function_header(func);
+        // load the function analysis if needed
+        if (!qvm_load_function(qvm, func))
+            continue;
 
-        // print the function code
-        qvm_decompile_function_code(func);
+        // print the function header and code
+        qvm_decompile_function(file, func);
 
         // print an end of line after the functions
-        file_print(qvm->output_file, "\n");
+        file_print(file, "\n");
+
+        // free the function analysis if needed
+        qvm_unload_function(qvm, func);
     }
 }
 
-static void qvm_decompile_function_header(qvm_function_t *func)
+void qvm_decompile_function(file_t *file, qvm_function_t *func)
 {
-    qvm_function_list_t *list;
+    // print the function header
+    qvm_decompile_function_header(file, func);
+
+    // print the function code
+    qvm_decompile_function_code(file, func);
+}
 
+static void qvm_decompile_function_header(file_t *file, qvm_function_t *func)
+{
     // print header format
-    file_print(func->qvm->output_file, "/*\n");
-    file_print(func->qvm->output_file, "=================\n");
+    file_print(file, "/*\n");
+    file_print(file, "=================\n");
 
     // print function name
-    file_print(func->qvm->output_file, "%s\n\n", func->name);
+    file_print(file, "%s\n\n", func->name);
 
     // print function address
-    file_print(func->qvm->output_file, "Address: 0x%x\n", func->address);
+    file_print(file, "Address: 0x%x\n", func->address);
 
     // print function stack size
-    file_print(func->qvm->output_file, "Stack Size: 0x%x\n", func->stack_size);
+    file_print(file, "Stack Size: 0x%x\n", func->stack_size);
 
     // print function opcodes count
-    file_print(func->qvm->output_file, "Opcodes Size: 0x%x\n", func->op_size);
+    file_print(file, "Opcodes Size: 0x%x\n", func->op_size);
 
     // TODO: print function opblocks count
 
     // print function locals count
-    file_print(func->qvm->output_file, "Locals Count: %i\n\n", func->locals_count);
+    file_print(file, "Locals Count: %i\n\n", func->locals_count);
 
     // print function calls
-    if (func->calls) {
-        file_print(func->qvm->output_file, "Calls: ");
-        for (list = func->calls; list; list = list->next) {
-            if (list != func->calls)
-                file_print(func->qvm->output_file, ", ");
-            file_print(func->qvm->output_file, "%s", list->function->name);
+    if (func->calls.count) {
+        file_print(file, "Calls: ");
+        for (unsigned int i = 0; i < func->calls.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "%s", func->calls.functions[i]->name);
         }
-        file_print(func->qvm->output_file, "\n");
+        file_print(file, "\n");
     }
 
     // print function called by
-    if (func->called_by) {
-        file_print(func->qvm->output_file, "Called by: ");
-        for (list = func->called_by; list; list = list->next) {
-            if (list != func->called_by)
-                file_print(func->qvm->output_file, ", ");
-            file_print(func->qvm->output_file, "%s", list->function->name);
+    if (func->called_by.count) {
+        file_print(file, "Called by: ");
+        for (unsigned int i = 0; i < func->called_by.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "%s", func->called_by.functions[i]->name);
         }
-        file_print(func->qvm->output_file, "\n");
+        file_print(file, "\n");
     }
 
     // print header format
-    file_print(func->qvm->output_file, "=================\n");
-    file_print(func->qvm->output_file, "*/\n");
+    file_print(file, "=================\n");
+    file_print(file, "*/\n");
 }
 
-static void qvm_decompile_function_code(qvm_function_t *func)
+static void qvm_decompile_function_code(file_t *file, qvm_function_t *func)
 {
     qvm_opblock_t   *opb;
 
@@ -199,46 +411,46 @@ static void qvm_decompile_function_code(qvm_function_t *func)
         if (opb->opcodes_count) {
             // print the tab if needed
             if (opb->info->id != OPB_FUNC_ENTER && opb->info->id != OPB_FUNC_LEAVE && opb->info->id != OPB_FUNC_ARG)
-                file_print(func->qvm->output_file, "\t");
+                file_print(file, "\t");
                 
             // print the decompiled opblock
-            opb_print(func->qvm->output_file, opb);
+            opb_print(file, opb);
 
             // print the semicolon if needed
             if (opb->info->id != OPB_FUNC_ENTER && opb->info->id != OPB_FUNC_LEAVE && opb->info->id != OPB_FUNC_ARG)
-                file_print(func->qvm->output_file, ";");
+                file_print(file, ";");
 
             // print an end of line after the opblock code
-            file_print(func->qvm->output_file, "\n");
+            file_print(file, "\n");
         }
 
         // if the opblock is a jumppoint
         if (opb->info->id == OPB_JUMP_POINT) {
             // print the jumppoint code
-            opb_print(func->qvm->output_file, opb);
+            opb_print(file, opb);
 
             // print an end of line after the jumppoint
-            file_print(func->qvm->output_file, "\n");
+            file_print(file, "\n");
         }
 
         // if the opblock is a function enter
         if (opb->info->id == OPB_FUNC_ENTER)
-            qvm_decompile_function_locals(func);
+            qvm_decompile_function_locals(file, func);
     }
 }
 
-static void qvm_decompile_function_locals(qvm_function_t *func)
+static void qvm_decompile_function_locals(file_t *file, qvm_function_t *func)
 {
     qvm_variable_t  *var;
 
     // print all locals
     for (var = func->locals; var && var->address < func->stack_size; var = var->next) {
-        file_print(func->qvm->output_file, "\t%s%s", var->type->pretty_name, var->name);
+        file_print(file, "\t%s%s", var->type->pretty_name, var->name);
         if (var->type->flags & TF_ARRAY)
-            file_print(func->qvm->output_file, "[%u]", var->size);
-        file_print(func->qvm->output_file, ";\n");
+            file_print(file, "[%u]", var->size);
+        file_print(file, ";\n");
     }
 
     // print an end of line after the variables
-    file_print(func->qvm->output_file, "\n");
+    file_print(file, "\n");
 }
@@ -0,0 +1,758 @@
+#include "qvmd.h"
+
+#define DIFF_NONE   (unsigned int)-1
+
+/*
+    The diff loads an old and a new build of a qvm and matches their
+    functions and globals to report what changed. The functions are matched
+    by name when a map or the signatures named them, then by fingerprint,
+    the functions with the same fingerprint in the address order if both
+    builds have as many. Each matched function then matches its callees and
+    callers at the same position of the calls graph, and the globals its
+    opcodes use at the same place. The globals left are matched by content,
+    and the items left between two matched ones are matched in order if
+    both builds have as many there.
+    The matches only need sorts and one pass on each function, so the diff
+    stays close to linear. A matched function is modified if its opcodes
+    differ once compared without the addresses, if its callees or the
+    globals its addresses point to aren't the matched ones, and its delta
+    is the range between the opcodes common to both ends.
+*/
+
+typedef enum {
+    DIFF_MATCH_ENTRY,
+    DIFF_MATCH_NAME,
+    DIFF_MATCH_HASH,
+    DIFF_MATCH_CALLS,
+    DIFF_MATCH_CODE,
+    DIFF_MATCH_CONTENT,
+    DIFF_MATCH_LAYOUT,
+    DIFF_MATCH_MAX
+} qvm_diff_match_e;
+
+typedef enum {
+    DIFF_UNCHANGED,
+    DIFF_MOVED,
+    DIFF_MODIFIED,
+    DIFF_ADDED,
+    DIFF_REMOVED,
+    DIFF_MAX
+} qvm_diff_change_e;
+
+typedef struct {
+    unsigned long long  hash;
+    unsigned int        match;
+    qvm_diff_match_e    reason;
+    qvm_diff_change_e   change;
+} qvm_diff_item_t;
+
+typedef struct {
+    char                *name;
+    unsigned long long  hash;
+    unsigned int        address;
+    unsigned int        index;
+} qvm_diff_key_t;
+
+typedef struct {
+    opt_module_t        *module;
+    qvm_t               *qvm;
+    qvm_diff_item_t     *functions;
+    qvm_variable_t      **globals;
+    qvm_diff_item_t     *globals_items;
+    unsigned int        globals_count;
+    qvm_diff_key_t      *keys;
+    unsigned int        keys_count;
+} qvm_diff_side_t;
+
+typedef struct {
+    opt_t               *opt;
+    qvm_diff_side_t     sides[2];
+    unsigned int        *worklist;
+    unsigned int        worklist_count;
+    unsigned int        counts[2][DIFF_MAX];
+} qvm_diff_t;
+
+int                 qvm_diff(opt_t *opt);
+static int          qvm_diff_job(void *context, unsigned int index);
+static int          qvm_diff_alloc(qvm_diff_side_t *side);
+static void         qvm_diff_free(qvm_diff_side_t *side);
+static void         qvm_diff_match_functions(qvm_diff_t *diff);
+static void         qvm_diff_match_calls(qvm_diff_t *diff, qvm_function_array_t *old_array, qvm_function_array_t *new_array);
+static void         qvm_diff_match_globals(qvm_diff_t *diff);
+static void         qvm_diff_match_code(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func);
+static void         qvm_diff_match_global(qvm_diff_t *diff, unsigned int old_address, unsigned int new_address);
+static void         qvm_diff_match_keys(qvm_diff_item_t *old_items, qvm_diff_side_t *old_side, qvm_diff_item_t *new_items, qvm_diff_side_t *new_side, qvm_diff_match_e reason);
+static void         qvm_diff_match_layout(qvm_diff_item_t *old_items, unsigned int old_count, qvm_diff_item_t *new_items, unsigned int new_count);
+static void         qvm_diff_pair(qvm_diff_item_t *old_item, unsigned int old_index, qvm_diff_item_t *new_item, unsigned int new_index, qvm_diff_match_e reason);
+static void         qvm_diff_classify(qvm_diff_t *diff);
+static int          qvm_diff_same_calls(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func);
+static int          qvm_diff_same_globals(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func);
+static int          qvm_diff_same_opcode(qvm_function_t *old_func, unsigned int old_address, qvm_function_t *new_func, unsigned int new_address);
+static void         qvm_diff_common(qvm_function_t *old_func, qvm_function_t *new_func, unsigned int *prefix, unsigned int *suffix);
+static unsigned int qvm_diff_find_global(qvm_diff_side_t *side, unsigned int address);
+static int          qvm_diff_global_named(qvm_t *qvm, qvm_variable_t *var);
+static int          qvm_diff_report(qvm_diff_t *diff);
+static void         qvm_diff_report_functions(file_t *file, qvm_diff_t *diff, qvm_diff_change_e change);
+static void         qvm_diff_report_globals(file_t *file, qvm_diff_t *diff, qvm_diff_change_e change);
+static int          qvm_diff_compare_keys(const void *a, const void *b);
+
+static char *qvm_diff_matches_names[DIFF_MATCH_MAX] = {
+    "entry",
+    "name",
+    "hash",
+    "calls",
+    "code",
+    "content",
+    "layout"
+};
+
+int qvm_diff(opt_t *opt)
+{
+    qvm_diff_t  diff;
+    int         success;
+
+    // load the old and the new qvm concurrently
+    memset(&diff, 0, sizeof(diff));
+    diff.opt = opt;
+    diff.sides[0].module = &opt->modules[0];
+    diff.sides[1].module = &opt->modules[1];
+    success = pool_run(2, opt->threads_count, &diff, qvm_diff_job);
+
+    // allocate the matches
+    if (success && (!qvm_diff_alloc(&diff.sides[0]) || !qvm_diff_alloc(&diff.sides[1]) ||
+        !(diff.worklist = malloc(sizeof(*diff.worklist) * (diff.sides[0].qvm->functions_count + 1))))) {
+        printf("Error: Couldn't allocate diff matches.\n");
+        success = 0;
+    }
+
+    // match the functions, then the globals they use, and report the changes
+    if (success) {
+        qvm_diff_match_functions(&diff);
+        qvm_diff_match_globals(&diff);
+        qvm_diff_classify(&diff);
+        success = qvm_diff_report(&diff);
+    }
+
+    // free the matches and the qvms
+    free(diff.worklist);
+    for (unsigned int i = 0; i < 2; i++) {
+        qvm_diff_free(&diff.sides[i]);
+        if (diff.sides[i].qvm)
+            qvm_free(diff.sides[i].qvm);
+    }
+
+    // return the status
+    return success;
+}
+
+static int qvm_diff_job(void *context, unsigned int index)
+{
+    qvm_diff_t      *diff = context;
+    qvm_diff_side_t *side = &diff->sides[index];
+
+    // load the qvm
+    if (!(side->qvm = qvm_load(side->module->qvm_filename, side->module->map_filename, diff->opt)))
+        return 0;
+
+    // success
+    return 1;
+}
+
+static int qvm_diff_alloc(qvm_diff_side_t *side)
+{
+    qvm_t           *qvm = side->qvm;
+    qvm_variable_t  *var;
+    unsigned int    count = qvm->functions_count + qvm->globals_count;
+
+    // allocate the functions and globals matches, the globals array and the sort keys
+    if (!(side->functions = malloc(sizeof(*side->functions) * (qvm->functions_count + 1))) ||
+        !(side->globals_items = malloc(sizeof(*side->globals_items) * (qvm->globals_count + 1))) ||
+        !(side->globals = malloc(sizeof(*side->globals) * (qvm->globals_count + 1))) ||
+        !(side->keys = malloc(sizeof(*side->keys) * (count + 1))))
+        return 0;
+
+    // nothing is matched yet, the functions are hashed without the addresses
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        side->functions[i].hash = func_fingerprint(&qvm->functions[i]);
+        side->functions[i].match = DIFF_NONE;
+        side->functions[i].change = DIFF_UNCHANGED;
+    }
+
+    // the globals list is sorted by address, the data and literals are hashed by content
+    for (var = qvm->globals; var; var = var->next) {
+        side->globals[side->globals_count] = var;
+        side->globals_items[side->globals_count].hash = 0;
+        side->globals_items[side->globals_count].match = DIFF_NONE;
+        side->globals_items[side->globals_count].change = DIFF_UNCHANGED;
+        if (var->content && var->status != VS_BSS) {
+            side->globals_items[side->globals_count].hash = hash_data(HASH_INIT, &var->status, sizeof(var->status));
+            side->globals_items[side->globals_count].hash = hash_data(side->globals_items[side->globals_count].hash, var->content, var->size);
+        }
+        side->globals_count++;
+    }
+
+    // success
+    return 1;
+}
+
+static void qvm_diff_free(qvm_diff_side_t *side)
+{
+    // free the matches, the globals array and the sort keys
+    free(side->functions);
+    free(side->globals_items);
+    free(side->globals);
+    free(side->keys);
+}
+
+static void qvm_diff_match_functions(qvm_diff_t *diff)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    qvm_diff_side_t *side;
+    qvm_function_t  *func;
+    unsigned int    match;
+
+    // vmMain is always the first function
+    if (old_side->qvm->functions_count && new_side->qvm->functions_count)
+        qvm_diff_pair(&old_side->functions[0], 0, &new_side->functions[0], 0, DIFF_MATCH_ENTRY);
+
+    // match the functions by name, the default names depend on the addresses
+    for (unsigned int s = 0; s < 2; s++) {
+        side = &diff->sides[s];
+        side->keys_count = 0;
+        for (unsigned int i = 0; i < side->qvm->functions_count; i++) {
+            func = &side->qvm->functions[i];
+            if (side->functions[i].match != DIFF_NONE || func_is_default(func))
+                continue;
+            side->keys[side->keys_count++] = (qvm_diff_key_t){ func->name, 0, func->address, i };
+        }
+    }
+    qvm_diff_match_keys(old_side->functions, old_side, new_side->functions, new_side, DIFF_MATCH_NAME);
+
+    // match the functions left by fingerprint
+    for (unsigned int s = 0; s < 2; s++) {
+        side = &diff->sides[s];
+        side->keys_count = 0;
+        for (unsigned int i = 0; i < side->qvm->functions_count; i++)
+            if (side->functions[i].match == DIFF_NONE)
+                side->keys[side->keys_count++] = (qvm_diff_key_t){ "", side->functions[i].hash, side->qvm->functions[i].address, i };
+    }
+    qvm_diff_match_keys(old_side->functions, old_side, new_side->functions, new_side, DIFF_MATCH_HASH);
+
+    // start the calls graph walk from all the matched functions
+    diff->worklist_count = 0;
+    for (unsigned int i = 0; i < old_side->qvm->functions_count; i++)
+        if (old_side->functions[i].match != DIFF_NONE)
+            diff->worklist[diff->worklist_count++] = i;
+
+    // match the callees and the callers at the same position, the new matches are walked too
+    while (diff->worklist_count) {
+        func = &old_side->qvm->functions[diff->worklist[--diff->worklist_count]];
+        match = old_side->functions[func->id].match;
+        qvm_diff_match_calls(diff, &func->calls, &new_side->qvm->functions[match].calls);
+        qvm_diff_match_calls(diff, &func->called_by, &new_side->qvm->functions[match].called_by);
+    }
+
+    // match the functions left between the matched ones
+    qvm_diff_match_layout(old_side->functions, old_side->qvm->functions_count, new_side->functions, new_side->qvm->functions_count);
+}
+
+static void qvm_diff_match_calls(qvm_diff_t *diff, qvm_function_array_t *old_array, qvm_function_array_t *new_array)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    unsigned int    old_id;
+    unsigned int    new_id;
+
+    // the positions only match if the arrays have the same size
+    if (old_array->count != new_array->count)
+        return;
+
+    // match the functions at the same position, the syscalls don't need it
+    for (unsigned int i = 0; i < old_array->count; i++) {
+        old_id = old_array->functions[i]->id;
+        new_id = new_array->functions[i]->id;
+        if (old_id >= old_side->qvm->functions_count || new_id >= new_side->qvm->functions_count ||
+            old_side->functions[old_id].match != DIFF_NONE || new_side->functions[new_id].match != DIFF_NONE)
+            continue;
+        qvm_diff_pair(&old_side->functions[old_id], old_id, &new_side->functions[new_id], new_id, DIFF_MATCH_CALLS);
+        diff->worklist[diff->worklist_count++] = old_id;
+    }
+}
+
+static void qvm_diff_match_globals(qvm_diff_t *diff)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    qvm_diff_side_t *side;
+    qvm_variable_t  *var;
+    unsigned int    match;
+
+    // match the globals by name, the default names depend on the addresses
+    for (unsigned int s = 0; s < 2; s++) {
+        side = &diff->sides[s];
+        side->keys_count = 0;
+        for (unsigned int i = 0; i < side->globals_count; i++) {
+            var = side->globals[i];
+            if (qvm_diff_global_named(side->qvm, var))
+                side->keys[side->keys_count++] = (qvm_diff_key_t){ var->name, 0, var->address, i };
+        }
+    }
+    qvm_diff_match_keys(old_side->globals_items, old_side, new_side->globals_items, new_side, DIFF_MATCH_NAME);
+
+    // match the globals used at the same place by the matched functions
+    for (unsigned int i = 0; i < old_side->qvm->functions_count; i++)
+        if ((match = old_side->functions[i].match) != DIFF_NONE)
+            qvm_diff_match_code(diff, &old_side->qvm->functions[i], &new_side->qvm->functions[match]);
+
+    // match the data and literals left by content
+    for (unsigned int s = 0; s < 2; s++) {
+        side = &diff->sides[s];
+        side->keys_count = 0;
+        for (unsigned int i = 0; i < side->globals_count; i++)
+            if (side->globals_items[i].match == DIFF_NONE && side->globals_items[i].hash)
+                side->keys[side->keys_count++] = (qvm_diff_key_t){ "", side->globals_items[i].hash, side->globals[i]->address, i };
+    }
+    qvm_diff_match_keys(old_side->globals_items, old_side, new_side->globals_items, new_side, DIFF_MATCH_CONTENT);
+
+    // match the globals left between the matched ones
+    qvm_diff_match_layout(old_side->globals_items, old_side->globals_count, new_side->globals_items, new_side->globals_count);
+}
+
+static void qvm_diff_match_code(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func)
+{
+    unsigned int    prefix;
+    unsigned int    suffix;
+
+    // only the opcodes common to both functions are at the same place
+    qvm_diff_common(old_func, new_func, &prefix, &suffix);
+
+    // match the globals used by the common opcodes
+    for (unsigned int i = 0; i < prefix; i++)
+        qvm_diff_match_global(diff, old_func->address + i, new_func->address + i);
+    for (unsigned int i = 1; i <= suffix; i++)
+        qvm_diff_match_global(diff, old_func->address + old_func->op_size - i, new_func->address + new_func->op_size - i);
+}
+
+static void qvm_diff_match_global(qvm_diff_t *diff, unsigned int old_address, unsigned int new_address)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    qvm_opcode_t    *old_op = &old_side->qvm->opcodes[old_address];
+    qvm_opcode_t    *new_op = &new_side->qvm->opcodes[new_address];
+    unsigned int    old_index;
+    unsigned int    new_index;
+
+    // check if both opcodes take a global address
+    if (!old_op->global || !new_op->global)
+        return;
+
+    // find the globals pointed to, at the same offset
+    if ((old_index = qvm_diff_find_global(old_side, old_op->value)) == DIFF_NONE ||
+        (new_index = qvm_diff_find_global(new_side, new_op->value)) == DIFF_NONE ||
+        old_op->value - old_side->globals[old_index]->address != new_op->value - new_side->globals[new_index]->address)
+        return;
+
+    // match them if they aren't already
+    if (old_side->globals_items[old_index].match == DIFF_NONE && new_side->globals_items[new_index].match == DIFF_NONE)
+        qvm_diff_pair(&old_side->globals_items[old_index], old_index, &new_side->globals_items[new_index], new_index, DIFF_MATCH_CODE);
+}
+
+static void qvm_diff_match_keys(qvm_diff_item_t *old_items, qvm_diff_side_t *old_side, qvm_diff_item_t *new_items, qvm_diff_side_t *new_side, qvm_diff_match_e reason)
+{
+    qvm_diff_key_t  *old_key;
+    qvm_diff_key_t  *new_key;
+    unsigned int    old_count;
+    unsigned int    new_count;
+    unsigned int    i = 0;
+    unsigned int    j = 0;
+    int             cmp;
+
+    // sort the keys of both sides, then by address
+    qsort(old_side->keys, old_side->keys_count, sizeof(*old_side->keys), qvm_diff_compare_keys);
+    qsort(new_side->keys, new_side->keys_count, sizeof(*new_side->keys), qvm_diff_compare_keys);
+
+    // browse the groups of keys of both sides together
+    while (i < old_side->keys_count && j < new_side->keys_count) {
+        old_key = &old_side->keys[i];
+        new_key = &new_side->keys[j];
+
+        // skip the groups found on one side only
+        if (old_key->hash != new_key->hash)
+            cmp = old_key->hash < new_key->hash ? -1 : 1;
+        else
+            cmp = strcmp(old_key->name, new_key->name);
+        if (cmp) {
+            if (cmp < 0)
+                i++;
+            else
+                j++;
+            continue;
+        }
+
+        // count the group on each side
+        for (old_count = 1; i + old_count < old_side->keys_count && old_key[old_count].hash == old_key->hash && !strcmp(old_key[old_count].name, old_key->name); old_count++);
+        for (new_count = 1; j + new_count < new_side->keys_count && new_key[new_count].hash == new_key->hash && !strcmp(new_key[new_count].name, new_key->name); new_count++);
+
+        // the groups of the same size are matched in the address order
+        if (old_count == new_count)
+            for (unsigned int k = 0; k < old_count; k++)
+                qvm_diff_pair(&old_items[old_key[k].index], old_key[k].index, &new_items[new_key[k].index], new_key[k].index, reason);
+        i += old_count;
+        j += new_count;
+    }
+}
+
+static void qvm_diff_match_layout(qvm_diff_item_t *old_items, unsigned int old_count, qvm_diff_item_t *new_items, unsigned int new_count)
+{
+    unsigned int    old_start = 0;
+    unsigned int    new_start = 0;
+    unsigned int    new_end;
+    unsigned int    count;
+    unsigned int    k;
+
+    // browse the runs of old items not matched, up to each matched one
+    for (unsigned int i = 0; i <= old_count; i++) {
+        if (i < old_count && old_items[i].match == DIFF_NONE)
+            continue;
+        new_end = i < old_count ? old_items[i].match : new_count;
+
+        // the new run must be as long and not matched either, else the items moved
+        count = i - old_start;
+        if (new_end >= new_start && new_end - new_start == count) {
+            for (k = 0; k < count && new_items[new_start + k].match == DIFF_NONE; k++);
+            if (k == count)
+                for (k = 0; k < count; k++)
+                    qvm_diff_pair(&old_items[old_start + k], old_start + k, &new_items[new_start + k], new_start + k, DIFF_MATCH_LAYOUT);
+        }
+
+        // the next runs start after the matched items
+        old_start = i + 1;
+        if (new_end >= new_start)
+            new_start = new_end + 1;
+    }
+}
+
+static void qvm_diff_pair(qvm_diff_item_t *old_item, unsigned int old_index, qvm_diff_item_t *new_item, unsigned int new_index, qvm_diff_match_e reason)
+{
+    // link both items together
+    old_item->match = new_index;
+    old_item->reason = reason;
+    new_item->match = old_index;
+    new_item->reason = reason;
+}
+
+static void qvm_diff_classify(qvm_diff_t *diff)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    qvm_diff_item_t *item;
+    qvm_function_t  *old_func;
+    qvm_function_t  *new_func;
+    qvm_variable_t  *old_var;
+    qvm_variable_t  *new_var;
+
+    // the old functions not matched are removed
+    for (unsigned int i = 0; i < old_side->qvm->functions_count; i++)
+        if (old_side->functions[i].match == DIFF_NONE) {
+            old_side->functions[i].change = DIFF_REMOVED;
+            diff->counts[0][DIFF_REMOVED]++;
+        }
+
+    // the new functions not matched are added, the others are modified, moved or unchanged
+    for (unsigned int i = 0; i < new_side->qvm->functions_count; i++) {
+        item = &new_side->functions[i];
+        if (item->match == DIFF_NONE)
+            item->change = DIFF_ADDED;
+        else {
+            old_func = &old_side->qvm->functions[item->match];
+            new_func = &new_side->qvm->functions[i];
+            if (old_side->functions[item->match].hash != item->hash || !qvm_diff_same_calls(diff, old_func, new_func) ||
+                !qvm_diff_same_globals(diff, old_func, new_func))
+                item->change = DIFF_MODIFIED;
+            else if (old_func->address != new_func->address)
+                item->change = DIFF_MOVED;
+            else
+                item->change = DIFF_UNCHANGED;
+        }
+        diff->counts[0][item->change]++;
+    }
+
+    // the old globals not matched are removed
+    for (unsigned int i = 0; i < old_side->globals_count; i++)
+        if (old_side->globals_items[i].match == DIFF_NONE) {
+            old_side->globals_items[i].change = DIFF_REMOVED;
+            diff->counts[1][DIFF_REMOVED]++;
+        }
+
+    // the new globals not matched are added, the others are modified, moved or unchanged
+    for (unsigned int i = 0; i < new_side->globals_count; i++) {
+        item = &new_side->globals_items[i];
+        if (item->match == DIFF_NONE)
+            item->change = DIFF_ADDED;
+        else {
+            old_var = old_side->globals[item->match];
+            new_var = new_side->globals[i];
+            if (old_var->size != new_var->size || old_var->status != new_var->status ||
+                (old_var->status != VS_BSS && old_var->content && new_var->content && memcmp(old_var->content, new_var->content, new_var->size)))
+                item->change = DIFF_MODIFIED;
+            else if (old_var->address != new_var->address)
+                item->change = DIFF_MOVED;
+            else
+                item->change = DIFF_UNCHANGED;
+        }
+        diff->counts[1][item->change]++;
+    }
+}
+
+static int qvm_diff_same_calls(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func)
+{
+    qvm_function_t  *old_callee;
+    qvm_function_t  *new_callee;
+
+    // the functions must call as many functions
+    if (old_func->calls.count != new_func->calls.count)
+        return 0;
+
+    // each callee must be the matched one, or the same syscall
+    for (unsigned int i = 0; i < old_func->calls.count; i++) {
+        old_callee = old_func->calls.functions[i];
+        new_callee = new_func->calls.functions[i];
+        if (old_callee->id >= diff->sides[0].qvm->functions_count || new_callee->id >= diff->sides[1].qvm->functions_count) {
+            if (old_callee->id < diff->sides[0].qvm->functions_count || new_callee->id < diff->sides[1].qvm->functions_count ||
+                old_callee->address != new_callee->address)
+                return 0;
+        }
+        else if (diff->sides[0].functions[old_callee->id].match != new_callee->id)
+            return 0;
+    }
+
+    // the callees are the same
+    return 1;
+}
+
+static int qvm_diff_same_globals(qvm_diff_t *diff, qvm_function_t *old_func, qvm_function_t *new_func)
+{
+    qvm_diff_side_t *old_side = &diff->sides[0];
+    qvm_diff_side_t *new_side = &diff->sides[1];
+    qvm_opcode_t    *old_op;
+    qvm_opcode_t    *new_op;
+    unsigned int    old_index;
+    unsigned int    match;
+
+    // the functions with the same fingerprint have the same opcodes
+    if (old_func->op_size != new_func->op_size)
+        return 0;
+
+    // the global addresses must point in the matched globals at the same offset, the globals not matched can't be compared
+    for (unsigned int i = 0; i < old_func->op_size; i++) {
+        old_op = &old_side->qvm->opcodes[old_func->address + i];
+        new_op = &new_side->qvm->opcodes[new_func->address + i];
+        if (old_op->global != new_op->global)
+            return 0;
+        if (!old_op->global || (old_index = qvm_diff_find_global(old_side, old_op->value)) == DIFF_NONE ||
+            (match = old_side->globals_items[old_index].match) == DIFF_NONE)
+            continue;
+        if (new_op->value - new_side->globals[match]->address != old_op->value - old_side->globals[old_index]->address)
+            return 0;
+    }
+
+    // the global addresses are the same
+    return 1;
+}
+
+static int qvm_diff_same_opcode(qvm_function_t *old_func, unsigned int old_address, qvm_function_t *new_func, unsigned int new_address)
+{
+    int     old_value;
+    int     new_value;
+    int     old_kept;
+    int     new_kept;
+
+    // compare the opcodes and their values without the addresses
+    if (old_func->qvm->opcodes[old_address].info->id != new_func->qvm->opcodes[new_address].info->id)
+        return 0;
+    old_kept = func_opcode_value(old_func, old_address, &old_value);
+    new_kept = func_opcode_value(new_func, new_address, &new_value);
+    return old_kept == new_kept && (!old_kept || old_value == new_value);
+}
+
+static void qvm_diff_common(qvm_function_t *old_func, qvm_function_t *new_func, unsigned int *prefix, unsigned int *suffix)
+{
+    unsigned int    size = old_func->op_size < new_func->op_size ? old_func->op_size : new_func->op_size;
+
+    // count the same opcodes from the start
+    for (*prefix = 0; *prefix < size && qvm_diff_same_opcode(old_func, old_func->address + *prefix, new_func, new_func->address + *prefix); (*prefix)++);
+
+    // count the same opcodes from the end, before the start ones
+    for (*suffix = 0; *prefix + *suffix < size &&
+        qvm_diff_same_opcode(old_func, old_func->address + old_func->op_size - *suffix - 1, new_func, new_func->address + new_func->op_size - *suffix - 1); (*suffix)++);
+}
+
+static unsigned int qvm_diff_find_global(qvm_diff_side_t *side, unsigned int address)
+{
+    unsigned int    start = 0;
+    unsigned int    end = side->globals_count;
+    unsigned int    middle;
+
+    // find the last global starting before the address
+    while (start < end) {
+        middle = start + (end - start) / 2;
+        if (side->globals[middle]->address <= address)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+
+    // check if the address is inside it
+    if (!start || address >= side->globals[start - 1]->address + side->globals[start - 1]->size)
+        return DIFF_NONE;
+    return start - 1;
+}
+
+static int qvm_diff_global_named(qvm_t *qvm, qvm_variable_t *var)
+{
+    qvm_variable_t  def;
+
+    // compare the global name to its default one
+    def = *var;
+    var_rename_default(qvm, NULL, &def);
+    return strcmp(def.name, var->name) != 0;
+}
+
+static int qvm_diff_report(qvm_diff_t *diff)
+{
+    file_t          *file;
+    char            *filename = diff->opt->output_filename;
+    char            *changes[DIFF_MAX] = { "unchanged", "moved", "modified", "added", "removed" };
+    unsigned int    functions_changed = diff->counts[0][DIFF_MODIFIED] + diff->counts[0][DIFF_ADDED] + diff->counts[0][DIFF_REMOVED];
+    unsigned int    globals_changed = diff->counts[1][DIFF_MODIFIED] + diff->counts[1][DIFF_ADDED] + diff->counts[1][DIFF_REMOVED];
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Reporting diff to %s...Error: Couldn't create file.\n", filename);
+        return 0;
+    }
+
+    // print the report header
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tOld: %s\n", diff->sides[0].module->qvm_filename);
+    file_print(file, "\tNew: %s\n", diff->sides[1].module->qvm_filename);
+    file_print(file, "\tFunctions:");
+    for (unsigned int i = 0; i < DIFF_MAX; i++)
+        file_print(file, "%s %u %s", i ? "," : "", diff->counts[0][i], changes[i]);
+    file_print(file, "\n\tGlobals:");
+    for (unsigned int i = 0; i < DIFF_MAX; i++)
+        file_print(file, "%s %u %s", i ? "," : "", diff->counts[1][i], changes[i]);
+    file_print(file, "\n*/\n\n");
+
+    // print the changed functions
+    file_print(file, "// modified functions: old name, new name, old address, new address, match, opcodes, delta\n");
+    qvm_diff_report_functions(file, diff, DIFF_MODIFIED);
+    file_print(file, "\n// moved functions: old name, new name, old address, new address, match\n");
+    qvm_diff_report_functions(file, diff, DIFF_MOVED);
+    file_print(file, "\n// added functions: name, address, opcodes\n");
+    qvm_diff_report_functions(file, diff, DIFF_ADDED);
+    file_print(file, "\n// removed functions: name, address, opcodes\n");
+    qvm_diff_report_functions(file, diff, DIFF_REMOVED);
+
+    // print the changed globals
+    file_print(file, "\n// modified globals: old name, new name, old address, new address, match, size\n");
+    qvm_diff_report_globals(file, diff, DIFF_MODIFIED);
+    file_print(file, "\n// moved globals: old name, new name, old address, new address, match\n");
+    qvm_diff_report_globals(file, diff, DIFF_MOVED);
+    file_print(file, "\n// added globals: name, address, size\n");
+    qvm_diff_report_globals(file, diff, DIFF_ADDED);
+    file_print(file, "\n// removed globals: name, address, size\n");
+    qvm_diff_report_globals(file, diff, DIFF_REMOVED);
+
+    // free the created file
+    file_free(file);
+
+    printf("Reporting diff to %s...Success: %u functions and %u globals changed.\n", filename, functions_changed, globals_changed);
+
+    // success
+    return 1;
+}
+
+static void qvm_diff_report_functions(file_t *file, qvm_diff_t *diff, qvm_diff_change_e change)
+{
+    qvm_diff_side_t *side = &diff->sides[change == DIFF_REMOVED ? 0 : 1];
+    qvm_diff_item_t *item;
+    qvm_function_t  *old_func;
+    qvm_function_t  *new_func;
+    unsigned int    prefix;
+    unsigned int    suffix;
+
+    // browse the functions of the side in the address order
+    for (unsigned int i = 0; i < side->qvm->functions_count; i++) {
+        item = &side->functions[i];
+        if (item->change != change)
+            continue;
+
+        // print the functions only in one side
+        if (change == DIFF_ADDED || change == DIFF_REMOVED) {
+            file_print(file, "%s\t0x%x\t%u\n", side->qvm->functions[i].name, side->qvm->functions[i].address, side->qvm->functions[i].op_size);
+            continue;
+        }
+
+        // print the matched functions
+        old_func = &diff->sides[0].qvm->functions[item->match];
+        new_func = &side->qvm->functions[i];
+        file_print(file, "%s\t%s\t0x%x\t0x%x\t%s", old_func->name, new_func->name, old_func->address, new_func->address, qvm_diff_matches_names[item->reason]);
+
+        // print the opcodes delta of the modified ones
+        if (change == DIFF_MODIFIED) {
+            qvm_diff_common(old_func, new_func, &prefix, &suffix);
+            file_print(file, "\t%u -> %u", old_func->op_size, new_func->op_size);
+            if (prefix + suffix < old_func->op_size || prefix + suffix < new_func->op_size)
+                file_print(file, "\t+0x%x: -%u +%u", prefix, old_func->op_size - prefix - suffix, new_func->op_size - prefix - suffix);
+            else
+                file_print(file, qvm_diff_same_calls(diff, old_func, new_func) ? "\tglobals" : "\tcalls");
+        }
+        file_print(file, "\n");
+    }
+}
+
+static void qvm_diff_report_globals(file_t *file, qvm_diff_t *diff, qvm_diff_change_e change)
+{
+    qvm_diff_side_t *side = &diff->sides[change == DIFF_REMOVED ? 0 : 1];
+    qvm_diff_item_t *item;
+    qvm_variable_t  *old_var;
+    qvm_variable_t  *new_var;
+
+    // browse the globals of the side in the address order
+    for (unsigned int i = 0; i < side->globals_count; i++) {
+        item = &side->globals_items[i];
+        if (item->change != change)
+            continue;
+
+        // print the globals only in one side
+        if (change == DIFF_ADDED || change == DIFF_REMOVED) {
+            file_print(file, "%s\t0x%x\t%u\n", side->globals[i]->name, side->globals[i]->address, side->globals[i]->size);
+            continue;
+        }
+
+        // print the matched globals, with the size of the modified ones
+        old_var = diff->sides[0].globals[item->match];
+        new_var = side->globals[i];
+        file_print(file, "%s\t%s\t0x%x\t0x%x\t%s", old_var->name, new_var->name, old_var->address, new_var->address, qvm_diff_matches_names[item->reason]);
+        if (change == DIFF_MODIFIED)
+            file_print(file, "\t%u -> %u", old_var->size, new_var->size);
+        file_print(file, "\n");
+    }
+}
+
+static int qvm_diff_compare_keys(const void *a, const void *b)
+{
+    const qvm_diff_key_t    *ka = a;
+    const qvm_diff_key_t    *kb = b;
+    int                     cmp;
+
+    // compare the hashes, then the names, then the addresses
+    if (ka->hash != kb->hash)
+        return ka->hash < kb->hash ? -1 : 1;
+    if ((cmp = strcmp(ka->name, kb->name)))
+        return cmp;
+    return ka->address < kb->address ? -1 : ka->address > kb->address;
+}
@@ -1,151 +1,298 @@
 #include "qvmd.h"
 
 int             qvm_disassemble(qvm_t *qvm, char *filename);
-static void     qvm_disassemble_header(qvm_t *qvm);
-static void     qvm_disassemble_functions(qvm_t *qvm);
-static void     qvm_disassemble_function_header(qvm_function_t *func);
-static void     qvm_disassemble_function_code(qvm_function_t *func);
-static void     qvm_disassemble_opcode(qvm_opcode_t *op);
+static void     qvm_disassemble_header(file_t *file, qvm_t *qvm);
+static void     qvm_disassemble_functions(file_t *file, qvm_t *qvm);
+static void     qvm_disassemble_function_header(file_t *file, qvm_function_t *func);
+static void     qvm_disassemble_function_code(file_t *file, qvm_function_t *func);
+void            qvm_disassemble_range(file_t *file, qvm_t *qvm, unsigned int start, unsigned int end);
+static void     qvm_disassemble_opcode(file_t *file, qvm_opcode_t *op);
+static void     qvm_disassemble_range_fast(file_t *file, qvm_function_t *func);
+static void     qvm_disassemble_opcode_fast(file_t *file, qvm_function_t *func, qvm_opcode_t *op);
+static char     *qvm_disassemble_call_fast(qvm_t *qvm, unsigned int address, char *trap_name, size_t trap_size);
+static char     *qvm_disassemble_global_fast(qvm_t *qvm, unsigned int address);
 
 int qvm_disassemble(qvm_t *qvm, char *filename)
 {
-    printf("Disassembling QVM to %s...", filename);
+    file_t  *file;
 
     // create the output file
-    if (!(qvm->output_file = file_create(filename)))
+    if (!(file = file_create(filename))) {
+        printf("Disassembling QVM to %s...Error: Couldn't create file.\n", filename);
         return 0;
+    }
 
     // print the header in file
-    qvm_disassemble_header(qvm);
+    qvm_disassemble_header(file, qvm);
 
     // print the function code
-    qvm_disassemble_functions(qvm);
+    qvm_disassemble_functions(file, qvm);
 
     // free the created file
-    file_free(qvm->output_file);
+    file_free(file);
 
-    printf("Success.\n");
+    printf("Disassembling QVM to %s...Success.\n", filename);
 
     // success
     return 1;
 }
 
-static void qvm_disassemble_header(qvm_t *qvm)
+static void qvm_disassemble_header(file_t *file, qvm_t *qvm)
 {
-    file_print(qvm->output_file, "/*\n");
-    file_print(qvm->output_file, "\tQVM Disassembler " QVMD_VERSION " by zen\n\n");
-    file_print(qvm->output_file, "\tName: %s\n", qvm->file->name);
-    file_print(qvm->output_file, "\tOpcodes Count: %i\n", qvm->header->instructions_count);
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Disassembler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tName: %s\n", qvm->file->name);
+    file_print(file, "\tOpcodes Count: %i\n", qvm->header->instructions_count);
     // TODO: Opblocks Count
-    file_print(qvm->output_file, "\tFunctions Count: %i\n", qvm->functions_count);
-    file_print(qvm->output_file, "\tSyscalls Count: %i\n", qvm->syscalls_count);
-    file_print(qvm->output_file, "\tGlobals Count: %i\n", qvm->globals_count);
-    file_print(qvm->output_file, "\tCalls Restored: %.2f\n", qvm->restored_calls_perc);
-    file_print(qvm->output_file, "*/\n\n");
+    file_print(file, "\tFunctions Count: %i\n", qvm->functions_count);
+
+    // the fast assembly has no analysis to count
+    if (!qvm->fast) {
+        file_print(file, "\tSyscalls Count: %i\n", qvm->syscalls_count);
+        file_print(file, "\tGlobals Count: %i\n", qvm->globals_count);
+        file_print(file, "\tCalls Restored: %.2f\n", qvm->restored_calls_perc);
+    }
+    file_print(file, "*/\n\n");
 }
 
-static void qvm_disassemble_functions(qvm_t *qvm)
+static void qvm_disassemble_functions(file_t *file, qvm_t *qvm)
 {
     qvm_function_t  *func;
+    unsigned int    printed = 0;
 
     // browse all functions
     for (unsigned int i = 0; i < qvm->functions_count; i++) {
         // get the current function
         func = &qvm->functions[i];
+        if (!func->selected)
+            continue;
+
+        // load the function analysis if needed
+        if (!qvm_load_function(qvm, func))
+            continue;
 
         // print the function header
-        qvm_disassemble_function_header(func);
+        qvm_disassemble_function_header(file, func);
 
         // print the function code
-        qvm_disassemble_function_code(func);
+        qvm_disassemble_function_code(file, func);
 
         // print an end of line after the function if needed
-        if (i + 1 < qvm->functions_count)
-            file_print(qvm->output_file, "\n");
+        if (++printed < qvm->selected_count)
+            file_print(file, "\n");
+
+        // free the function analysis if needed
+        qvm_unload_function(qvm, func);
     }
 }
 
-static void qvm_disassemble_function_header(qvm_function_t *func)
+static void qvm_disassemble_function_header(file_t *file, qvm_function_t *func)
 {
-    qvm_function_list_t *list;
-
     // print header format
-    file_print(func->qvm->output_file, "/*\n");
-    file_print(func->qvm->output_file, "=================\n");
+    file_print(file, "/*\n");
+    file_print(file, "=================\n");
 
     // print function name
-    file_print(func->qvm->output_file, "%s\n\n", func->name);
+    file_print(file, "%s\n\n", func->name);
 
     // print function address
-    file_print(func->qvm->output_file, "Address: 0x%x\n", func->address);
+    file_print(file, "Address: 0x%x\n", func->address);
 
     // print function stack size
-    file_print(func->qvm->output_file, "Stack Size: 0x%x\n", func->stack_size);
+    file_print(file, "Stack Size: 0x%x\n", func->stack_size);
 
     // print function opcodes count
-    file_print(func->qvm->output_file, "Opcodes Size: 0x%x\n", func->op_size);
+    file_print(file, "Opcodes Size: 0x%x\n", func->op_size);
+
+    // print function operand stack depth
+    file_print(file, "Operand Stack Depth: %u\n", func->opstack_depth);
 
     // TODO: print function opblocks count
 
-    // print function locals count
-    file_print(func->qvm->output_file, "Locals Count: %i\n\n", func->locals_count);
+    // print function locals count if analyzed
+    if (!func->qvm->fast)
+        file_print(file, "Locals Count: %i\n", func->locals_count);
+    file_print(file, "\n");
 
     // print function calls
-    if (func->calls) {
-        file_print(func->qvm->output_file, "Calls: ");
-        for (list = func->calls; list; list = list->next) {
-            if (list != func->calls)
-                file_print(func->qvm->output_file, ", ");
-            file_print(func->qvm->output_file, "%s", list->function->name);
+    if (func->calls.count) {
+        file_print(file, "Calls: ");
+        for (unsigned int i = 0; i < func->calls.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "%s", func->calls.functions[i]->name);
         }
-        file_print(func->qvm->output_file, "\n");
+        file_print(file, "\n");
     }
 
     // print function called by
-    if (func->called_by) {
-        file_print(func->qvm->output_file, "Called by: ");
-        for (list = func->called_by; list; list = list->next) {
-            if (list != func->called_by)
-                file_print(func->qvm->output_file, ", ");
-            file_print(func->qvm->output_file, "%s", list->function->name);
+    if (func->called_by.count) {
+        file_print(file, "Called by: ");
+        for (unsigned int i = 0; i < func->called_by.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "%s", func->called_by.functions[i]->name);
         }
-        file_print(func->qvm->output_file, "\n");
+        file_print(file, "\n");
+    }
+
+    // print function call sites
+    if (func->xrefs.count) {
+        file_print(file, "Called at: ");
+        for (unsigned int i = 0; i < func->xrefs.count; i++) {
+            if (i)
+                file_print(file, ", ");
+            file_print(file, "0x%x", func->xrefs.xrefs[i].address);
+        }
+        file_print(file, "\n");
     }
 
     // print header format
-    file_print(func->qvm->output_file, "=================\n");
-    file_print(func->qvm->output_file, "*/\n");
+    file_print(file, "=================\n");
+    file_print(file, "*/\n");
+}
+
+static void qvm_disassemble_function_code(file_t *file, qvm_function_t *func)
+{
+    // print all the function opcodes, from the opcodes alone for the fast assembly
+    if (func->qvm->fast)
+        qvm_disassemble_range_fast(file, func);
+    else
+        qvm_disassemble_range(file, func->qvm, func->address, func->address + func->op_size);
 }
 
-static void qvm_disassemble_function_code(qvm_function_t *func)
+void qvm_disassemble_range(file_t *file, qvm_t *qvm, unsigned int start, unsigned int end)
 {
     qvm_jumppoint_t *jmp;
 
-    for (unsigned int i = 0; i < func->op_size; i++) {
+    for (unsigned int i = start; i < end && i < qvm->header->instructions_count; i++) {
         // print the jumppoint if needed
-        if ((jmp = jumppoint_find(func->qvm, func->address + i)))
-            file_print(func->qvm->output_file, "\n%s:\n", jmp->name);
+        if ((jmp = jumppoint_find(qvm, i)))
+            file_print(file, "\n%s:\n", jmp->name);
 
         // print the opcode
-        qvm_disassemble_opcode(&func->qvm->opcodes[func->address + i]);
+        qvm_disassemble_opcode(file, &qvm->opcodes[i]);
     }
 }
 
-static void qvm_disassemble_opcode(qvm_opcode_t *op)
+static void qvm_disassemble_opcode(file_t *file, qvm_opcode_t *op)
 {
     // print the opcode name
-    file_print(op->qvm->output_file, "0x%-6x %s", op->address, op->info->name);
+    file_print(file, "0x%-6x %s", op->address, op->info->name);
 
     // print the opcode parameter if needed
     if (op->opblock->info->id == OPB_FUNC_CALL && op->opblock->function_called)
-        file_print(op->qvm->output_file, " %s", op->opblock->function_called->name);
+        file_print(file, " %s", op->opblock->function_called->name);
     else if (op->opblock->jumppoint && op->info->param_size)
-        file_print(op->qvm->output_file, " %s", op->opblock->jumppoint->name);
+        file_print(file, " %s", op->opblock->jumppoint->name);
     else if (op->opblock->info->id == OPB_GLOBAL_ADR || op->opblock->info->id == OPB_LOCAL_ADR)
-        file_print(op->qvm->output_file, " &%s", op->opblock->variable->name);
+        file_print(file, " &%s", op->opblock->variable->name);
+    else if (op->info->param_size)
+        file_print(file, " 0x%x", op->value);
+
+    // print the end of line
+    file_print(file, "\n");
+}
+
+static void qvm_disassemble_range_fast(file_t *file, qvm_function_t *func)
+{
+    qvm_jumppoint_t *jmp;
+
+    for (unsigned int i = func->address; i < func->address + func->op_size; i++) {
+        // print the jumppoint if needed
+        if ((jmp = jumppoint_find(func->qvm, i)))
+            file_print(file, "\n%s:\n", jmp->name);
+
+        // print the opcode
+        qvm_disassemble_opcode_fast(file, func, &func->qvm->opcodes[i]);
+    }
+}
+
+static void qvm_disassemble_opcode_fast(file_t *file, qvm_function_t *func, qvm_opcode_t *op)
+{
+    qvm_t           *qvm = func->qvm;
+    qvm_opcode_t    *prev = op->address > func->address ? op - 1 : NULL;
+    qvm_opcode_t    *next = op->address + 1 < func->address + func->op_size ? op + 1 : NULL;
+    qvm_jumppoint_t *jmp;
+    char            *name;
+    char            trap_name[64];
+
+    // print the opcode name
+    file_print(file, "0x%-6x %s", op->address, op->info->name);
+
+    // print the function called by a constant address
+    if (op->info->id == OP_CALL) {
+        if (prev && prev->info->id == OP_CONST && (name = qvm_disassemble_call_fast(qvm, prev->value, trap_name, sizeof(trap_name))))
+            file_print(file, " %s", name);
+    }
+
+    // print the argument or local from the function stack size
+    else if (op->info->id == OP_LOCAL) {
+        if ((unsigned int)op->value >= func->stack_size)
+            file_print(file, " &arg_%i", (op->value - func->stack_size - 8) / 4);
+        else
+            file_print(file, " &local_%x", op->value);
+    }
+
+    // print the jumppoint of a jump or a comparison
+    else if (op->info->param_size && (op->info->opblock_id == OPB_COMPARE || (next && next->info->id == OP_JUMP)) && (jmp = jumppoint_find(qvm, op->value)))
+        file_print(file, " %s", jmp->name);
+
+    // print the global named by the map, a constant before a call is an address in the code
+    else if (op->info->id == OP_CONST && !(next && next->info->id == OP_CALL) && (name = qvm_disassemble_global_fast(qvm, op->value)))
+        file_print(file, " &%s", name);
+
+    // print the opcode parameter if needed
     else if (op->info->param_size)
-        file_print(op->qvm->output_file, " 0x%x", op->value);
+        file_print(file, " 0x%x", op->value);
 
     // print the end of line
-    file_print(op->qvm->output_file, "\n");
+    file_print(file, "\n");
+}
+
+static char *qvm_disassemble_call_fast(qvm_t *qvm, unsigned int address, char *trap_name, size_t trap_size)
+{
+    unsigned int    low = 0;
+    unsigned int    high = qvm->functions_count;
+    unsigned int    middle;
+    unsigned int    index;
+
+    // search the function at this address, the functions are sorted by address
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (qvm->functions[middle].address < address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < qvm->functions_count && qvm->functions[low].address == address)
+        return qvm->functions[low].name;
+
+    // a call in the middle of a function has no name
+    if ((int)address >= 0)
+        return NULL;
+
+    // name the syscall from its last map entry if possible, like the analysis
+    for (index = map_find_address(&qvm->map, 1, address); index + 1 < qvm->map.count; index++)
+        if (qvm->map.sorted[index + 1]->section_id != S_CODE || qvm->map.sorted[index + 1]->address != address)
+            break;
+    if (index < qvm->map.count && qvm->map.sorted[index]->section_id == S_CODE && qvm->map.sorted[index]->address == address)
+        return qvm->map.sorted[index]->name;
+
+    // name the syscall from its number
+    snprintf(trap_name, trap_size, "trap_%x", address);
+    return trap_name;
+}
+
+static char *qvm_disassemble_global_fast(qvm_t *qvm, unsigned int address)
+{
+    unsigned int    index;
+
+    // find the map entry of a global at this address
+    index = map_find_address(&qvm->map, 0, address);
+    if (index < qvm->map.count && qvm->map.sorted[index]->section_id != S_CODE && qvm->map.sorted[index]->address == address)
+        return qvm->map.sorted[index]->name;
+
+    // the global isn't in the map
+    return NULL;
 }
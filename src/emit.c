@@ -0,0 +1,57 @@
+#include "qvmd.h"
+
+typedef struct {
+    qvm_t           *qvm;
+    opt_emit_t      *emits;
+    unsigned int    threads_count;
+} qvm_emit_t;
+
+int         qvm_emit(qvm_t *qvm, opt_emit_t *emits, unsigned int emits_count, unsigned int threads_count);
+static int  qvm_emit_job(void *context, unsigned int index);
+
+int qvm_emit(qvm_t *qvm, opt_emit_t *emits, unsigned int emits_count, unsigned int threads_count)
+{
+    qvm_emit_t  context;
+
+    // a streamed qvm analyzes its functions again for each output, one at a time
+    if (qvm->stream)
+        threads_count = 1;
+
+    // set the emit context
+    context.qvm = qvm;
+    context.emits = emits;
+    context.threads_count = threads_count;
+
+    // run all the emitters on the same analysis
+    return pool_run(emits_count, threads_count, &context, qvm_emit_job);
+}
+
+static int qvm_emit_job(void *context, unsigned int index)
+{
+    qvm_emit_t  *emit = context;
+    char        *filename = emit->emits[index].filename;
+
+    // run the emitter
+    switch (emit->emits[index].type) {
+        case EMIT_C:
+            return qvm_decompile(emit->qvm, filename);
+        case EMIT_ASM:
+            return qvm_disassemble(emit->qvm, filename);
+        case EMIT_JSON:
+            return qvm_json(emit->qvm, filename);
+        case EMIT_DIR:
+            return qvm_decompile_split(emit->qvm, filename, emit->threads_count);
+        case EMIT_HOT:
+            return qvm_hot(emit->qvm, filename);
+        case EMIT_LINT:
+            return qvm_lint(emit->qvm, filename);
+        case EMIT_STACK:
+            return qvm_stack(emit->qvm, filename);
+        case EMIT_FOOTPRINT:
+            return qvm_footprint(emit->qvm, filename);
+        case EMIT_SIGNATURES:
+            return qvm_signatures(emit->qvm, filename);
+        default:
+            return 0;
+    }
+}
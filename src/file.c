@@ -1,12 +1,19 @@
 #include "file.h"
+#include "hash.h"
 
 static file_t   *file_new(void);
 void            file_free(file_t *file);
 file_t          *file_create(char *filename);
+file_t          *file_create_tmp(void);
+static file_t   *file_create_fd(int fd);
 static int      file_close(file_t *file);
 file_t          *file_read(char *filename);
+file_t          *file_map(char *filename);
 char            *file_ext(char *filename);
 void            file_print(file_t *file, char *format, ...);
+int             file_write(file_t *file, void *data, size_t size);
+int             file_flush(file_t *file);
+static int      file_write_fd(file_t *file, void *data, size_t size);
 static int      file_is_endline(file_t *file);
 static char     *file_get_nextline(file_t *file);
 void            file_foreach_line(file_t *file, void *context, void (*func)(void *context, char *line));
@@ -24,8 +31,12 @@ static file_t *file_new(void)
     file->size = 0;
     file->content = NULL;
     file->is_open = 0;
+    file->is_mapped = 0;
     file->fd = -1;
     file->cursor = 0;
+    file->buffer = NULL;
+    file->buffer_length = 0;
+    file->hash = HASH_INIT;
 
     // return the file
     return file;
@@ -33,13 +44,21 @@ static file_t *file_new(void)
 
 void file_free(file_t *file)
 {
-    // free the file content if needed
-    if (file->content)
+    // unmap or free the file content if needed
+    if (file->content && file->is_mapped)
+        munmap(file->content, file->size);
+    else if (file->content)
         free(file->content);
 
-    // close the file if needed
-    if (file->is_open)
+    // flush and close the file if needed
+    if (file->is_open) {
+        file_flush(file);
         file_close(file);
+    }
+
+    // free the write buffer if needed
+    if (file->buffer)
+        free(file->buffer);
 
     // free the file
     free(file);
@@ -48,15 +67,38 @@ void file_free(file_t *file)
 file_t  *file_create(char *filename)
 {
     int     fd;
-    file_t  *file;
+
+    // open the file
+    if ((fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0755)) == -1)
+        return NULL;
 
     // create the file
-    if (!(file = file_new()))
+    return file_create_fd(fd);
+}
+
+file_t  *file_create_tmp(void)
+{
+    int     fd;
+    char    filename[] = "/tmp/qvmd.XXXXXX";
+
+    // open a new temporary file
+    if ((fd = mkstemp(filename)) == -1)
         return NULL;
 
-    // open the file
-    if ((fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0755)) == -1) {
-        file_free(file);
+    // remove its name so it is deleted on close
+    unlink(filename);
+
+    // create the file
+    return file_create_fd(fd);
+}
+
+static file_t *file_create_fd(int fd)
+{
+    file_t  *file;
+
+    // create the file
+    if (!(file = file_new())) {
+        close(fd);
         return NULL;
     }
 
@@ -64,6 +106,12 @@ file_t  *file_create(char *filename)
     file->is_open = 1;
     file->fd = fd;
 
+    // allocate the write buffer
+    if (!(file->buffer = malloc(FILE_BUFFER_SIZE))) {
+        file_free(file);
+        return NULL;
+    }
+
     // return the file
     return file;
 }
@@ -150,6 +198,48 @@ file_t *file_read(char *file_name)
     return file;
 }
 
+file_t *file_map(char *file_name)
+{
+    int     fd;
+    off_t   file_size;
+    char    *file_content;
+    file_t  *file;
+
+    // open the file
+    if ((fd = open(file_name, O_RDONLY)) == -1)
+        return NULL;
+
+    // get the file size
+    if ((file_size = lseek(fd, 0, SEEK_END)) == (off_t)-1 || !file_size || file_size > UINT_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    // map the file content
+    if ((file_content = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    // the mapping stays valid after closing the fd
+    close(fd);
+
+    // create the file structure
+    if (!(file = file_new())) {
+        munmap(file_content, file_size);
+        return NULL;
+    }
+
+    // set the file infos
+    file->name = file_name;
+    file->size = file_size;
+    file->content = file_content;
+    file->is_mapped = 1;
+
+    // return the file
+    return file;
+}
+
 char *file_ext(char *filename)
 {
     size_t  len = strlen(filename);
@@ -166,6 +256,40 @@ char *file_ext(char *filename)
 void file_print(file_t *file, char *format, ...) {
     va_list arg_list;
     int     fd = 1;
+    int     length;
+    char    *text;
+
+    // print format in the write buffer if any
+    if (file && file->is_open == 1 && file->buffer) {
+        va_start(arg_list, format);
+        length = vsnprintf(file->buffer + file->buffer_length, FILE_BUFFER_SIZE - file->buffer_length, format, arg_list);
+        va_end(arg_list);
+
+        // check if the format fitted in the buffer
+        if (length >= 0 && (size_t)length < FILE_BUFFER_SIZE - file->buffer_length) {
+            file->buffer_length += length;
+            return;
+        }
+
+        // flush the buffer and print format again
+        file_flush(file);
+        if (length >= 0 && length < FILE_BUFFER_SIZE) {
+            va_start(arg_list, format);
+            file->buffer_length = vsnprintf(file->buffer, FILE_BUFFER_SIZE, format, arg_list);
+            va_end(arg_list);
+            return;
+        }
+
+        // write a text bigger than the buffer directly
+        if (length >= 0 && (text = malloc(length + 1))) {
+            va_start(arg_list, format);
+            vsnprintf(text, length + 1, format, arg_list);
+            va_end(arg_list);
+            file_write_fd(file, text, length);
+            free(text);
+            return;
+        }
+    }
 
     // check the file descriptor
     if (file && file->is_open == 1)
@@ -177,6 +301,65 @@ void file_print(file_t *file, char *format, ...) {
     va_end(arg_list);
 }
 
+int file_write(file_t *file, void *data, size_t size)
+{
+    // check the file descriptor
+    if (!file || file->is_open != 1)
+        return 0;
+
+    // write the data directly if there is no buffer
+    if (!file->buffer)
+        return file_write_fd(file, data, size);
+
+    // flush the buffer if the data doesn't fit in it
+    if (size > FILE_BUFFER_SIZE - file->buffer_length) {
+        if (!file_flush(file))
+            return 0;
+        if (size >= FILE_BUFFER_SIZE)
+            return file_write_fd(file, data, size);
+    }
+
+    // save the data in the buffer
+    memcpy(file->buffer + file->buffer_length, data, size);
+    file->buffer_length += size;
+
+    // success
+    return 1;
+}
+
+int file_flush(file_t *file)
+{
+    size_t  length;
+
+    // check if there is something to flush
+    if (!file->buffer || !file->buffer_length)
+        return 1;
+
+    // write the buffer content
+    length = file->buffer_length;
+    file->buffer_length = 0;
+    return file_write_fd(file, file->buffer, length);
+}
+
+static int file_write_fd(file_t *file, void *data, size_t size)
+{
+    ssize_t written;
+
+    // hash the written content
+    file->hash = hash_data(file->hash, data, size);
+
+    // write all the data
+    while (size) {
+        if ((written = write(file->fd, data, size)) <= 0)
+            return 0;
+        data = (char *)data + written;
+        size -= written;
+    }
+
+    // success
+    return 1;
+}
+
 static int file_is_endline(file_t *file)
 {
     // check for an end-of-line character
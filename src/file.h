@@ -8,21 +8,32 @@
 #include <stdarg.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <sys/mman.h>
+
+#define FILE_BUFFER_SIZE    0x10000
 
 typedef struct {
     char            *name;
     char            *content;
     size_t          size;
     char            is_open;
+    char            is_mapped;
     int             fd;
     unsigned int    cursor;
+    char            *buffer;
+    size_t          buffer_length;
+    unsigned long long  hash;
 } file_t;
 
 void    file_free(file_t *file);
 file_t  *file_create(char *filename);
+file_t  *file_create_tmp(void);
 file_t  *file_read(char *filename);
+file_t  *file_map(char *filename);
 char    *file_ext(char *filename);
 void    file_print(file_t *file, char *format, ...);
+int     file_write(file_t *file, void *data, size_t size);
+int     file_flush(file_t *file);
 void    file_foreach_line(file_t *file, void *context, void (*func)(void *context, char *line));
 
 #endif
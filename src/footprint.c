@@ -0,0 +1,335 @@
+#include "qvmd.h"
+
+#define FOOTPRINT_TOP_COUNT 32
+
+/*
+    The footprint report gives the memory the engine allocates for the data,
+    lit and bss sections, rounded up to a power of two like the engine does,
+    with the largest symbols of each section. It also lists the literal
+    strings found several times in the lit section and the bss globals that
+    are never referenced. A bss global is referenced when a constant of the
+    code or a word of the data section points inside it, which also keeps
+    the arrays only reached by an index or from a pointer table. The globals
+    cut inside a symbol of the map, like the fields of a structure, are
+    merged back into it since a reference to any field keeps the symbol.
+*/
+
+typedef struct {
+    qvm_variable_t  *var;
+    unsigned int    size;
+} qvm_footprint_symbol_t;
+
+typedef struct {
+    qvm_t                   *qvm;
+    qvm_variable_t          **globals;
+    unsigned int            globals_count;
+    qvm_footprint_symbol_t  *symbols;
+    unsigned int            symbols_count;
+    unsigned int            *pointers;
+    unsigned int            pointers_count;
+} qvm_footprint_t;
+
+int                 qvm_footprint(qvm_t *qvm, char *filename);
+static void         qvm_footprint_symbols(qvm_footprint_t *footprint);
+static void         qvm_footprint_section(file_t *file, qvm_footprint_t *footprint, qvm_section_e section);
+static unsigned int qvm_footprint_duplicates(file_t *file, qvm_footprint_t *footprint);
+static int          qvm_footprint_pointers(qvm_footprint_t *footprint);
+static unsigned int qvm_footprint_unreferenced(file_t *file, qvm_footprint_t *footprint);
+static int          qvm_footprint_referenced(qvm_footprint_t *footprint, unsigned int address, unsigned int size);
+static int          qvm_footprint_named(qvm_t *qvm, qvm_variable_t *var);
+static qvm_section_e qvm_footprint_section_id(qvm_variable_t *var);
+static int          qvm_footprint_compare_strings(const void *a, const void *b);
+static int          qvm_footprint_compare_symbols(const void *a, const void *b);
+static int          qvm_footprint_compare_pointers(const void *a, const void *b);
+
+static char *qvm_footprint_sections_names[S_MAX] = {
+    "code",
+    "data",
+    "lit",
+    "bss",
+    "jmptab"
+};
+
+int qvm_footprint(qvm_t *qvm, char *filename)
+{
+    qvm_footprint_t footprint;
+    qvm_variable_t  *var;
+    file_t          *file;
+    unsigned int    length;
+    unsigned int    allocated = 1;
+    unsigned int    duplicated;
+    unsigned int    unreferenced;
+
+    // allocate the globals and the symbols arrays
+    memset(&footprint, 0, sizeof(footprint));
+    footprint.qvm = qvm;
+    footprint.globals = malloc(sizeof(*footprint.globals) * (qvm->globals_count + 1));
+    footprint.symbols = malloc(sizeof(*footprint.symbols) * (qvm->globals_count + 1));
+    if (!footprint.globals || !footprint.symbols) {
+        printf("Reporting footprint to %s...Error: Couldn't allocate globals.\n", filename);
+        free(footprint.globals);
+        free(footprint.symbols);
+        return 0;
+    }
+    for (var = qvm->globals; var; var = var->next)
+        footprint.globals[footprint.globals_count++] = var;
+
+    // find all the pointers of the code and the data section
+    if (!qvm_footprint_pointers(&footprint)) {
+        printf("Reporting footprint to %s...Error: Couldn't allocate pointers.\n", filename);
+        free(footprint.globals);
+        free(footprint.symbols);
+        return 0;
+    }
+
+    // the engine allocates the data, lit and bss sections in a power of two
+    length = qvm->sections[S_DATA].length + qvm->sections[S_LIT].length + qvm->sections[S_BSS].length;
+    while (allocated < length)
+        allocated <<= 1;
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Reporting footprint to %s...Error: Couldn't create file.\n", filename);
+        free(footprint.globals);
+        free(footprint.symbols);
+        free(footprint.pointers);
+        return 0;
+    }
+
+    // print the report header
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tData: 0x%x\n", qvm->sections[S_DATA].length);
+    file_print(file, "\tLit: 0x%x\n", qvm->sections[S_LIT].length);
+    file_print(file, "\tBss: 0x%x\n", qvm->sections[S_BSS].length);
+    file_print(file, "\tTotal: 0x%x\n", length);
+    file_print(file, "\tAllocated: 0x%x\n", allocated);
+    file_print(file, "*/\n\n");
+
+    // merge the globals back into the symbols of the map and print the largest of each section
+    qvm_footprint_symbols(&footprint);
+    qvm_footprint_section(file, &footprint, S_DATA);
+    qvm_footprint_section(file, &footprint, S_LIT);
+    qvm_footprint_section(file, &footprint, S_BSS);
+
+    // print the duplicated literal strings and the unreferenced bss globals
+    duplicated = qvm_footprint_duplicates(file, &footprint);
+    unreferenced = qvm_footprint_unreferenced(file, &footprint);
+
+    // free the created file, the globals, the symbols and the pointers
+    file_free(file);
+    free(footprint.globals);
+    free(footprint.symbols);
+    free(footprint.pointers);
+
+    printf("Reporting footprint to %s...Success: 0x%x bytes allocated, %u bytes of duplicated literals and %u bytes of unreferenced bss.\n",
+        filename, allocated, duplicated, unreferenced);
+
+    // success
+    return 1;
+}
+
+static void qvm_footprint_symbols(qvm_footprint_t *footprint)
+{
+    qvm_t                   *qvm = footprint->qvm;
+    qvm_footprint_symbol_t  *symbol = NULL;
+    qvm_variable_t          *var;
+
+    // merge the globals cut inside a symbol of the map back into it
+    footprint->symbols_count = 0;
+    for (var = qvm->globals; var; var = var->next) {
+        if (qvm_footprint_section_id(var) == S_MAX || !var->size)
+            continue;
+        if (symbol && qvm_footprint_section_id(symbol->var) == qvm_footprint_section_id(var) && qvm_footprint_named(qvm, symbol->var) && !qvm_footprint_named(qvm, var)) {
+            symbol->size = var->address + var->size - symbol->var->address;
+            continue;
+        }
+        symbol = &footprint->symbols[footprint->symbols_count++];
+        symbol->var = var;
+        symbol->size = var->size;
+    }
+
+    // rank the symbols by size
+    qsort(footprint->symbols, footprint->symbols_count, sizeof(*footprint->symbols), qvm_footprint_compare_symbols);
+}
+
+static void qvm_footprint_section(file_t *file, qvm_footprint_t *footprint, qvm_section_e section)
+{
+    qvm_footprint_symbol_t  *symbol;
+    unsigned int            printed = 0;
+
+    // print the largest symbols of the section
+    file_print(file, "// largest %s globals: size, name, address\n", qvm_footprint_sections_names[section]);
+    for (unsigned int i = 0; i < footprint->symbols_count && printed < FOOTPRINT_TOP_COUNT; i++) {
+        symbol = &footprint->symbols[i];
+        if (qvm_footprint_section_id(symbol->var) != section)
+            continue;
+        file_print(file, "%u\t%s\t0x%x\n", symbol->size, symbol->var->name, symbol->var->address);
+        printed++;
+    }
+    file_print(file, "\n");
+}
+
+static unsigned int qvm_footprint_duplicates(file_t *file, qvm_footprint_t *footprint)
+{
+    qvm_variable_t  *var;
+    unsigned int    count;
+    unsigned int    wasted = 0;
+
+    // sort the literal strings by content, the other globals last
+    qsort(footprint->globals, footprint->globals_count, sizeof(*footprint->globals), qvm_footprint_compare_strings);
+
+    // print each string found more than once
+    file_print(file, "// duplicated literals: wasted bytes, copies, string\n");
+    for (unsigned int i = 0; i < footprint->globals_count; i += count) {
+        var = footprint->globals[i];
+        if (var->status != VS_LITERAL_TEXT)
+            break;
+
+        // count the copies of the string
+        for (count = 1; i + count < footprint->globals_count && !qvm_footprint_compare_strings(&footprint->globals[i], &footprint->globals[i + count]); count++);
+        if (count == 1)
+            continue;
+
+        // print the string escaped like the decompiled literals
+        wasted += (count - 1) * (strlen(var->content) + 1);
+        file_print(file, "%u\t%u\t\"", (count - 1) * (unsigned int)(strlen(var->content) + 1), count);
+        for (char *c = var->content; *c; c++) {
+            if (*c == '\n')
+                file_print(file, "\\n");
+            else if (*c == '\"' || *c == '\\')
+                file_print(file, "\\%c", *c);
+            else if ((unsigned char)*c < 0x20)
+                file_print(file, "\\x%02hhx", *c);
+            else
+                file_print(file, "%c", *c);
+        }
+        file_print(file, "\"\n");
+    }
+    file_print(file, "\n");
+
+    // return the wasted bytes
+    return wasted;
+}
+
+static int qvm_footprint_pointers(qvm_footprint_t *footprint)
+{
+    qvm_t           *qvm = footprint->qvm;
+    unsigned int    words_count = qvm->sections[S_DATA].length / 4;
+
+    // allocate the pointers of the code and the data section
+    if (!(footprint->pointers = malloc(sizeof(*footprint->pointers) * (qvm->header->instructions_count + words_count + 1))))
+        return 0;
+
+    // add the constants of the code
+    for (unsigned int i = 0; i < qvm->header->instructions_count; i++)
+        if (qvm->opcodes[i].info->id == OP_CONST)
+            footprint->pointers[footprint->pointers_count++] = qvm->opcodes[i].value;
+
+    // add the words of the data section
+    for (unsigned int i = 0; i < words_count; i++)
+        footprint->pointers[footprint->pointers_count++] = *(unsigned int *)(qvm->sections[S_DATA].content + i * 4);
+
+    // sort the pointers to search them
+    qsort(footprint->pointers, footprint->pointers_count, sizeof(*footprint->pointers), qvm_footprint_compare_pointers);
+
+    // success
+    return 1;
+}
+
+static unsigned int qvm_footprint_unreferenced(file_t *file, qvm_footprint_t *footprint)
+{
+    qvm_footprint_symbol_t  *symbol;
+    unsigned int            unreferenced = 0;
+
+    // print the bss symbols never pointed to
+    file_print(file, "// unreferenced bss globals: size, name, address\n");
+    for (unsigned int i = 0; i < footprint->symbols_count; i++) {
+        symbol = &footprint->symbols[i];
+        if (symbol->var->status != VS_BSS || qvm_footprint_referenced(footprint, symbol->var->address, symbol->size))
+            continue;
+        file_print(file, "%u\t%s\t0x%x\n", symbol->size, symbol->var->name, symbol->var->address);
+        unreferenced += symbol->size;
+    }
+
+    // return the unreferenced bytes
+    return unreferenced;
+}
+
+static int qvm_footprint_referenced(qvm_footprint_t *footprint, unsigned int address, unsigned int size)
+{
+    unsigned int    start = 0;
+    unsigned int    end = footprint->pointers_count;
+    unsigned int    middle;
+
+    // find the first pointer after the symbol start
+    while (start < end) {
+        middle = start + (end - start) / 2;
+        if (footprint->pointers[middle] < address)
+            start = middle + 1;
+        else
+            end = middle;
+    }
+
+    // check if it points inside the symbol
+    return start < footprint->pointers_count && footprint->pointers[start] < address + size;
+}
+
+static int qvm_footprint_named(qvm_t *qvm, qvm_variable_t *var)
+{
+    qvm_variable_t  def;
+
+    // a global keeping its default name isn't a symbol of the map
+    def = *var;
+    var_rename_default(qvm, NULL, &def);
+    return strcmp(def.name, var->name) != 0;
+}
+
+static qvm_section_e qvm_footprint_section_id(qvm_variable_t *var)
+{
+    // get the section of the global from its status
+    switch (var->status) {
+        case VS_GLOBAL:
+            return S_DATA;
+        case VS_LITERAL:
+        case VS_LITERAL_TEXT:
+            return S_LIT;
+        case VS_BSS:
+            return S_BSS;
+        default:
+            return S_MAX;
+    }
+}
+
+static int qvm_footprint_compare_strings(const void *a, const void *b)
+{
+    const qvm_variable_t    *va = *(qvm_variable_t * const *)a;
+    const qvm_variable_t    *vb = *(qvm_variable_t * const *)b;
+
+    // the literal strings first, by content
+    if ((va->status == VS_LITERAL_TEXT) != (vb->status == VS_LITERAL_TEXT))
+        return va->status == VS_LITERAL_TEXT ? -1 : 1;
+    if (va->status == VS_LITERAL_TEXT)
+        return strcmp(va->content, vb->content);
+    return 0;
+}
+
+static int qvm_footprint_compare_symbols(const void *a, const void *b)
+{
+    const qvm_footprint_symbol_t    *sa = a;
+    const qvm_footprint_symbol_t    *sb = b;
+
+    // the biggest first, then by address
+    if (sa->size != sb->size)
+        return sa->size > sb->size ? -1 : 1;
+    return sa->var->address < sb->var->address ? -1 : sa->var->address > sb->var->address;
+}
+
+static int qvm_footprint_compare_pointers(const void *a, const void *b)
+{
+    unsigned int    pa = *(const unsigned int *)a;
+    unsigned int    pb = *(const unsigned int *)b;
+
+    // sort the pointers by value
+    return pa < pb ? -1 : pa > pb;
+}
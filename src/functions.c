@@ -1,16 +1,35 @@
 #include "qvmd.h"
+#include <stdint.h>
 
 void                        func_init(qvm_function_t *func);
 static qvm_function_t       *func_new(void);
 qvm_function_t              *func_find(qvm_t *qvm, unsigned int address);
+qvm_function_t              *func_find_name(qvm_t *qvm, char *name);
 qvm_function_t              *func_add_syscall(qvm_t *qvm, unsigned int address);
 void                        func_rename(qvm_function_t *func, char *name);
+void                        func_rename_default(qvm_function_t *func);
+int                         func_is_default(qvm_function_t *func);
+unsigned long long          func_fingerprint(qvm_function_t *func);
+int                         func_opcode_value(qvm_function_t *func, unsigned int address, int *value);
 static qvm_function_list_t  *func_list_new(void);
 static qvm_function_list_t  *func_list_find(qvm_function_list_t *list, qvm_function_t *func);
 qvm_function_list_t         *func_list_add(qvm_function_list_t **list, qvm_function_t *func);
+void                        func_list_free(qvm_function_list_t *list);
+void                        func_graph_init(qvm_function_graph_t *graph);
+int                         func_graph_add(qvm_function_graph_t *graph, qvm_function_array_t *array, qvm_function_t *func);
+int                         func_graph_freeze(qvm_function_graph_t *graph);
+static int                  func_graph_compare_edges(const void *a, const void *b);
+static int                  func_graph_compare_order(const void *a, const void *b);
+void                        func_graph_free(qvm_function_graph_t *graph);
+int                         func_sccs_load(qvm_t *qvm, qvm_function_sccs_t *sccs, char *indirect);
+unsigned int                func_sccs_callees_count(qvm_t *qvm, char *indirect, unsigned int id);
+unsigned int                func_sccs_callee(qvm_t *qvm, char *indirect, unsigned int id, unsigned int index);
+static int                  func_sccs_levels(qvm_t *qvm, qvm_function_sccs_t *sccs, char *indirect, unsigned int *components, unsigned int *levels);
+void                        func_sccs_free(qvm_function_sccs_t *sccs);
 
 void func_init(qvm_function_t *func)
 {
+    func->id = 0;
     func->address = 0;
     *func->name = 0;
     func->stack_size = 0;
@@ -19,11 +38,19 @@ void func_init(qvm_function_t *func)
     func->opblock_end = NULL;
     func->locals = NULL;
     func->next = NULL;
-    func->calls = NULL;
-    func->called_by = NULL;
+    func->calls.functions = NULL;
+    func->calls.count = 0;
+    func->called_by.functions = NULL;
+    func->called_by.count = 0;
+    func->xrefs.xrefs = NULL;
+    func->xrefs.count = 0;
     func->op_size = 0;
+    func->opstack_depth = 0;
     func->locals_count = 0;
+    func->args_count = 0;
     func->variadic = 0;
+    func->selected = 1;
+    func->analyzed = 1;
     func->qvm = NULL;
 }
 
@@ -63,6 +90,25 @@ qvm_function_t *func_find(qvm_t *qvm, unsigned int address)
     return NULL;
 }
 
+qvm_function_t *func_find_name(qvm_t *qvm, char *name)
+{
+    qvm_function_t  *sysc;
+
+    // search for function
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        if (!strcmp(qvm->functions[i].name, name))
+            return &qvm->functions[i];
+    }
+
+    // search for syscall
+    for (sysc = qvm->syscalls; sysc; sysc = sysc->next)
+        if (!strcmp(sysc->name, name))
+            return sysc;
+
+    // we didn't find it
+    return NULL;
+}
+
 qvm_function_t *func_add_syscall(qvm_t *qvm, unsigned int address)
 {
     qvm_function_t  *func;
@@ -78,9 +124,10 @@ qvm_function_t *func_add_syscall(qvm_t *qvm, unsigned int address)
     // set the function qvm
     func->qvm = qvm;
 
-    // set the function name and address
+    // set the function id, name and address
+    func->id = qvm->functions_count + qvm->syscalls_count;
     func->address = address;
-    sprintf(func->name, "trap_%x", address);
+    func_rename_default(func);
 
     // add the syscalls to the list
     func->next = qvm->syscalls;
@@ -111,6 +158,81 @@ void func_rename(qvm_function_t *func, char *name)
     sprintf(func->name, "%s", name);
 }
 
+void func_rename_default(qvm_function_t *func)
+{
+    qvm_syscall_t   *sysc;
+
+    // set the syscall name from the syscalls table if possible
+    if (func->id >= func->qvm->functions_count) {
+        if ((sysc = syscalls_find(func->qvm->syscalls_table, func->address)))
+            sprintf(func->name, "%s", sysc->name);
+        else
+            sprintf(func->name, "trap_%x", func->address);
+    }
+
+    // set the function name
+    else if (!func->address)
+        sprintf(func->name, "vmMain");
+    else
+        sprintf(func->name, "sub_%x", func->address);
+}
+
+int func_is_default(qvm_function_t *func)
+{
+    char    name[sizeof(func->name)];
+
+    // compare the function name to its default one
+    snprintf(name, sizeof(name), func->address ? "sub_%x" : "vmMain", func->address);
+    return !strcmp(func->name, name);
+}
+
+unsigned long long func_fingerprint(qvm_function_t *func)
+{
+    qvm_t               *qvm = func->qvm;
+    qvm_opcode_t        *op;
+    unsigned long long  hash = HASH_INIT;
+    int                 value;
+
+    // hash all the function opcodes without the addresses of this qvm
+    for (unsigned int i = func->address; i < func->address + func->op_size && i < qvm->header->instructions_count; i++) {
+        op = &qvm->opcodes[i];
+        hash = hash_data(hash, &op->info->id, sizeof(op->info->id));
+
+        // hash the opcode value if it doesn't depend on this qvm
+        if (func_opcode_value(func, i, &value))
+            hash = hash_data(hash, &value, sizeof(value));
+    }
+
+    // return the function fingerprint
+    return hash;
+}
+
+int func_opcode_value(qvm_function_t *func, unsigned int address, int *value)
+{
+    qvm_t           *qvm = func->qvm;
+    qvm_opcode_t    *op = &qvm->opcodes[address];
+    qvm_opcode_e    next;
+
+    // check if the opcode has a value, a constant taking a global address is ignored
+    if (!op->info->param_size || op->global)
+        return 0;
+    *value = op->value;
+
+    // a jump address is kept relative to the function, a call address is ignored
+    if (op->info->id >= OP_EQ && op->info->id <= OP_GEF)
+        *value -= func->address;
+    else if (op->info->id == OP_CONST && address + 1 < qvm->header->instructions_count) {
+        next = qvm->opcodes[address + 1].info->id;
+        if (next == OP_JUMP)
+            *value -= func->address;
+        else if (next == OP_CALL)
+            return 0;
+    }
+
+    // the value is kept
+    return 1;
+}
+
 static qvm_function_list_t *func_list_new(void)
 {
     qvm_function_list_t  *list;
@@ -159,3 +281,385 @@ qvm_function_list_t *func_list_add(qvm_function_list_t **list, qvm_function_t *f
 
     return fl;
 }
+
+void func_list_free(qvm_function_list_t *list)
+{
+    qvm_function_list_t *next;
+
+    // free all the list elements
+    for (; list; list = next) {
+        next = list->next;
+        free(list);
+    }
+}
+
+/*
+    The calls, called_by and variables parents are edges of a graph. During
+    the analysis, each edge is appended to a flat vector without looking for
+    duplicates. Once all edges are found, the graph is frozen: the edges are
+    sorted by array to remove duplicates, then stored contiguously in one
+    adjacency block, each array pointing to its own range. Within an array,
+    the functions are ordered from the last found to the first found.
+*/
+
+void func_graph_init(qvm_function_graph_t *graph)
+{
+    graph->edges = NULL;
+    graph->edges_count = 0;
+    graph->edges_size = 0;
+    graph->adjacency = NULL;
+    graph->adjacency_count = 0;
+    graph->frozen = 0;
+}
+
+int func_graph_add(qvm_function_graph_t *graph, qvm_function_array_t *array, qvm_function_t *func)
+{
+    qvm_function_edge_t *edges;
+    unsigned int        size;
+
+    // a frozen graph already has all its edges, a streamed function finds them again
+    if (graph->frozen)
+        return 1;
+
+    // grow the edges vector if needed
+    if (graph->edges_count >= graph->edges_size) {
+        size = graph->edges_size ? graph->edges_size * 2 : 1024;
+        if (!(edges = realloc(graph->edges, sizeof(*edges) * size))) {
+            printf("Error: Couldn't allocate more function edges.\n");
+            return 0;
+        }
+        graph->edges = edges;
+        graph->edges_size = size;
+    }
+
+    // append the edge
+    graph->edges[graph->edges_count].array = array;
+    graph->edges[graph->edges_count].function = func;
+    graph->edges[graph->edges_count].order = graph->edges_count;
+    graph->edges_count++;
+
+    // success
+    return 1;
+}
+
+int func_graph_freeze(qvm_function_graph_t *graph)
+{
+    qvm_function_edge_t *edge;
+    unsigned int        count = 0;
+
+    // sort the edges by array and function to find the duplicates
+    qsort(graph->edges, graph->edges_count, sizeof(*graph->edges), func_graph_compare_edges);
+
+    // keep the first found edge of each duplicates
+    for (unsigned int i = 0; i < graph->edges_count; i++) {
+        edge = &graph->edges[i];
+        if (count && graph->edges[count - 1].array == edge->array && graph->edges[count - 1].function == edge->function)
+            continue;
+        graph->edges[count++] = *edge;
+    }
+
+    // sort the unique edges by array, the last found first
+    qsort(graph->edges, count, sizeof(*graph->edges), func_graph_compare_order);
+
+    // allocate the adjacency block
+    if (!(graph->adjacency = malloc(sizeof(*graph->adjacency) * (count + 1)))) {
+        printf("Error: Couldn't allocate function adjacency.\n");
+        return 0;
+    }
+    graph->adjacency_count = count;
+
+    // give each array its range of the adjacency block
+    for (unsigned int i = 0; i < count; i++) {
+        edge = &graph->edges[i];
+        if (!i || graph->edges[i - 1].array != edge->array) {
+            edge->array->functions = &graph->adjacency[i];
+            edge->array->count = 0;
+        }
+        graph->adjacency[i] = edge->function;
+        edge->array->count++;
+    }
+
+    // free the edges vector, the graph can't change anymore
+    free(graph->edges);
+    graph->edges = NULL;
+    graph->edges_count = 0;
+    graph->edges_size = 0;
+    graph->frozen = 1;
+
+    // success
+    return 1;
+}
+
+static int func_graph_compare_edges(const void *a, const void *b)
+{
+    const qvm_function_edge_t   *ea = a;
+    const qvm_function_edge_t   *eb = b;
+
+    // compare the arrays, then the functions, then the order
+    if (ea->array != eb->array)
+        return (uintptr_t)ea->array < (uintptr_t)eb->array ? -1 : 1;
+    if (ea->function != eb->function)
+        return (uintptr_t)ea->function < (uintptr_t)eb->function ? -1 : 1;
+    return ea->order < eb->order ? -1 : ea->order > eb->order;
+}
+
+static int func_graph_compare_order(const void *a, const void *b)
+{
+    const qvm_function_edge_t   *ea = a;
+    const qvm_function_edge_t   *eb = b;
+
+    // compare the arrays, then the reversed order
+    if (ea->array != eb->array)
+        return (uintptr_t)ea->array < (uintptr_t)eb->array ? -1 : 1;
+    return ea->order > eb->order ? -1 : ea->order < eb->order;
+}
+
+void func_graph_free(qvm_function_graph_t *graph)
+{
+    // free the edges and the adjacency block
+    free(graph->edges);
+    free(graph->adjacency);
+    func_graph_init(graph);
+}
+
+/*
+    The strongly connected components of the calls graph are found with an
+    iterative Tarjan search, which completes the callees components before
+    their callers. Each component gets a level one above its deepest callee
+    component, so the components of a level only call the lower levels and
+    can be analyzed together once the lower levels are done. The syscalls
+    are not part of the components. If the functions making indirect calls
+    are given, the graph gets one more node after the functions for the
+    indirect calls, which calls all the functions without a direct caller.
+*/
+
+int func_sccs_load(qvm_t *qvm, qvm_function_sccs_t *sccs, char *indirect)
+{
+    unsigned int    count = qvm->functions_count + (indirect ? 1 : 0);
+    unsigned int    *indexes;
+    unsigned int    *lows;
+    unsigned int    *stack;
+    unsigned int    *path;
+    unsigned int    *edges;
+    unsigned int    *components;
+    unsigned int    *levels;
+    char            *stacked;
+    unsigned int    index = 1;
+    unsigned int    stack_count = 0;
+    unsigned int    path_count;
+    int             success;
+    unsigned int    func_id;
+    unsigned int    callee_id;
+
+    // initialize the components
+    sccs->functions = NULL;
+    sccs->starts = NULL;
+    sccs->levels = NULL;
+    sccs->count = 0;
+    sccs->levels_count = 0;
+
+    // allocate the search state and the components
+    indexes = calloc(count + 1, sizeof(*indexes));
+    lows = malloc(sizeof(*lows) * (count + 1));
+    stack = malloc(sizeof(*stack) * (count + 1));
+    path = malloc(sizeof(*path) * (count + 1));
+    edges = malloc(sizeof(*edges) * (count + 1));
+    components = malloc(sizeof(*components) * (count + 1));
+    levels = malloc(sizeof(*levels) * (count + 1));
+    stacked = calloc(count + 1, sizeof(*stacked));
+    sccs->functions = malloc(sizeof(*sccs->functions) * (count + 1));
+    sccs->starts = malloc(sizeof(*sccs->starts) * (count + 1));
+    sccs->levels = malloc(sizeof(*sccs->levels) * (count + 2));
+    if (!indexes || !lows || !stack || !path || !edges || !components || !levels || !stacked || !sccs->functions || !sccs->starts || !sccs->levels) {
+        printf("Error: Couldn't allocate calls graph components.\n");
+        free(indexes);
+        free(lows);
+        free(stack);
+        free(path);
+        free(edges);
+        free(components);
+        free(levels);
+        free(stacked);
+        func_sccs_free(sccs);
+        return 0;
+    }
+
+    // search from each function not visited yet
+    for (unsigned int root = 0; root < count; root++) {
+        if (indexes[root])
+            continue;
+
+        // visit the root
+        path_count = 0;
+        path[path_count] = root;
+        edges[path_count++] = 0;
+        indexes[root] = lows[root] = index++;
+        stack[stack_count++] = root;
+        stacked[root] = 1;
+
+        while (path_count) {
+            func_id = path[path_count - 1];
+
+            // visit the next callee of the function if any
+            if (edges[path_count - 1] < func_sccs_callees_count(qvm, indirect, func_id)) {
+                callee_id = func_sccs_callee(qvm, indirect, func_id, edges[path_count - 1]++);
+                if (callee_id >= count)
+                    continue;
+                if (!indexes[callee_id]) {
+                    path[path_count] = callee_id;
+                    edges[path_count++] = 0;
+                    indexes[callee_id] = lows[callee_id] = index++;
+                    stack[stack_count++] = callee_id;
+                    stacked[callee_id] = 1;
+                }
+                else if (stacked[callee_id] && indexes[callee_id] < lows[func_id])
+                    lows[func_id] = indexes[callee_id];
+                continue;
+            }
+
+            // pop the function and give its low link to its caller
+            path_count--;
+            if (path_count && lows[func_id] < lows[path[path_count - 1]])
+                lows[path[path_count - 1]] = lows[func_id];
+
+            // the function is the root of a component, pop the component functions
+            if (lows[func_id] == indexes[func_id]) {
+                do {
+                    callee_id = stack[--stack_count];
+                    stacked[callee_id] = 0;
+                    components[callee_id] = sccs->count;
+                } while (callee_id != func_id);
+                sccs->count++;
+            }
+        }
+    }
+
+    // free the search state
+    free(indexes);
+    free(lows);
+    free(stack);
+    free(path);
+    free(edges);
+    free(stacked);
+
+    // order the components by level
+    success = func_sccs_levels(qvm, sccs, indirect, components, levels);
+    free(components);
+    free(levels);
+    if (!success)
+        func_sccs_free(sccs);
+
+    // return the status
+    return success;
+}
+
+unsigned int func_sccs_callees_count(qvm_t *qvm, char *indirect, unsigned int id)
+{
+    // the indirect calls node may call any function
+    if (id >= qvm->functions_count)
+        return qvm->functions_count;
+
+    // a function calls its callees, then the indirect calls node if it makes indirect calls
+    return qvm->functions[id].calls.count + (indirect && indirect[id] ? 1 : 0);
+}
+
+unsigned int func_sccs_callee(qvm_t *qvm, char *indirect, unsigned int id, unsigned int index)
+{
+    // the indirect calls node calls the functions without a direct caller, vmMain is called by the engine
+    if (id >= qvm->functions_count)
+        return index && !qvm->functions[index].called_by.count ? index : FUNC_SCCS_NONE;
+
+    // get the callee, the syscalls aren't part of the graph, then the indirect calls node
+    if (index < qvm->functions[id].calls.count)
+        return qvm->functions[id].calls.functions[index]->id < qvm->functions_count ? qvm->functions[id].calls.functions[index]->id : FUNC_SCCS_NONE;
+    return indirect ? qvm->functions_count : FUNC_SCCS_NONE;
+}
+
+static int func_sccs_levels(qvm_t *qvm, qvm_function_sccs_t *sccs, char *indirect, unsigned int *components, unsigned int *levels)
+{
+    unsigned int    count = qvm->functions_count + (indirect ? 1 : 0);
+    unsigned int    *members;
+    unsigned int    *firsts;
+    unsigned int    *order;
+    unsigned int    callee;
+    unsigned int    level;
+    unsigned int    offset = 0;
+
+    // allocate the functions by component and the components by level
+    members = malloc(sizeof(*members) * (count + 1));
+    firsts = calloc(sccs->count + 2, sizeof(*firsts));
+    order = malloc(sizeof(*order) * (sccs->count + 1));
+    if (!members || !firsts || !order) {
+        printf("Error: Couldn't allocate calls graph levels.\n");
+        free(members);
+        free(firsts);
+        free(order);
+        return 0;
+    }
+
+    // group the functions by component
+    for (unsigned int i = 0; i < count; i++)
+        firsts[components[i] + 1]++;
+    for (unsigned int i = 0; i < sccs->count; i++)
+        firsts[i + 1] += firsts[i];
+    for (unsigned int i = 0; i < count; i++)
+        members[firsts[components[i]]++] = i;
+    for (unsigned int i = sccs->count; i > 0; i--)
+        firsts[i] = firsts[i - 1];
+    firsts[0] = 0;
+
+    // the components are numbered callees first, so the callees levels are known first
+    sccs->levels_count = 0;
+    for (unsigned int i = 0; i < sccs->count; i++) {
+        level = 0;
+        for (unsigned int j = firsts[i]; j < firsts[i + 1]; j++) {
+            for (unsigned int k = 0; k < func_sccs_callees_count(qvm, indirect, members[j]); k++)
+                if ((callee = func_sccs_callee(qvm, indirect, members[j], k)) < count && components[callee] != i && levels[components[callee]] + 1 > level)
+                    level = levels[components[callee]] + 1;
+        }
+        levels[i] = level;
+        if (level + 1 > sccs->levels_count)
+            sccs->levels_count = level + 1;
+    }
+
+    // sort the components by level, keeping the callees first in a level
+    memset(sccs->levels, 0, sizeof(*sccs->levels) * (sccs->levels_count + 1));
+    for (unsigned int i = 0; i < sccs->count; i++)
+        sccs->levels[levels[i] + 1]++;
+    for (unsigned int i = 0; i < sccs->levels_count; i++)
+        sccs->levels[i + 1] += sccs->levels[i];
+    for (unsigned int i = 0; i < sccs->count; i++)
+        order[sccs->levels[levels[i]]++] = i;
+    for (unsigned int i = sccs->levels_count; i > 0; i--)
+        sccs->levels[i] = sccs->levels[i - 1];
+    sccs->levels[0] = 0;
+
+    // store the functions of each component in the levels order
+    for (unsigned int i = 0; i < sccs->count; i++) {
+        sccs->starts[i] = offset;
+        for (unsigned int j = firsts[order[i]]; j < firsts[order[i] + 1]; j++)
+            sccs->functions[offset++] = members[j];
+    }
+    sccs->starts[sccs->count] = offset;
+
+    // free the functions by component and the components by level
+    free(members);
+    free(firsts);
+    free(order);
+
+    // success
+    return 1;
+}
+
+void func_sccs_free(qvm_function_sccs_t *sccs)
+{
+    // free the components
+    free(sccs->functions);
+    free(sccs->starts);
+    free(sccs->levels);
+    sccs->functions = NULL;
+    sccs->starts = NULL;
+    sccs->levels = NULL;
+    sccs->count = 0;
+    sccs->levels_count = 0;
+}
@@ -1,14 +1,27 @@
 #ifndef FUNCTIONS_H
 #define FUNCTIONS_H
 
+#define FUNC_SCCS_NONE  (unsigned int)-1
+
 typedef struct qvm_function_s       qvm_function_t;
 typedef struct qvm_function_list_s  qvm_function_list_t;
+typedef struct qvm_function_array_s qvm_function_array_t;
+typedef struct qvm_function_edge_s  qvm_function_edge_t;
+typedef struct qvm_function_graph_s qvm_function_graph_t;
+typedef struct qvm_function_sccs_s  qvm_function_sccs_t;
+
+typedef struct qvm_function_array_s {
+    qvm_function_t      **functions;
+    unsigned int        count;
+} qvm_function_array_t;
 
+#include "xrefs.h"
 #include "opblocks.h"
 #include "variables.h"
 
 typedef struct qvm_function_s {
     qvm_t               *qvm;
+    unsigned int        id;
     unsigned int        address;
     char                name[64];
     unsigned int        stack_size;
@@ -17,11 +30,16 @@ typedef struct qvm_function_s {
     qvm_opblock_t       *opblock_end;
     qvm_variable_t      *locals;
     qvm_function_t      *next;
-    qvm_function_list_t *calls;
-    qvm_function_list_t *called_by;
+    qvm_function_array_t calls;
+    qvm_function_array_t called_by;
+    qvm_xref_array_t    xrefs;
     unsigned int        op_size;
+    unsigned int        opstack_depth;
     unsigned int        locals_count;
+    unsigned int        args_count;
     char                variadic;
+    char                selected;
+    char                analyzed;
 } qvm_function_t;
 
 typedef struct qvm_function_list_s {
@@ -29,10 +47,47 @@ typedef struct qvm_function_list_s {
     qvm_function_list_t *next;
 } qvm_function_list_t;
 
+typedef struct qvm_function_edge_s {
+    qvm_function_array_t *array;
+    qvm_function_t      *function;
+    unsigned int        order;
+} qvm_function_edge_t;
+
+typedef struct qvm_function_graph_s {
+    qvm_function_edge_t *edges;
+    unsigned int        edges_count;
+    unsigned int        edges_size;
+    qvm_function_t      **adjacency;
+    unsigned int        adjacency_count;
+    char                frozen;
+} qvm_function_graph_t;
+
+typedef struct qvm_function_sccs_s {
+    unsigned int        *functions;
+    unsigned int        *starts;
+    unsigned int        *levels;
+    unsigned int        count;
+    unsigned int        levels_count;
+} qvm_function_sccs_t;
+
 void                func_init(qvm_function_t *func);
 qvm_function_t      *func_find(qvm_t *qvm, unsigned int address);
+qvm_function_t      *func_find_name(qvm_t *qvm, char *name);
 qvm_function_t      *func_add_syscall(qvm_t *qvm, unsigned int address);
 void                func_rename(qvm_function_t *func, char *name);
+void                func_rename_default(qvm_function_t *func);
+int                 func_is_default(qvm_function_t *func);
+unsigned long long  func_fingerprint(qvm_function_t *func);
+int                 func_opcode_value(qvm_function_t *func, unsigned int address, int *value);
 qvm_function_list_t *func_list_add(qvm_function_list_t **list, qvm_function_t *func);
+void                func_list_free(qvm_function_list_t *list);
+void                func_graph_init(qvm_function_graph_t *graph);
+int                 func_graph_add(qvm_function_graph_t *graph, qvm_function_array_t *array, qvm_function_t *func);
+int                 func_graph_freeze(qvm_function_graph_t *graph);
+void                func_graph_free(qvm_function_graph_t *graph);
+int                 func_sccs_load(qvm_t *qvm, qvm_function_sccs_t *sccs, char *indirect);
+unsigned int        func_sccs_callees_count(qvm_t *qvm, char *indirect, unsigned int id);
+unsigned int        func_sccs_callee(qvm_t *qvm, char *indirect, unsigned int id, unsigned int index);
+void                func_sccs_free(qvm_function_sccs_t *sccs);
 
 #endif
@@ -0,0 +1,24 @@
+#include "qvmd.h"
+
+unsigned long long  hash_data(unsigned long long hash, void *data, size_t size);
+unsigned long long  hash_str(unsigned long long hash, char *str);
+
+unsigned long long hash_data(unsigned long long hash, void *data, size_t size)
+{
+    unsigned char   *bytes = data;
+
+    // fnv-1a hash of the data
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    // return the hash
+    return hash;
+}
+
+unsigned long long hash_str(unsigned long long hash, char *str)
+{
+    // hash the string with its terminator
+    return hash_data(hash, str, strlen(str) + 1);
+}
@@ -0,0 +1,11 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+#define HASH_INIT   0xcbf29ce484222325ULL
+
+unsigned long long  hash_data(unsigned long long hash, void *data, size_t size);
+unsigned long long  hash_str(unsigned long long hash, char *str);
+
+#endif
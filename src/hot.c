@@ -0,0 +1,323 @@
+#include "qvmd.h"
+
+#define HOT_SYSCALL_COST    16
+#define HOT_NAMES_SIZE      128
+
+/*
+    The hot spots report ranks the functions and their loops by a static
+    cost, without running the qvm. Each opcode has a weight, the divisions
+    and the calls being the most expensive, and the weight of a block is
+    multiplied by its loop depth plus one. A syscall called in a loop adds
+    a fixed cost for each level of loop around it, since the engine call
+    is usually far more expensive than the opcodes of the qvm.
+*/
+
+typedef struct {
+    qvm_function_t  *function;
+    unsigned int    cost;
+    unsigned int    loops_count;
+    unsigned int    depth;
+    unsigned int    syscalls_count;
+} qvm_hot_function_t;
+
+typedef struct {
+    qvm_function_t  *function;
+    unsigned int    address;
+    unsigned int    cost;
+    unsigned int    depth;
+    unsigned int    blocks_count;
+    unsigned int    op_size;
+    unsigned int    syscalls_count;
+    char            syscalls[HOT_NAMES_SIZE];
+} qvm_hot_loop_t;
+
+typedef struct {
+    qvm_hot_function_t  *functions;
+    unsigned int        functions_count;
+    qvm_hot_loop_t      *loops;
+    unsigned int        loops_count;
+    unsigned int        loops_size;
+} qvm_hot_t;
+
+int                 qvm_hot(qvm_t *qvm, char *filename);
+static int          qvm_hot_function(qvm_hot_t *hot, qvm_function_t *func);
+static int          qvm_hot_loop(qvm_hot_t *hot, qvm_cfg_t *cfg, qvm_cfg_loop_t *loop, unsigned int *costs, unsigned int *syscalls);
+static void         qvm_hot_loop_syscalls(qvm_hot_loop_t *hot_loop, qvm_cfg_t *cfg, qvm_cfg_loop_t *loop);
+static unsigned int qvm_hot_weight(qvm_opcode_t *op);
+static int          qvm_hot_syscall(qvm_opcode_t *op);
+static int          qvm_hot_compare_functions(const void *a, const void *b);
+static int          qvm_hot_compare_loops(const void *a, const void *b);
+
+int qvm_hot(qvm_t *qvm, char *filename)
+{
+    qvm_hot_t       hot;
+    file_t          *file;
+    qvm_hot_loop_t  *loop;
+
+    // allocate the functions costs
+    memset(&hot, 0, sizeof(hot));
+    if (!(hot.functions = malloc(sizeof(*hot.functions) * (qvm->functions_count + 1)))) {
+        printf("Reporting hot spots to %s...Error: Couldn't allocate functions costs.\n", filename);
+        return 0;
+    }
+
+    // get the cost of each selected function and its loops
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        if (!qvm->functions[i].selected)
+            continue;
+        if (!qvm_hot_function(&hot, &qvm->functions[i])) {
+            free(hot.functions);
+            free(hot.loops);
+            return 0;
+        }
+    }
+
+    // rank the functions and the loops by cost
+    qsort(hot.functions, hot.functions_count, sizeof(*hot.functions), qvm_hot_compare_functions);
+    qsort(hot.loops, hot.loops_count, sizeof(*hot.loops), qvm_hot_compare_loops);
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Reporting hot spots to %s...Error: Couldn't create file.\n", filename);
+        free(hot.functions);
+        free(hot.loops);
+        return 0;
+    }
+
+    // print the report header
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tFunctions: %u\n", hot.functions_count);
+    file_print(file, "\tLoops: %u\n", hot.loops_count);
+    file_print(file, "\tCost: opcodes weight x (loop depth + 1) + %u x syscalls x loop depth\n", HOT_SYSCALL_COST);
+    file_print(file, "*/\n\n");
+
+    // print the functions ranked by cost
+    file_print(file, "// functions: cost, name, address, opcodes, loops, max depth, syscalls in loops\n");
+    for (unsigned int i = 0; i < hot.functions_count; i++)
+        file_print(file, "%u\t%s\t0x%x\t%u\t%u\t%u\t%u\n", hot.functions[i].cost, hot.functions[i].function->name, hot.functions[i].function->address,
+            hot.functions[i].function->op_size, hot.functions[i].loops_count, hot.functions[i].depth, hot.functions[i].syscalls_count);
+
+    // print the loops ranked by cost
+    file_print(file, "\n// loops: cost, function, header, depth, blocks, opcodes, syscalls\n");
+    for (unsigned int i = 0; i < hot.loops_count; i++) {
+        loop = &hot.loops[i];
+        file_print(file, "%u\t%s\t0x%x\t%u\t%u\t%u\t%u", loop->cost, loop->function->name, loop->address, loop->depth, loop->blocks_count, loop->op_size, loop->syscalls_count);
+        file_print(file, "%s%s\n", *loop->syscalls ? "\t" : "", loop->syscalls);
+    }
+
+    // free the created file and the costs
+    file_free(file);
+    free(hot.functions);
+    free(hot.loops);
+
+    printf("Reporting hot spots to %s...Success: %u functions and %u loops ranked.\n", filename, hot.functions_count, hot.loops_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_hot_function(qvm_hot_t *hot, qvm_function_t *func)
+{
+    qvm_hot_function_t  *hot_func = &hot->functions[hot->functions_count++];
+    qvm_cfg_t           cfg;
+    qvm_cfg_block_t     *block;
+    unsigned int        *costs;
+    unsigned int        *syscalls;
+    unsigned int        weight;
+    unsigned int        depth;
+    int                 success = 1;
+
+    // build the function graph, its dominators and its loops
+    hot_func->function = func;
+    hot_func->cost = 0;
+    hot_func->depth = 0;
+    hot_func->syscalls_count = 0;
+    if (!cfg_load(&cfg, func))
+        return 0;
+    if (!cfg_load_dominators(&cfg) || !cfg_load_loops(&cfg)) {
+        cfg_free(&cfg);
+        return 0;
+    }
+    hot_func->loops_count = cfg.loops_count;
+
+    // allocate the cost and the syscalls of each block
+    if (!(costs = calloc(cfg.blocks_count + 1, sizeof(*costs))) || !(syscalls = calloc(cfg.blocks_count + 1, sizeof(*syscalls)))) {
+        printf("Reporting hot spots...Error: Couldn't allocate blocks costs of %s.\n", func->name);
+        free(costs);
+        cfg_free(&cfg);
+        return 0;
+    }
+
+    // get the cost of each block from its opcodes and its depth
+    for (unsigned int i = 0; i < cfg.blocks_count; i++) {
+        block = &cfg.blocks[i];
+        depth = cfg_depth(&cfg, i);
+        weight = 0;
+        for (unsigned int j = block->start; j < block->end; j++) {
+            weight += qvm_hot_weight(&func->qvm->opcodes[j]);
+            syscalls[i] += qvm_hot_syscall(&func->qvm->opcodes[j]);
+        }
+        costs[i] = weight * (depth + 1) + HOT_SYSCALL_COST * syscalls[i] * depth;
+
+        // add the block to the function
+        hot_func->cost += costs[i];
+        if (depth > hot_func->depth)
+            hot_func->depth = depth;
+        if (depth)
+            hot_func->syscalls_count += syscalls[i];
+    }
+
+    // get the cost of each loop
+    for (unsigned int i = 0; i < cfg.loops_count && success; i++)
+        success = qvm_hot_loop(hot, &cfg, &cfg.loops[i], costs, syscalls);
+
+    // free the blocks costs and the graph
+    free(costs);
+    free(syscalls);
+    cfg_free(&cfg);
+
+    // return the status
+    return success;
+}
+
+static int qvm_hot_loop(qvm_hot_t *hot, qvm_cfg_t *cfg, qvm_cfg_loop_t *loop, unsigned int *costs, unsigned int *syscalls)
+{
+    qvm_hot_loop_t  *hot_loop;
+    qvm_hot_loop_t  *loops;
+    unsigned int    block;
+
+    // grow the loops if needed
+    if (hot->loops_count >= hot->loops_size) {
+        hot->loops_size = hot->loops_size ? hot->loops_size * 2 : 256;
+        if (!(loops = realloc(hot->loops, sizeof(*loops) * hot->loops_size))) {
+            printf("Reporting hot spots...Error: Couldn't allocate loops costs.\n");
+            return 0;
+        }
+        hot->loops = loops;
+    }
+
+    // initialize the loop
+    hot_loop = &hot->loops[hot->loops_count++];
+    hot_loop->function = cfg->function;
+    hot_loop->address = cfg->blocks[loop->header].start;
+    hot_loop->cost = 0;
+    hot_loop->depth = loop->depth;
+    hot_loop->blocks_count = loop->blocks_count;
+    hot_loop->op_size = 0;
+    hot_loop->syscalls_count = 0;
+
+    // sum the blocks of the loop, with the inner loops ones
+    for (unsigned int i = 0; i < loop->blocks_count; i++) {
+        block = cfg->loops_blocks[loop->blocks_start + i];
+        hot_loop->cost += costs[block];
+        hot_loop->op_size += cfg->blocks[block].end - cfg->blocks[block].start;
+        hot_loop->syscalls_count += syscalls[block];
+    }
+
+    // name the syscalls called in the loop
+    qvm_hot_loop_syscalls(hot_loop, cfg, loop);
+
+    // success
+    return 1;
+}
+
+static void qvm_hot_loop_syscalls(qvm_hot_loop_t *hot_loop, qvm_cfg_t *cfg, qvm_cfg_loop_t *loop)
+{
+    qvm_function_t  *sysc;
+    qvm_opcode_t    *op;
+    qvm_cfg_block_t *block;
+    unsigned int    addresses[HOT_NAMES_SIZE / 2];
+    unsigned int    addresses_count = 0;
+    unsigned int    k;
+    size_t          length = 0;
+
+    // browse the opcodes of the loop
+    *hot_loop->syscalls = 0;
+    for (unsigned int i = 0; i < loop->blocks_count; i++) {
+        block = &cfg->blocks[cfg->loops_blocks[loop->blocks_start + i]];
+        for (unsigned int j = block->start; j < block->end; j++) {
+            op = &cfg->function->qvm->opcodes[j];
+            if (!qvm_hot_syscall(op))
+                continue;
+
+            // find the syscall name
+            for (sysc = cfg->function->qvm->syscalls; sysc && sysc->address != (unsigned int)op[-1].value; sysc = sysc->next);
+
+            // add the name once if there is room left, a name takes two chars at least
+            if (!sysc)
+                continue;
+            for (k = 0; k < addresses_count && addresses[k] != sysc->address; k++);
+            if (k < addresses_count)
+                continue;
+            if (length + strlen(sysc->name) + 2 >= HOT_NAMES_SIZE)
+                return;
+            addresses[addresses_count++] = sysc->address;
+            length += sprintf(hot_loop->syscalls + length, "%s%s", length ? "," : "", sysc->name);
+        }
+    }
+}
+
+static unsigned int qvm_hot_weight(qvm_opcode_t *op)
+{
+    // get the opcode weight
+    switch (op->info->id) {
+        case OP_UNDEF:
+        case OP_IGNORE:
+        case OP_BREAK:
+            return 0;
+        case OP_CALL:
+            return 8;
+        case OP_BLOCK_COPY:
+            return 4 + op->value / 16;
+        case OP_DIVI:
+        case OP_DIVU:
+        case OP_MODI:
+        case OP_MODU:
+        case OP_DIVF:
+            return 6;
+        case OP_MULI:
+        case OP_MULU:
+        case OP_MULF:
+        case OP_CVIF:
+        case OP_CVFI:
+            return 3;
+        case OP_LOAD1:
+        case OP_LOAD2:
+        case OP_LOAD4:
+        case OP_STORE1:
+        case OP_STORE2:
+        case OP_STORE4:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static int qvm_hot_syscall(qvm_opcode_t *op)
+{
+    // a syscall is a call to a negative constant address
+    return op->info->id == OP_CALL && op->address && op[-1].info->id == OP_CONST && op[-1].value < 0;
+}
+
+static int qvm_hot_compare_functions(const void *a, const void *b)
+{
+    const qvm_hot_function_t    *fa = a;
+    const qvm_hot_function_t    *fb = b;
+
+    // the most expensive first, then by address
+    if (fa->cost != fb->cost)
+        return fa->cost > fb->cost ? -1 : 1;
+    return fa->function->address < fb->function->address ? -1 : fa->function->address > fb->function->address;
+}
+
+static int qvm_hot_compare_loops(const void *a, const void *b)
+{
+    const qvm_hot_loop_t    *la = a;
+    const qvm_hot_loop_t    *lb = b;
+
+    // the most expensive first, then by address
+    if (la->cost != lb->cost)
+        return la->cost > lb->cost ? -1 : 1;
+    return la->address < lb->address ? -1 : la->address > lb->address;
+}
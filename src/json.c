@@ -0,0 +1,217 @@
+#include "qvmd.h"
+
+int         qvm_json(qvm_t *qvm, char *filename);
+static void qvm_json_header(file_t *file, qvm_t *qvm);
+static void qvm_json_functions(file_t *file, qvm_t *qvm);
+static void qvm_json_function_locals(file_t *file, qvm_function_t *func);
+static void qvm_json_globals(file_t *file, qvm_t *qvm);
+static void qvm_json_syscalls(file_t *file, qvm_t *qvm);
+static void qvm_json_variable(file_t *file, qvm_variable_t *var);
+static void qvm_json_list(file_t *file, char *key, qvm_function_array_t *array);
+static void qvm_json_xrefs(file_t *file, qvm_xref_array_t *array);
+static void qvm_json_string(file_t *file, char *str);
+
+static char *qvm_json_status[VS_MAX] = {
+    "local",
+    "arg",
+    "global",
+    "literal",
+    "literal_text",
+    "bss"
+};
+
+int qvm_json(qvm_t *qvm, char *filename)
+{
+    file_t  *file;
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Exporting QVM to %s...Error: Couldn't create file.\n", filename);
+        return 0;
+    }
+
+    // print the header object
+    qvm_json_header(file, qvm);
+
+    // print one object per function
+    qvm_json_functions(file, qvm);
+
+    // print one object per global if all functions are selected
+    if (qvm->selected_count == qvm->functions_count)
+        qvm_json_globals(file, qvm);
+
+    // print one object per syscall
+    qvm_json_syscalls(file, qvm);
+
+    // free the created file
+    file_free(file);
+
+    printf("Exporting QVM to %s...Success.\n", filename);
+
+    // success
+    return 1;
+}
+
+static void qvm_json_header(file_t *file, qvm_t *qvm)
+{
+    file_print(file, "{\"type\":\"header\",\"version\":\"" QVMD_VERSION "\",\"name\":");
+    qvm_json_string(file, qvm->file->name);
+    file_print(file, ",\"opcodes\":%u", qvm->header->instructions_count);
+    file_print(file, ",\"functions\":%u", qvm->functions_count);
+    file_print(file, ",\"syscalls\":%u", qvm->syscalls_count);
+    file_print(file, ",\"globals\":%u", qvm->globals_count);
+    file_print(file, ",\"locals\":%u", qvm->locals_count);
+    file_print(file, ",\"calls_total\":%i", qvm->calls_total);
+    file_print(file, ",\"calls_restored\":%i", qvm->calls_restored);
+    file_print(file, ",\"restored_calls_perc\":%.2f}\n", qvm->restored_calls_perc);
+}
+
+static void qvm_json_functions(file_t *file, qvm_t *qvm)
+{
+    qvm_function_t  *func;
+
+    // browse all functions
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        // get the current function
+        func = &qvm->functions[i];
+        if (!func->selected)
+            continue;
+
+        // load the function analysis if needed
+        if (!qvm_load_function(qvm, func))
+            continue;
+
+        // print the function infos
+        file_print(file, "{\"type\":\"function\",\"name\":");
+        qvm_json_string(file, func->name);
+        file_print(file, ",\"address\":%u", func->address);
+        file_print(file, ",\"stack_size\":%u", func->stack_size);
+        file_print(file, ",\"op_size\":%u", func->op_size);
+        file_print(file, ",\"opstack_depth\":%u", func->opstack_depth);
+        file_print(file, ",\"return_size\":%u", func->return_size);
+        file_print(file, ",\"locals_count\":%u", func->locals_count);
+        file_print(file, ",\"args\":%u", func->args_count);
+        file_print(file, ",\"variadic\":%s", func->variadic ? "true" : "false");
+
+        // print the function calls and callers
+        qvm_json_list(file, "calls", &func->calls);
+        qvm_json_list(file, "called_by", &func->called_by);
+        qvm_json_xrefs(file, &func->xrefs);
+
+        // print the function locals and arguments
+        qvm_json_function_locals(file, func);
+
+        // end the function object
+        file_print(file, "}\n");
+
+        // free the function analysis if needed
+        qvm_unload_function(qvm, func);
+    }
+}
+
+static void qvm_json_function_locals(file_t *file, qvm_function_t *func)
+{
+    qvm_variable_t  *var;
+
+    // print all locals and arguments
+    file_print(file, ",\"locals\":[");
+    for (var = func->locals; var; var = var->next) {
+        if (var != func->locals)
+            file_print(file, ",");
+        file_print(file, "{");
+        qvm_json_variable(file, var);
+        file_print(file, "}");
+    }
+    file_print(file, "]");
+}
+
+static void qvm_json_globals(file_t *file, qvm_t *qvm)
+{
+    qvm_variable_t  *var;
+
+    // browse all globals
+    for (var = qvm->globals; var; var = var->next) {
+        file_print(file, "{\"type\":\"global\",");
+        qvm_json_variable(file, var);
+        qvm_json_list(file, "parents", &var->parents);
+        qvm_json_xrefs(file, &var->xrefs);
+        file_print(file, "}\n");
+    }
+}
+
+static void qvm_json_syscalls(file_t *file, qvm_t *qvm)
+{
+    qvm_function_t  *sysc;
+
+    // browse all syscalls
+    for (sysc = qvm->syscalls; sysc; sysc = sysc->next) {
+        file_print(file, "{\"type\":\"syscall\",\"name\":");
+        qvm_json_string(file, sysc->name);
+        file_print(file, ",\"address\":%i", (int)sysc->address);
+        file_print(file, ",\"args\":%u", sysc->args_count);
+        qvm_json_list(file, "called_by", &sysc->called_by);
+        qvm_json_xrefs(file, &sysc->xrefs);
+        file_print(file, "}\n");
+    }
+}
+
+static void qvm_json_variable(file_t *file, qvm_variable_t *var)
+{
+    // print the variable infos without closing the object
+    file_print(file, "\"name\":");
+    qvm_json_string(file, var->name);
+    file_print(file, ",\"address\":%u", var->address);
+    file_print(file, ",\"size\":%u", var->size);
+    file_print(file, ",\"status\":\"%s\"", qvm_json_status[var->status]);
+    if (var->type)
+        file_print(file, ",\"var_type\":\"%s\"", var->type->name);
+    if (var->variadic)
+        file_print(file, ",\"variadic\":true");
+}
+
+static void qvm_json_list(file_t *file, char *key, qvm_function_array_t *array)
+{
+    // print the functions name array
+    file_print(file, ",\"%s\":[", key);
+    for (unsigned int i = 0; i < array->count; i++) {
+        if (i)
+            file_print(file, ",");
+        qvm_json_string(file, array->functions[i]->name);
+    }
+    file_print(file, "]");
+}
+
+static void qvm_json_xrefs(file_t *file, qvm_xref_array_t *array)
+{
+    qvm_xref_t  *xref;
+
+    // print the cross references array
+    file_print(file, ",\"xrefs\":[");
+    for (unsigned int i = 0; i < array->count; i++) {
+        xref = &array->xrefs[i];
+        if (i)
+            file_print(file, ",");
+        file_print(file, "{\"kind\":\"%s\",\"address\":%u,\"function\":", qvm_xrefs_names[xref->kind], xref->address);
+        if (xref->function)
+            qvm_json_string(file, xref->function->name);
+        else
+            file_print(file, "null");
+        file_print(file, "}");
+    }
+    file_print(file, "]");
+}
+
+static void qvm_json_string(file_t *file, char *str)
+{
+    // print the escaped string
+    file_print(file, "\"");
+    for (; *str; str++) {
+        if (*str == '\"' || *str == '\\')
+            file_print(file, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            file_print(file, "\\u%04x", (unsigned char)*str);
+        else
+            file_print(file, "%c", *str);
+    }
+    file_print(file, "\"");
+}
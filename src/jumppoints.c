@@ -15,9 +15,11 @@ qvm_jumppoint_t *jumppoint_new(void)
     }
 
     // initialize the jumppoint infos
+    jmp->id = 0;
     jmp->address = 0;
     *jmp->name = 0;
     jmp->parents_count = 0;
+    jmp->opblock = NULL;
     jmp->next = NULL;
 
     // return the jumppoint
@@ -28,6 +30,10 @@ qvm_jumppoint_t *jumppoint_find(qvm_t *qvm, unsigned int address)
 {
     qvm_jumppoint_t *jmp;
 
+    // use the jumppoints index if the address is a valid instruction
+    if (qvm->jumppoints_index && address < qvm->header->instructions_count)
+        return qvm->jumppoints_index[address];
+
     // find the jumppoint that have the same address
     for (jmp = qvm->jumppoints; jmp; jmp = jmp->next)
         if (jmp->address == address)
@@ -55,10 +61,15 @@ int jumppoint_add(qvm_t *qvm, unsigned int address)
 
     // set the jumppoint infos if needed
     if (added) {
+        jmp->id = qvm->jumppoints_count++;
         jmp->address = address;
         sprintf(jmp->name, "jmp_%x", address);
         jmp->next = qvm->jumppoints;
         qvm->jumppoints = jmp;
+
+        // save the jumppoint in the index if needed
+        if (qvm->jumppoints_index && address < qvm->header->instructions_count)
+            qvm->jumppoints_index[address] = jmp;
     }
 
     // success
@@ -4,9 +4,11 @@
 typedef struct qvm_jumppoint_s  qvm_jumppoint_t;
 
 typedef struct qvm_jumppoint_s {
+    unsigned int    id;
     unsigned int    address;
     char            name[32];
     int             parents_count;
+    qvm_opblock_t   *opblock;
     qvm_jumppoint_t *next;
 } qvm_jumppoint_t;
 
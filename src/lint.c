@@ -0,0 +1,379 @@
+#include "qvmd.h"
+
+#define LINT_MAX_GENTITIES      1024
+#define LINT_LOOP_ITERATIONS    8
+#define LINT_ITERATIONS_MAX     (LINT_MAX_GENTITIES * LINT_MAX_GENTITIES)
+#define LINT_COPY_MIN           256
+#define LINT_FORMAT_COST        200
+#define LINT_WARNINGS_MIN       256
+
+/*
+    The lint flags the code patterns known to cost server frame time: the
+    expensive syscalls called in loops, the big block copies in loops and
+    the string formatting repeated in loops of the functions called every
+    frame. The loops come from the control flow graph, a loop going back
+    while its counter is under MAX_GENTITIES being counted for all its
+    iterations and the other ones for a few. The called functions come
+    from the opblocks of the calls, and the per-frame functions are the
+    ones reached from the frame entry points in the calls graph. The costs
+    are estimated in opcodes per call of the flagged function.
+*/
+
+typedef enum {
+    LINT_SYSCALL,
+    LINT_COPY,
+    LINT_FORMAT,
+    LINT_MAX
+} qvm_lint_e;
+
+typedef struct {
+    char            *name;
+    unsigned int    cost;
+} qvm_lint_call_t;
+
+typedef struct {
+    qvm_lint_e          type;
+    qvm_function_t      *function;
+    unsigned int        address;
+    unsigned long long  cost;
+    unsigned int        iterations;
+    char                *name;
+    unsigned int        size;
+} qvm_lint_warning_t;
+
+typedef struct {
+    qvm_t               *qvm;
+    char                *frames;
+    qvm_lint_warning_t  *warnings;
+    unsigned int        warnings_count;
+    unsigned int        warnings_size;
+} qvm_lint_t;
+
+int                 qvm_lint(qvm_t *qvm, char *filename);
+static int          qvm_lint_frames(qvm_lint_t *lint);
+static int          qvm_lint_function(qvm_lint_t *lint, qvm_function_t *func);
+static int          qvm_lint_loops(qvm_cfg_t *cfg, unsigned int **iterations);
+static int          qvm_lint_opcode(qvm_lint_t *lint, qvm_function_t *func, qvm_opcode_t *op, unsigned int iterations);
+static int          qvm_lint_add(qvm_lint_t *lint, qvm_lint_e type, qvm_function_t *func, qvm_opcode_t *op, unsigned int cost, unsigned int iterations);
+static unsigned int qvm_lint_find(qvm_lint_call_t *calls, char *name);
+static int          qvm_lint_compare(const void *a, const void *b);
+
+static char *qvm_lint_names[LINT_MAX] = {
+    "syscall_in_loop",
+    "copy_in_loop",
+    "format_per_frame"
+};
+
+static char *qvm_lint_frames_names[] = {
+    "G_RunFrame",
+    "CG_DrawActiveFrame",
+    "UI_Refresh",
+    NULL
+};
+
+static qvm_lint_call_t qvm_lint_syscalls[] = {
+    { "trap_Trace", 2000 },
+    { "trap_TraceCapsule", 2000 },
+    { "trap_CM_BoxTrace", 2000 },
+    { "trap_CM_CapsuleTrace", 2000 },
+    { "trap_CM_TransformedBoxTrace", 2000 },
+    { "trap_EntitiesInBox", 1000 },
+    { "trap_InPVS", 500 },
+    { "trap_InPVSIgnorePortals", 500 },
+    { "trap_PointContents", 300 },
+    { "trap_CM_PointContents", 300 },
+    { "trap_LinkEntity", 300 },
+    { "trap_UnlinkEntity", 200 },
+    { "trap_AAS_AreaTravelTimeToGoalArea", 1000 },
+    { "trap_AAS_PointAreaNum", 300 },
+    { NULL, 0 }
+};
+
+static qvm_lint_call_t qvm_lint_formats[] = {
+    { "va", LINT_FORMAT_COST },
+    { "Com_sprintf", LINT_FORMAT_COST },
+    { "Q_vsnprintf", LINT_FORMAT_COST },
+    { "vsprintf", LINT_FORMAT_COST },
+    { "sprintf", LINT_FORMAT_COST },
+    { "Info_SetValueForKey", LINT_FORMAT_COST },
+    { "G_Printf", LINT_FORMAT_COST },
+    { "G_LogPrintf", LINT_FORMAT_COST },
+    { "CG_Printf", LINT_FORMAT_COST },
+    { "Com_Printf", LINT_FORMAT_COST },
+    { NULL, 0 }
+};
+
+int qvm_lint(qvm_t *qvm, char *filename)
+{
+    qvm_lint_t          lint;
+    qvm_lint_warning_t  *warning;
+    file_t              *file;
+
+    // find the functions called every frame
+    memset(&lint, 0, sizeof(lint));
+    lint.qvm = qvm;
+    if (!qvm_lint_frames(&lint)) {
+        printf("Linting QVM to %s...Error: Couldn't allocate frame functions.\n", filename);
+        return 0;
+    }
+
+    // lint each selected function
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        if (!qvm->functions[i].selected)
+            continue;
+        if (!qvm_lint_function(&lint, &qvm->functions[i])) {
+            free(lint.frames);
+            free(lint.warnings);
+            return 0;
+        }
+    }
+
+    // rank the warnings by cost
+    qsort(lint.warnings, lint.warnings_count, sizeof(*lint.warnings), qvm_lint_compare);
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Linting QVM to %s...Error: Couldn't create file.\n", filename);
+        free(lint.frames);
+        free(lint.warnings);
+        return 0;
+    }
+
+    // print the report header
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tWarnings: %u\n", lint.warnings_count);
+    file_print(file, "\tCost: estimated opcodes per call of the function, a loop over MAX_GENTITIES runs %u times, other loops %u times\n", LINT_MAX_GENTITIES, LINT_LOOP_ITERATIONS);
+    file_print(file, "*/\n\n");
+
+    // print the warnings ranked by cost
+    file_print(file, "// warnings: cost, type, function, address, iterations, detail\n");
+    for (unsigned int i = 0; i < lint.warnings_count; i++) {
+        warning = &lint.warnings[i];
+        file_print(file, "%llu\t%s\t%s\t0x%x\t%u\t", warning->cost, qvm_lint_names[warning->type], warning->function->name, warning->address, warning->iterations);
+        if (warning->type == LINT_COPY)
+            file_print(file, "%u bytes\n", warning->size);
+        else
+            file_print(file, "%s\n", warning->name);
+    }
+
+    // free the created file and the warnings
+    file_free(file);
+    free(lint.frames);
+    free(lint.warnings);
+
+    printf("Linting QVM to %s...Success: %u warnings found.\n", filename, lint.warnings_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_lint_frames(qvm_lint_t *lint)
+{
+    qvm_t           *qvm = lint->qvm;
+    qvm_function_t  *func;
+    qvm_function_t  *callee;
+    unsigned int    *stack;
+    unsigned int    stack_count = 0;
+
+    // allocate the frame flags and the walk stack
+    if (!(lint->frames = calloc(qvm->functions_count + 1, sizeof(*lint->frames))))
+        return 0;
+    if (!(stack = malloc(sizeof(*stack) * (qvm->functions_count + 1)))) {
+        free(lint->frames);
+        lint->frames = NULL;
+        return 0;
+    }
+
+    // start from the frame entry points
+    for (unsigned int i = 0; qvm_lint_frames_names[i]; i++)
+        if ((func = func_find_name(qvm, qvm_lint_frames_names[i])) && func->id < qvm->functions_count && !lint->frames[func->id]) {
+            lint->frames[func->id] = 1;
+            stack[stack_count++] = func->id;
+        }
+
+    // walk the functions they call
+    while (stack_count) {
+        func = &qvm->functions[stack[--stack_count]];
+        for (unsigned int i = 0; i < func->calls.count; i++) {
+            callee = func->calls.functions[i];
+            if (callee->id >= qvm->functions_count || lint->frames[callee->id])
+                continue;
+            lint->frames[callee->id] = 1;
+            stack[stack_count++] = callee->id;
+        }
+    }
+
+    // free the walk stack
+    free(stack);
+
+    // success
+    return 1;
+}
+
+static int qvm_lint_function(qvm_lint_t *lint, qvm_function_t *func)
+{
+    qvm_cfg_t       cfg;
+    qvm_cfg_block_t *block;
+    unsigned int    *iterations = NULL;
+    int             success = 1;
+
+    // load the function analysis if needed
+    if (!qvm_load_function(lint->qvm, func))
+        return 1;
+
+    // build the function graph and its loops
+    if (!cfg_load(&cfg, func)) {
+        qvm_unload_function(lint->qvm, func);
+        return 0;
+    }
+    if (!cfg_load_dominators(&cfg) || !cfg_load_loops(&cfg) || !qvm_lint_loops(&cfg, &iterations)) {
+        cfg_free(&cfg);
+        qvm_unload_function(lint->qvm, func);
+        return 0;
+    }
+
+    // lint the opcodes of each block
+    for (unsigned int i = 0; i < cfg.blocks_count && success; i++) {
+        block = &cfg.blocks[i];
+        for (unsigned int j = block->start; j < block->end && success; j++)
+            success = qvm_lint_opcode(lint, func, &lint->qvm->opcodes[j], iterations[i]);
+    }
+
+    // free the graph and the function analysis if needed
+    free(iterations);
+    cfg_free(&cfg);
+    qvm_unload_function(lint->qvm, func);
+
+    // return the status
+    return success;
+}
+
+static int qvm_lint_loops(qvm_cfg_t *cfg, unsigned int **iterations)
+{
+    qvm_cfg_block_t *block;
+    qvm_opcode_t    *op;
+    unsigned int    *loops;
+    unsigned int    loop;
+
+    // allocate the iterations of each block and each loop
+    if (!(*iterations = malloc(sizeof(**iterations) * (cfg->blocks_count + 1))) ||
+        !(loops = malloc(sizeof(*loops) * (cfg->loops_count + 1)))) {
+        printf("Linting QVM...Error: Couldn't allocate loops iterations of %s.\n", cfg->function->name);
+        free(*iterations);
+        *iterations = NULL;
+        return 0;
+    }
+
+    // a loop going back to its header while under MAX_GENTITIES runs over all entities, its parent loops come first
+    for (unsigned int i = 0; i < cfg->loops_count; i++) {
+        loops[i] = LINT_LOOP_ITERATIONS;
+        for (unsigned int j = 0; j < cfg->blocks[cfg->loops[i].header].preds_count; j++) {
+            block = &cfg->blocks[cfg->preds[cfg->blocks[cfg->loops[i].header].preds_start + j]];
+            op = &cfg->function->qvm->opcodes[block->end - 1];
+            if (block->end - block->start > 1 && op->info->opblock_id == OPB_COMPARE && (unsigned int)op->value == cfg->blocks[cfg->loops[i].header].start &&
+                op[-1].info->id == OP_CONST && op[-1].value == LINT_MAX_GENTITIES)
+                loops[i] = LINT_MAX_GENTITIES;
+        }
+        if (cfg->loops[i].parent != CFG_NONE)
+            loops[i] *= loops[cfg->loops[i].parent];
+
+        // keep the costs in range for the deepest loops
+        if (loops[i] > LINT_ITERATIONS_MAX)
+            loops[i] = LINT_ITERATIONS_MAX;
+    }
+
+    // a block runs as many times as its innermost loop
+    for (unsigned int i = 0; i < cfg->blocks_count; i++) {
+        loop = cfg->inner[i];
+        (*iterations)[i] = loop == CFG_NONE ? 1 : loops[loop];
+    }
+
+    // free the loops iterations
+    free(loops);
+
+    // success
+    return 1;
+}
+
+static int qvm_lint_opcode(qvm_lint_t *lint, qvm_function_t *func, qvm_opcode_t *op, unsigned int iterations)
+{
+    qvm_function_t  *called;
+    unsigned int    cost;
+
+    // a big block copy in a loop
+    if (op->info->id == OP_BLOCK_COPY) {
+        if (iterations > 1 && (unsigned int)op->value >= LINT_COPY_MIN)
+            return qvm_lint_add(lint, LINT_COPY, func, op, op->value / 4, iterations);
+        return 1;
+    }
+
+    // get the function called from the call opblock
+    if (op->info->id != OP_CALL || !op->opblock || !(called = op->opblock->function_called))
+        return 1;
+
+    // an expensive syscall in a loop
+    if (called->id >= lint->qvm->functions_count) {
+        if (iterations > 1 && (cost = qvm_lint_find(qvm_lint_syscalls, called->name)))
+            return qvm_lint_add(lint, LINT_SYSCALL, func, op, cost, iterations);
+        return 1;
+    }
+
+    // a string formatting repeated in a loop of a function called every frame
+    if (iterations > 1 && lint->frames[func->id] && (cost = qvm_lint_find(qvm_lint_formats, called->name)))
+        return qvm_lint_add(lint, LINT_FORMAT, func, op, cost, iterations);
+
+    // success
+    return 1;
+}
+
+static int qvm_lint_add(qvm_lint_t *lint, qvm_lint_e type, qvm_function_t *func, qvm_opcode_t *op, unsigned int cost, unsigned int iterations)
+{
+    qvm_lint_warning_t  *warnings;
+    qvm_lint_warning_t  *warning;
+
+    // grow the warnings if needed
+    if (lint->warnings_count >= lint->warnings_size) {
+        lint->warnings_size = lint->warnings_size ? lint->warnings_size * 2 : LINT_WARNINGS_MIN;
+        if (!(warnings = realloc(lint->warnings, sizeof(*warnings) * lint->warnings_size))) {
+            printf("Linting QVM...Error: Couldn't allocate warnings.\n");
+            return 0;
+        }
+        lint->warnings = warnings;
+    }
+
+    // add the warning
+    warning = &lint->warnings[lint->warnings_count++];
+    warning->type = type;
+    warning->function = func;
+    warning->address = op->address;
+    warning->cost = (unsigned long long)cost * iterations;
+    warning->iterations = iterations;
+    warning->name = type == LINT_COPY ? NULL : op->opblock->function_called->name;
+    warning->size = type == LINT_COPY ? (unsigned int)op->value : 0;
+
+    // success
+    return 1;
+}
+
+static unsigned int qvm_lint_find(qvm_lint_call_t *calls, char *name)
+{
+    // find the cost of the call by name
+    for (unsigned int i = 0; calls[i].name; i++)
+        if (!strcmp(calls[i].name, name))
+            return calls[i].cost;
+
+    // the call isn't flagged
+    return 0;
+}
+
+static int qvm_lint_compare(const void *a, const void *b)
+{
+    const qvm_lint_warning_t    *wa = a;
+    const qvm_lint_warning_t    *wb = b;
+
+    // the most expensive first, then by address
+    if (wa->cost != wb->cost)
+        return wa->cost > wb->cost ? -1 : 1;
+    return wa->address < wb->address ? -1 : wa->address > wb->address;
+}
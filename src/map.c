@@ -1,37 +1,423 @@
 #include "qvmd.h"
+#include <sys/stat.h>
+#include <errno.h>
 
-qvm_map_t   *map_new(void);
-int         map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *));
+/*
+    The map cache file holds the parsed map entries before they are placed
+    in the qvm sections: a header followed by fixed size entry records and
+    the names, each one ended by a zero, that the records point to.
+*/
 
-qvm_map_t *map_new(void)
+typedef struct {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned long long  key;
+    unsigned int        count;
+    unsigned int        names_size;
+} map_cache_header_t;
+
+typedef struct {
+    unsigned int        section_id;
+    unsigned int        address;
+    unsigned int        line;
+    unsigned int        name;
+} map_cache_entry_t;
+
+void            map_init(qvm_map_table_t *table);
+int             map_parse(qvm_map_table_t *table, char *content, size_t size);
+static long     map_parse_number(char *cursor, char *end, int base);
+static char     *map_parse_token(char *cursor, char *end);
+static int      map_is_print(char *str, size_t size);
+static void     map_cache_get_filename(char *filename, size_t size, char *dirname, unsigned long long key);
+int             map_cache_load(qvm_map_table_t *table, char *dirname, unsigned long long key);
+int             map_cache_save(qvm_map_table_t *table, char *dirname, unsigned long long key);
+int             map_index(qvm_map_table_t *table);
+static int      map_compare(const void *a, const void *b);
+static int      map_is_before(qvm_map_t *map, char code, unsigned int address);
+unsigned int    map_find_address(qvm_map_table_t *table, char code, unsigned int address);
+qvm_map_t       *map_find(qvm_map_table_t *table, qvm_map_t *entry);
+int             map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *));
+void            map_free(qvm_map_table_t *table);
+
+void map_init(qvm_map_table_t *table)
 {
-    qvm_map_t   *map;
+    table->entries = NULL;
+    table->count = 0;
+    table->sorted = NULL;
+    table->hashed = NULL;
+    table->hashed_size = 0;
+}
 
-    // allocate the map entry
-    if (!(map = malloc(sizeof(*map)))) {
-        printf("Error: Couldn't allocate new map entry.\n");
-        return NULL;
+int map_parse(qvm_map_table_t *table, char *content, size_t size)
+{
+    char            *end = content + size;
+    char            *line;
+    char            *line_end;
+    char            *text_end;
+    char            *cursor;
+    size_t          length;
+    long            section_id;
+    long            address;
+    qvm_map_t       *entry;
+    unsigned int    lines = 1;
+    unsigned int    line_count = 0;
+
+    // count the lines to allocate all the entries at once
+    for (cursor = content; (cursor = memchr(cursor, '\n', end - cursor)); cursor++)
+        lines++;
+    if (!(table->entries = malloc(sizeof(*table->entries) * lines))) {
+        printf("Error: Couldn't allocate map entries.\n");
+        return 0;
     }
 
-    // set the default map entry values
-    map->section_id = -1;
-    map->address = 0;
-    *map->name = 0;
-    map->next = NULL;
+    // browse all the lines without copying them
+    for (line = content; line < end; line = line_end + (line_end < end)) {
+        // find the end of the line without its end-of-line
+        if (!(line_end = memchr(line, '\n', end - line)))
+            line_end = end;
+        text_end = line_end;
+        if (line_end < end && text_end > line && text_end[-1] == '\r')
+            text_end--;
 
-    // return the new map entry
-    return map;
+        // increase the line count and skip the blank lines
+        line_count++;
+        if (text_end == line)
+            continue;
+
+        // parse the section id and the address
+        section_id = map_parse_number(line, text_end, 10);
+        cursor = map_parse_token(line, text_end);
+        address = map_parse_number(cursor, text_end, 16);
+
+        // get the name
+        cursor = map_parse_token(cursor, text_end);
+        length = text_end - cursor;
+
+        // check if the name is too big
+        if (length >= sizeof(entry->name)) {
+            printf("Warning: Line %i of map file was ignored: Too long name.\n", line_count);
+            continue;
+        }
+
+        // check if name is only printable char
+        if (!map_is_print(cursor, length)) {
+            printf("Warning: Line %i of map file was ignored: Invalid name.\n", line_count);
+            continue;
+        }
+
+        // check if the section id is valid
+        if (section_id < 0 || section_id >= S_MAX) {
+            printf("Warning: Line %i of map file was ignored: Invalid section id.\n", line_count);
+            continue;
+        }
+
+        // add the map entry
+        entry = &table->entries[table->count++];
+        entry->section_id = section_id;
+        entry->address = address;
+        entry->line = line_count;
+        memcpy(entry->name, cursor, length);
+        entry->name[length] = 0;
+    }
+
+    // success
+    return 1;
 }
 
-int map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *))
+static long map_parse_number(char *cursor, char *end, int base)
+{
+    long    value = 0;
+    long    sign = 1;
+    int     digit;
+
+    // skip the spaces and the sign
+    while (cursor < end && isspace((unsigned char)*cursor))
+        cursor++;
+    if (cursor < end && (*cursor == '-' || *cursor == '+'))
+        sign = *cursor++ == '-' ? -1 : 1;
+
+    // skip the hexadecimal prefix
+    if (base == 16 && end - cursor > 2 && cursor[0] == '0' && (cursor[1] == 'x' || cursor[1] == 'X') && isxdigit((unsigned char)cursor[2]))
+        cursor += 2;
+
+    // parse the digits
+    for (; cursor < end; cursor++) {
+        if (isdigit((unsigned char)*cursor))
+            digit = *cursor - '0';
+        else if (base == 16 && isxdigit((unsigned char)*cursor))
+            digit = tolower((unsigned char)*cursor) - 'a' + 10;
+        else
+            break;
+        value = value * base + digit;
+    }
+
+    // return the number
+    return value * sign;
+}
+
+static char *map_parse_token(char *cursor, char *end)
+{
+    // skip the token and the spaces after it
+    while (cursor < end && isalnum((unsigned char)*cursor))
+        cursor++;
+    while (cursor < end && isspace((unsigned char)*cursor))
+        cursor++;
+
+    // return the next token
+    return cursor;
+}
+
+static int map_is_print(char *str, size_t size)
+{
+    // check empty string
+    if (!size)
+        return 0;
+
+    // find a non-printable character
+    for (size_t i = 0; i < size; i++)
+        if (!isprint((unsigned char)str[i]))
+            return 0;
+
+    // we didn't find any
+    return 1;
+}
+
+static void map_cache_get_filename(char *filename, size_t size, char *dirname, unsigned long long key)
+{
+    snprintf(filename, size, "%s/%016llx.qvmm", dirname, key);
+}
+
+int map_cache_load(qvm_map_table_t *table, char *dirname, unsigned long long key)
+{
+    char                filename[PATH_MAX];
+    file_t              *file;
+    map_cache_header_t  *header;
+    map_cache_entry_t   *rec;
+    char                *names;
+    size_t              length;
+
+    // map the cache file
+    map_cache_get_filename(filename, sizeof(filename), dirname, key);
+    if (!(file = file_map(filename)))
+        return 0;
+
+    // check the cache header
+    header = (map_cache_header_t *)file->content;
+    if (file->size < sizeof(*header) ||
+        header->magic != MAP_CACHE_MAGIC ||
+        header->version != MAP_CACHE_VERSION ||
+        header->key != key ||
+        file->size != sizeof(*header) + header->count * sizeof(*rec) + header->names_size) {
+        printf("Warning: %s: Invalid map cache file.\n", filename);
+        file_free(file);
+        return 0;
+    }
+    rec = (map_cache_entry_t *)(header + 1);
+    names = (char *)(rec + header->count);
+
+    // allocate all the entries
+    if (!(table->entries = malloc(sizeof(*table->entries) * (header->count + 1)))) {
+        printf("Error: Couldn't allocate map entries.\n");
+        file_free(file);
+        return 0;
+    }
+
+    // load all the entries
+    for (unsigned int i = 0; i < header->count; i++, rec++) {
+        // check the entry record
+        if (rec->section_id >= S_MAX || rec->name >= header->names_size ||
+            (length = strnlen(names + rec->name, header->names_size - rec->name)) >= sizeof(table->entries->name) ||
+            rec->name + length >= header->names_size) {
+            printf("Warning: %s: Corrupted map cache file.\n", filename);
+            map_free(table);
+            file_free(file);
+            return 0;
+        }
+
+        // set the entry
+        table->entries[i].section_id = rec->section_id;
+        table->entries[i].address = rec->address;
+        table->entries[i].line = rec->line;
+        memcpy(table->entries[i].name, names + rec->name, length + 1);
+    }
+    table->count = header->count;
+
+    // free the mapped file
+    file_free(file);
+
+    // success
+    return 1;
+}
+
+int map_cache_save(qvm_map_table_t *table, char *dirname, unsigned long long key)
+{
+    char                filename[PATH_MAX];
+    char                tmp_filename[PATH_MAX + 16];
+    map_cache_header_t  header;
+    map_cache_entry_t   rec;
+    file_t              *file;
+    int                 success;
+
+    // set the cache header
+    header.magic = MAP_CACHE_MAGIC;
+    header.version = MAP_CACHE_VERSION;
+    header.key = key;
+    header.count = table->count;
+    header.names_size = 0;
+    for (unsigned int i = 0; i < table->count; i++)
+        header.names_size += strlen(table->entries[i].name) + 1;
+
+    // create the cache directory if needed
+    if (mkdir(dirname, 0755) == -1 && errno != EEXIST) {
+        printf("Warning: Couldn't create cache directory %s.\n", dirname);
+        return 0;
+    }
+
+    // create a temporary file
+    map_cache_get_filename(filename, sizeof(filename), dirname, key);
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%i", filename, (int)getpid());
+    if (!(file = file_create(tmp_filename))) {
+        printf("Warning: Couldn't create map cache file %s.\n", tmp_filename);
+        return 0;
+    }
+
+    // write the header and the entry records
+    success = file_write(file, &header, sizeof(header));
+    header.names_size = 0;
+    for (unsigned int i = 0; success && i < table->count; i++) {
+        rec.section_id = table->entries[i].section_id;
+        rec.address = table->entries[i].address;
+        rec.line = table->entries[i].line;
+        rec.name = header.names_size;
+        header.names_size += strlen(table->entries[i].name) + 1;
+        success = file_write(file, &rec, sizeof(rec));
+    }
+
+    // write the names
+    for (unsigned int i = 0; success && i < table->count; i++)
+        success = file_write(file, table->entries[i].name, strlen(table->entries[i].name) + 1);
+    success = file_flush(file) && success;
+    file_free(file);
+
+    // replace the cache file atomically
+    if (!success || rename(tmp_filename, filename) == -1) {
+        printf("Warning: Couldn't write map cache file %s.\n", filename);
+        unlink(tmp_filename);
+        return 0;
+    }
+
+    // success
+    return 1;
+}
+
+int map_index(qvm_map_table_t *table)
+{
+    unsigned int    slot;
+
+    // allocate the sorted and the hashed entries
+    for (table->hashed_size = 16; table->hashed_size < table->count * 2; table->hashed_size *= 2);
+    if (!(table->sorted = malloc(sizeof(*table->sorted) * (table->count + 1))) ||
+        !(table->hashed = calloc(table->hashed_size, sizeof(*table->hashed)))) {
+        printf("Error: Couldn't allocate map index.\n");
+        return 0;
+    }
+
+    // sort the entries by address
+    for (unsigned int i = 0; i < table->count; i++)
+        table->sorted[i] = &table->entries[i];
+    qsort(table->sorted, table->count, sizeof(*table->sorted), map_compare);
+
+    // hash the entries by name
+    for (unsigned int i = 0; i < table->count; i++) {
+        slot = hash_str(HASH_INIT, table->entries[i].name) & (table->hashed_size - 1);
+        while (table->hashed[slot])
+            slot = (slot + 1) & (table->hashed_size - 1);
+        table->hashed[slot] = &table->entries[i];
+    }
+
+    // success
+    return 1;
+}
+
+static int map_compare(const void *a, const void *b)
+{
+    qvm_map_t   *map_a = *(qvm_map_t **)a;
+    qvm_map_t   *map_b = *(qvm_map_t **)b;
+
+    // sort the code entries before the data ones
+    if (map_is_before(map_a, map_b->section_id == S_CODE, map_b->address))
+        return -1;
+    if (map_is_before(map_b, map_a->section_id == S_CODE, map_a->address))
+        return 1;
+
+    // keep the file order for the same address
+    return map_a < map_b ? -1 : map_a > map_b;
+}
+
+static int map_is_before(qvm_map_t *map, char code, unsigned int address)
 {
-    qvm_map_t   *map;
+    // check if the entry is before the code or data address
+    if ((map->section_id == S_CODE) != code)
+        return map->section_id == S_CODE;
+    return map->address < address;
+}
+
+unsigned int map_find_address(qvm_map_table_t *table, char code, unsigned int address)
+{
+    unsigned int    low = 0;
+    unsigned int    high = table->count;
+    unsigned int    middle;
+
+    // search the first sorted entry not before the address
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (map_is_before(table->sorted[middle], code, address))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    // return its index
+    return low;
+}
 
+qvm_map_t *map_find(qvm_map_table_t *table, qvm_map_t *entry)
+{
+    unsigned int    slot;
+    qvm_map_t       *map;
+
+    // check if there is an index
+    if (!table->hashed)
+        return NULL;
+
+    // find the same entry from its name
+    slot = hash_str(HASH_INIT, entry->name) & (table->hashed_size - 1);
+    for (; (map = table->hashed[slot]); slot = (slot + 1) & (table->hashed_size - 1))
+        if (map->section_id == entry->section_id && map->address == entry->address && !strcmp(map->name, entry->name))
+            return map;
+
+    // we didn't find it
+    return NULL;
+}
+
+int map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *))
+{
     // browse all map entry
-    for (map = qvm->map; map; map = map->next)
-        if (!func(qvm, map))
+    for (unsigned int i = 0; i < qvm->map.count; i++)
+        if (!func(qvm, &qvm->map.entries[i]))
             return 0;
 
     // success
     return 1;
 }
+
+void map_free(qvm_map_table_t *table)
+{
+    // free the entries and their index
+    free(table->entries);
+    free(table->sorted);
+    free(table->hashed);
+
+    // reset the table
+    map_init(table);
+}
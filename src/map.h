@@ -1,16 +1,35 @@
 #ifndef MAP_H
 #define MAP_H
 
+#define MAP_CACHE_MAGIC     0x4d4d5651
+#define MAP_CACHE_VERSION   1
+
 typedef struct qvm_map_s        qvm_map_t;
+typedef struct qvm_map_table_s  qvm_map_table_t;
 
 typedef struct qvm_map_s {
     unsigned int    section_id;
     unsigned int    address;
+    unsigned int    line;
     char            name[64];
-    qvm_map_t       *next;
 } qvm_map_t;
 
-qvm_map_t   *map_new(void);
-int         map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *));
+typedef struct qvm_map_table_s {
+    qvm_map_t       *entries;
+    unsigned int    count;
+    qvm_map_t       **sorted;
+    qvm_map_t       **hashed;
+    unsigned int    hashed_size;
+} qvm_map_table_t;
+
+void            map_init(qvm_map_table_t *table);
+int             map_parse(qvm_map_table_t *table, char *content, size_t size);
+int             map_cache_load(qvm_map_table_t *table, char *dirname, unsigned long long key);
+int             map_cache_save(qvm_map_table_t *table, char *dirname, unsigned long long key);
+int             map_index(qvm_map_table_t *table);
+unsigned int    map_find_address(qvm_map_table_t *table, char code, unsigned int address);
+qvm_map_t       *map_find(qvm_map_table_t *table, qvm_map_t *entry);
+int             map_foreach(qvm_t *qvm, int (*func)(qvm_t *, qvm_map_t *));
+void            map_free(qvm_map_table_t *table);
 
 #endif
@@ -0,0 +1,243 @@
+#include "qvmd.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+#define MODULES_FILENAME_SIZE   PATH_MAX
+#define MODULES_REPORT_NAME     "common.txt"
+#define MODULES_FUNCTION_MIN    16
+
+/*
+    The modules of a mod (cgame, qagame and ui) are loaded and emitted
+    concurrently in one process. The opcodes, opblocks and types infos and
+    the syscalls tables are static and shared by all of them. Once they
+    are all analyzed, the functions are fingerprinted without the addresses
+    of their qvm to report the functions compiled in several modules, like
+    the bg_* and Q_* ones, which only need to be read once.
+*/
+
+typedef struct {
+    opt_module_t    *module;
+    qvm_t           *qvm;
+    char            *name;
+    char            output_filename[MODULES_FILENAME_SIZE];
+} qvm_module_t;
+
+typedef struct {
+    qvm_module_t        *module;
+    qvm_function_t      *function;
+    unsigned long long  fingerprint;
+} qvm_module_function_t;
+
+typedef struct {
+    opt_t           *opt;
+    qvm_module_t    *modules;
+    unsigned int    modules_count;
+} qvm_modules_t;
+
+int         qvm_modules(opt_t *opt);
+static int  qvm_modules_names(qvm_modules_t *modules);
+static int  qvm_modules_job(void *context, unsigned int index);
+static int  qvm_modules_report(qvm_modules_t *modules);
+static int  qvm_modules_report_compare(const void *a, const void *b);
+static int  qvm_modules_report_group(file_t *file, qvm_module_function_t *group, unsigned int count, unsigned int *saved);
+
+int qvm_modules(opt_t *opt)
+{
+    qvm_modules_t   modules;
+    int             success;
+
+    // create the output directory if needed
+    if (mkdir(opt->output_filename, 0755) == -1 && errno != EEXIST) {
+        printf("Error: Couldn't create directory %s.\n", opt->output_filename);
+        return 0;
+    }
+
+    // allocate the modules
+    modules.opt = opt;
+    modules.modules_count = opt->modules_count;
+    if (!(modules.modules = calloc(opt->modules_count, sizeof(*modules.modules)))) {
+        printf("Error: Couldn't allocate modules.\n");
+        return 0;
+    }
+
+    // load and emit all modules concurrently, then report their common functions
+    success = qvm_modules_names(&modules) &&
+        pool_run(modules.modules_count, opt->threads_count, &modules, qvm_modules_job) &&
+        qvm_modules_report(&modules);
+
+    // free all modules
+    for (unsigned int i = 0; i < modules.modules_count; i++)
+        if (modules.modules[i].qvm)
+            qvm_free(modules.modules[i].qvm);
+    free(modules.modules);
+
+    // return the status
+    return success;
+}
+
+static int qvm_modules_names(qvm_modules_t *modules)
+{
+    qvm_module_t    *module;
+    char            *ext;
+    char            *ext_name;
+    int             name_size;
+
+    // get the output extension of all modules
+    if (modules->opt->output_json)
+        ext = ".json";
+    else if (modules->opt->output_asm)
+        ext = ".asm";
+    else
+        ext = ".c";
+
+    // browse all modules
+    for (unsigned int i = 0; i < modules->modules_count; i++) {
+        module = &modules->modules[i];
+        module->module = &modules->opt->modules[i];
+
+        // get the module name from the qvm filename
+        if ((module->name = strrchr(module->module->qvm_filename, '/')))
+            module->name++;
+        else
+            module->name = module->module->qvm_filename;
+
+        // get the output filename without the qvm extension
+        name_size = (ext_name = strrchr(module->name, '.')) ? ext_name - module->name : (int)strlen(module->name);
+        snprintf(module->output_filename, sizeof(module->output_filename), "%s/%.*s%s", modules->opt->output_filename, name_size, module->name, ext);
+
+        // two modules can't write the same output
+        for (unsigned int j = 0; j < i; j++)
+            if (!strcmp(modules->modules[j].output_filename, module->output_filename)) {
+                printf("Error: Modules %s and %s have the same output %s.\n", modules->modules[j].module->qvm_filename, module->module->qvm_filename, module->output_filename);
+                return 0;
+            }
+    }
+
+    // success
+    return 1;
+}
+
+static int qvm_modules_job(void *context, unsigned int index)
+{
+    qvm_modules_t   *modules = context;
+    qvm_module_t    *module = &modules->modules[index];
+    opt_emit_t      emit;
+
+    // load the module
+    if (!(module->qvm = qvm_load(module->module->qvm_filename, module->module->map_filename, modules->opt)))
+        return 0;
+
+    // emit the module output
+    emit.type = modules->opt->output_json ? EMIT_JSON : modules->opt->output_asm ? EMIT_ASM : EMIT_C;
+    emit.filename = module->output_filename;
+    return qvm_emit(module->qvm, &emit, 1, 1);
+}
+
+static int qvm_modules_report(qvm_modules_t *modules)
+{
+    qvm_module_function_t   *functions;
+    file_t                  *file;
+    char                    filename[MODULES_FILENAME_SIZE];
+    unsigned int            functions_count = 0;
+    unsigned int            groups_count = 0;
+    unsigned int            common_count = 0;
+    unsigned int            saved = 0;
+    unsigned int            count;
+
+    // count the functions of all modules
+    for (unsigned int i = 0; i < modules->modules_count; i++)
+        functions_count += modules->modules[i].qvm->functions_count;
+
+    // allocate the fingerprints
+    if (!(functions = malloc(sizeof(*functions) * (functions_count + 1)))) {
+        printf("Error: Couldn't allocate modules fingerprints.\n");
+        return 0;
+    }
+
+    // fingerprint all the functions
+    functions_count = 0;
+    for (unsigned int i = 0; i < modules->modules_count; i++)
+        for (unsigned int j = 0; j < modules->modules[i].qvm->functions_count; j++) {
+            functions[functions_count].module = &modules->modules[i];
+            functions[functions_count].function = &modules->modules[i].qvm->functions[j];
+            functions[functions_count].fingerprint = func_fingerprint(&modules->modules[i].qvm->functions[j]);
+            functions_count++;
+        }
+
+    // sort the functions by fingerprint, then by module
+    qsort(functions, functions_count, sizeof(*functions), qvm_modules_report_compare);
+
+    // create the report file
+    snprintf(filename, sizeof(filename), "%s/" MODULES_REPORT_NAME, modules->opt->output_filename);
+    if (!(file = file_create(filename))) {
+        printf("Reporting common functions to %s...Error: Couldn't create file.\n", filename);
+        free(functions);
+        return 0;
+    }
+
+    // print the modules
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tModules:");
+    for (unsigned int i = 0; i < modules->modules_count; i++)
+        file_print(file, " %s", modules->modules[i].name);
+    file_print(file, "\n*/\n\n");
+
+    // print each group of functions with the same fingerprint
+    for (unsigned int i = 0; i < functions_count; i += count) {
+        for (count = 1; i + count < functions_count && functions[i + count].fingerprint == functions[i].fingerprint; count++);
+        if (qvm_modules_report_group(file, &functions[i], count, &saved)) {
+            groups_count++;
+            common_count += count;
+        }
+    }
+
+    // print the totals
+    file_print(file, "/*\n");
+    file_print(file, "\tCommon Functions: %u in %u groups\n", common_count, groups_count);
+    file_print(file, "\tOpcodes Shared: %u\n", saved);
+    file_print(file, "*/\n");
+
+    // free the created file and the fingerprints
+    file_free(file);
+    free(functions);
+
+    printf("Reporting common functions to %s...Success: %u functions in %u groups found.\n", filename, common_count, groups_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_modules_report_compare(const void *a, const void *b)
+{
+    const qvm_module_function_t *fa = a;
+    const qvm_module_function_t *fb = b;
+
+    // compare the fingerprints
+    if (fa->fingerprint != fb->fingerprint)
+        return fa->fingerprint < fb->fingerprint ? -1 : 1;
+
+    // compare the modules, then the addresses
+    if (fa->module != fb->module)
+        return fa->module < fb->module ? -1 : 1;
+    return fa->function->address < fb->function->address ? -1 : fa->function->address > fb->function->address;
+}
+
+static int qvm_modules_report_group(file_t *file, qvm_module_function_t *group, unsigned int count, unsigned int *saved)
+{
+    // a group is common if its functions are in several modules, the smallest functions look alike by chance
+    if (group[0].module == group[count - 1].module || group[0].function->op_size < MODULES_FUNCTION_MIN)
+        return 0;
+
+    // print the group fingerprint and its functions
+    file_print(file, "%016llx: %u opcodes\n", group[0].fingerprint, group[0].function->op_size);
+    for (unsigned int i = 0; i < count; i++)
+        file_print(file, "\t%s 0x%x %s\n", group[i].module->name, group[i].function->address, group[i].function->name);
+    file_print(file, "\n");
+
+    // the group only needs to be read once
+    *saved += group[0].function->op_size * (count - 1);
+
+    // the group is common
+    return 1;
+}
@@ -6,7 +6,7 @@ void                    opb_push(qvm_opblock_t *opb, qvm_opblock_t **list);
 qvm_opblock_t           *opb_pop(qvm_opblock_t **list);
 void                    opb_add(qvm_opblock_t *opb, qvm_opblock_t **list);
 void                    opb_print(file_t *file, qvm_opblock_t *opb);
-static qvm_opblock_t    *opb_load(qvm_opblock_t *opb, unsigned int size);
+static qvm_opblock_t    *opb_load(qvm_opblock_t *opb, unsigned int size, qvm_opblock_t *loaded);
 qvm_opblock_t           *opb_is_call(qvm_opblock_t *opb);
 int                     opb_foreach(qvm_t *qvm, int (*func)(qvm_opblock_t *));
 
@@ -118,6 +118,7 @@ void opb_free(qvm_opblock_t *opb)
 void opb_print(file_t *file, qvm_opblock_t *opb)
 {
     qvm_opblock_t   *tmp;
+    qvm_opblock_t   loaded;
     qvm_variable_t  *var;
     qvm_variable_t  *prev;
 
@@ -232,7 +233,7 @@ void opb_print(file_t *file, qvm_opblock_t *opb)
 
         // load the stack
         case OPB_LOAD:
-            if ((tmp = opb_load(opb->child, opb->opcode->value))) {
+            if ((tmp = opb_load(opb->child, opb->opcode->value, &loaded))) {
                 opb_print(file, tmp);
             }
             else {
@@ -248,7 +249,7 @@ void opb_print(file_t *file, qvm_opblock_t *opb)
 
         // assign the stack
         case OPB_ASSIGNATION:
-            if ((tmp = opb_load(opb->op2, opb->opcode->value))) {
+            if ((tmp = opb_load(opb->op2, opb->opcode->value, &loaded))) {
                 opb_print(file, tmp);
             }
             else {
@@ -327,22 +328,20 @@ void opb_print(file_t *file, qvm_opblock_t *opb)
     }
 }
 
-qvm_opblock_t *opb_load(qvm_opblock_t *opb, unsigned int size)
+qvm_opblock_t *opb_load(qvm_opblock_t *opb, unsigned int size, qvm_opblock_t *loaded)
 {
-    static qvm_opblock_t    loaded;
-
     if (opb->info->id == OPB_LOCAL_ADR) {
         if (opb->variable->size == size) {
-            memcpy(&loaded, opb, sizeof(*opb));
-            loaded.info = &qvm_opblocks_info[OPB_LOCAL];
-            return &loaded;
+            memcpy(loaded, opb, sizeof(*opb));
+            loaded->info = &qvm_opblocks_info[OPB_LOCAL];
+            return loaded;
         }
     }
     if (opb->info->id == OPB_GLOBAL_ADR) {
         if (opb->variable->size == size) {
-            memcpy(&loaded, opb, sizeof(*opb));
-            loaded.info = &qvm_opblocks_info[OPB_GLOBAL];
-            return &loaded;
+            memcpy(loaded, opb, sizeof(*opb));
+            loaded->info = &qvm_opblocks_info[OPB_GLOBAL];
+            return loaded;
         }
     }
     return NULL;
@@ -84,6 +84,7 @@ typedef struct qvm_opcode_s {
     qvm_opcode_info_t   *info;
     int                 value;
 	qvm_opblock_t		*opblock;
+    char                global;
 } qvm_opcode_t;
 
 qvm_opcode_info_t   qvm_opcodes_info[OP_MAX];
@@ -2,15 +2,40 @@
 
 static void opt_init(opt_t *opt);
 opt_t       *opt_parse(int argc, char **argv);
+static int  opt_parse_emit(opt_t *opt, char *emit);
+static int  opt_parse_select(opt_t *opt, char *select, char is_range);
 static void opt_print_usage(void);
 
+static char *opt_emit_names[EMIT_MAX] = {
+    "c",
+    "asm",
+    "json",
+    "dir",
+    "hot",
+    "lint",
+    "stack",
+    "footprint",
+    "signatures"
+};
+
 static void opt_init(opt_t *opt)
 {
     opt->qvm_filename = NULL;
     opt->map_filename = NULL;
     opt->output_filename = NULL;
+    opt->cache_dirname = NULL;
+    opt->signatures_filename = NULL;
+    opt->serve_path = NULL;
     opt->output_asm = 0;
-    opt->disassemble = 0;
+    opt->output_json = 0;
+    opt->stream = 0;
+    opt->fast_asm = 0;
+    opt->diff = 0;
+    opt->emits_count = 0;
+    opt->selects_count = 0;
+    opt->modules_count = 0;
+    opt->maps_count = 0;
+    opt->threads_count = 0;
 }
 
 opt_t *opt_parse(int argc, char **argv)
@@ -36,7 +61,11 @@ opt_t *opt_parse(int argc, char **argv)
                 printf("Error: %s take a next parameter.\n", argv[i]);
                 return NULL;
             }
-            opt.map_filename = argv[++i];
+            if (opt.maps_count >= OPT_MODULES_MAX) {
+                printf("Error: Too many map files.\n");
+                return NULL;
+            }
+            opt.maps[opt.maps_count++] = argv[++i];
             continue;
         }
 
@@ -50,20 +79,160 @@ opt_t *opt_parse(int argc, char **argv)
             continue;
         }
 
+        // check cache parameter
+        if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--cache")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            opt.cache_dirname = argv[++i];
+            continue;
+        }
+
+        // check signatures parameter
+        if (!strcmp(argv[i], "-g") || !strcmp(argv[i], "--signatures")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            opt.signatures_filename = argv[++i];
+            continue;
+        }
+
+        // check serve parameter
+        if (!strcmp(argv[i], "-l") || !strcmp(argv[i], "--serve")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            opt.serve_path = argv[++i];
+            continue;
+        }
+
+        // check emit parameter
+        if (!strcmp(argv[i], "-e") || !strcmp(argv[i], "--emit")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            if (!opt_parse_emit(&opt, argv[++i]))
+                return NULL;
+            continue;
+        }
+
+        // check function parameter
+        if (!strcmp(argv[i], "-f") || !strcmp(argv[i], "--function")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            if (!opt_parse_select(&opt, argv[++i], 0))
+                return NULL;
+            continue;
+        }
+
+        // check range parameter
+        if (!strcmp(argv[i], "-r") || !strcmp(argv[i], "--range")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            if (!opt_parse_select(&opt, argv[++i], 1))
+                return NULL;
+            continue;
+        }
+
+        // check threads parameter
+        if (!strcmp(argv[i], "-t") || !strcmp(argv[i], "--threads")) {
+            if (i + 1 >= argc) {
+                printf("Error: %s take a next parameter.\n", argv[i]);
+                return NULL;
+            }
+            opt.threads_count = atoi(argv[++i]);
+            continue;
+        }
+
         // check asm parameter
         if (!strcmp(argv[i], "-a") || !strcmp(argv[i], "--asm")) {
             opt.output_asm = 1;
             continue;
         }
 
+        // check json parameter
+        if (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--json")) {
+            opt.output_json = 1;
+            continue;
+        }
+
+        // check fast asm parameter
+        if (!strcmp(argv[i], "-A") || !strcmp(argv[i], "--fast-asm")) {
+            opt.output_asm = 1;
+            opt.fast_asm = 1;
+            continue;
+        }
+
+        // check stream parameter
+        if (!strcmp(argv[i], "-s") || !strcmp(argv[i], "--stream")) {
+            opt.stream = 1;
+            continue;
+        }
+
+        // check diff parameter
+        if (!strcmp(argv[i], "-D") || !strcmp(argv[i], "--diff")) {
+            opt.diff = 1;
+            continue;
+        }
+
         // check for unknown option
-        if (opt.qvm_filename) {
+        if (argv[i][0] == '-' && argv[i][1]) {
             printf("Error: Unknown option %s.\n", argv[i]);
             return NULL;
         }
 
+        // check the modules count
+        if (opt.modules_count >= OPT_MODULES_MAX) {
+            printf("Error: Too many qvm files.\n");
+            return NULL;
+        }
+
         // save the qvm filename
-        opt.qvm_filename = argv[i];
+        opt.modules[opt.modules_count++].qvm_filename = argv[i];
+    }
+
+    // give the maps to the qvms in the same order
+    if (opt.maps_count > 1 && opt.maps_count > opt.modules_count) {
+        printf("Error: Too many map files for %u qvm files.\n", opt.modules_count);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < opt.modules_count; i++)
+        opt.modules[i].map_filename = i < opt.maps_count ? opt.maps[i] : NULL;
+
+    // the first qvm and map are the single ones
+    opt.qvm_filename = opt.modules_count ? opt.modules[0].qvm_filename : NULL;
+    opt.map_filename = opt.maps_count ? opt.maps[0] : NULL;
+
+    // the server loads its qvms on request
+    if (opt.serve_path) {
+        if (opt.fast_asm) {
+            printf("Error: --fast-asm can't be used with --serve.\n");
+            return NULL;
+        }
+        return &opt;
+    }
+
+    // the diff compares an old and a new qvm in a single report
+    if (opt.diff) {
+        if (opt.modules_count != 2) {
+            printf("Error: --diff takes an old and a new qvm file.\n");
+            return NULL;
+        }
+        if (opt.emits_count || opt.output_json || opt.fast_asm || opt.stream) {
+            printf("Error: --diff can't be used with --emit, --json, --fast-asm or --stream.\n");
+            return NULL;
+        }
+        if (!opt.output_filename)
+            opt.output_filename = "a.diff";
+        return &opt;
     }
 
     // check if there was a qvm to load
@@ -73,9 +242,32 @@ opt_t *opt_parse(int argc, char **argv)
         return NULL;
     }
 
+    // the fast assembly is the only output of the opcodes alone
+    if (opt.fast_asm && (opt.emits_count || opt.output_json || opt.stream)) {
+        printf("Error: --fast-asm can't be used with --emit, --json or --stream.\n");
+        return NULL;
+    }
+
+    // several qvms are written in the output directory
+    if (opt.modules_count > 1) {
+        if (opt.emits_count) {
+            printf("Error: --emit can't be used with several qvm files.\n");
+            return NULL;
+        }
+        if (!opt.output_filename)
+            opt.output_filename = ".";
+        return &opt;
+    }
+
+    // the emit parameters replace the single output
+    if (opt.emits_count)
+        return &opt;
+
     // put the default output name if needed
     if (!opt.output_filename) {
-        if (opt.output_asm)
+        if (opt.output_json)
+            opt.output_filename = "a.json";
+        else if (opt.output_asm)
             opt.output_filename = "a.asm";
         else
             opt.output_filename = "a.c";
@@ -85,20 +277,117 @@ opt_t *opt_parse(int argc, char **argv)
         ext = file_ext(opt.output_filename);
     }
 
-    // set the disassemble option if needed
-    if (opt.output_asm || (ext && (strstr(ext, "asm") || !strcmp(ext, ".s"))))
-        opt.disassemble = 1;
+    // set the single output
+    opt.emits[0].filename = opt.output_filename;
+    opt.emits[0].type = EMIT_C;
+    opt.emits_count = 1;
+
+    // set the json output if needed
+    if (opt.output_json || (ext && strstr(ext, "json")))
+        opt.emits[0].type = EMIT_JSON;
+
+    // set the assembly output if needed
+    else if (opt.output_asm || (ext && (strstr(ext, "asm") || !strcmp(ext, ".s"))))
+        opt.emits[0].type = EMIT_ASM;
 
     // return the options
     return &opt;
 }
 
+static int opt_parse_emit(opt_t *opt, char *emit)
+{
+    char    *filename;
+
+    // check the emit format
+    if (!(filename = strchr(emit, '=')) || !filename[1]) {
+        printf("Error: Invalid emit %s, expected <c|asm|json|dir|hot|lint|stack|footprint|signatures>=<filename>.\n", emit);
+        return 0;
+    }
+
+    // check the emits count
+    if (opt->emits_count >= OPT_EMITS_MAX) {
+        printf("Error: Too many emits.\n");
+        return 0;
+    }
+
+    // find the emit type
+    for (int i = 0; i < EMIT_MAX; i++) {
+        if (strlen(opt_emit_names[i]) == (size_t)(filename - emit) && !strncmp(emit, opt_emit_names[i], filename - emit)) {
+            opt->emits[opt->emits_count].type = i;
+            opt->emits[opt->emits_count].filename = filename + 1;
+            opt->emits_count++;
+            return 1;
+        }
+    }
+
+    // unknown emit type
+    printf("Error: Unknown emit type in %s.\n", emit);
+    return 0;
+}
+
+static int opt_parse_select(opt_t *opt, char *select, char is_range)
+{
+    opt_select_t    *sel;
+    char            *end;
+
+    // check the selects count
+    if (opt->selects_count >= OPT_SELECTS_MAX) {
+        printf("Error: Too many functions selected.\n");
+        return 0;
+    }
+
+    // get the new select
+    sel = &opt->selects[opt->selects_count];
+    sel->name = NULL;
+
+    // parse the start address
+    sel->start = strtoul(select, &end, 0);
+    sel->end = sel->start;
+
+    // parse the end address of a range
+    if (is_range) {
+        if (end == select || *end != '-') {
+            printf("Error: Invalid range %s, expected <start>-<end>.\n", select);
+            return 0;
+        }
+        sel->end = strtoul(end + 1, &end, 0);
+        if (*end || sel->end < sel->start) {
+            printf("Error: Invalid range %s, expected <start>-<end>.\n", select);
+            return 0;
+        }
+    }
+
+    // select the function by name if this is not an address
+    else if (end == select || *end)
+        sel->name = select;
+
+    // add the select
+    opt->selects_count++;
+
+    // success
+    return 1;
+}
+
 static void opt_print_usage(void)
 {
-    printf("Usage: qvmd [OPTIONS] <qvm filename>\n\n");
+    printf("Usage: qvmd [OPTIONS] <qvm filename>\n");
+    printf("       qvmd [OPTIONS] <qvm filename> <qvm filename> [...]\n");
+    printf("       qvmd --serve <socket|-> [OPTIONS] [qvm filename]\n");
+    printf("       qvmd --diff [OPTIONS] <old qvm filename> <new qvm filename>\n\n");
     printf("OPTIONS:\n");
-    printf(" -o : --output  -- Select an output file.\n");
-    printf(" -m : --map     -- Select a map file.\n");
-    printf(" -a : --asm     -- Generate assembly instead of code.\n");
-    printf(" -d : --debug   -- Enable debugging.\n");
+    printf(" -o : --output     -- Select an output file, or a directory with several qvm files.\n");
+    printf(" -m : --map        -- Select a map file, can be repeated for several qvm files in the same order.\n");
+    printf(" -a : --asm        -- Generate assembly instead of code.\n");
+    printf(" -A : --fast-asm   -- Generate assembly from the opcodes only, without the analysis.\n");
+    printf(" -j : --json       -- Generate one JSON object per line instead of code.\n");
+    printf(" -e : --emit       -- Add an output <c|asm|json|dir|hot|lint|stack|footprint|signatures>=<filename>, can be repeated.\n");
+    printf(" -f : --function   -- Output only the function <name|address>, can be repeated.\n");
+    printf(" -r : --range      -- Output only the functions in <start>-<end>, can be repeated.\n");
+    printf(" -t : --threads    -- Select the number of threads, one per cpu by default.\n");
+    printf(" -c : --cache      -- Select a directory to cache the analysis.\n");
+    printf(" -s : --stream     -- Analyze and output one function at a time to bound the memory.\n");
+    printf(" -g : --signatures -- Name the functions without a map entry from a signatures database.\n");
+    printf(" -l : --serve      -- Keep the analyses loaded and answer requests on a unix socket or - for stdio.\n");
+    printf(" -D : --diff       -- Report the functions and globals changed between an old and a new qvm.\n");
+    printf(" -d : --debug      -- Enable debugging.\n");
 }
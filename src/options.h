@@ -1,12 +1,60 @@
 #ifndef OPTIONS_H
 #define OPTIONS_H
 
+#define OPT_EMITS_MAX   16
+#define OPT_SELECTS_MAX 64
+#define OPT_MODULES_MAX 8
+
+typedef enum {
+    EMIT_C,
+    EMIT_ASM,
+    EMIT_JSON,
+    EMIT_DIR,
+    EMIT_HOT,
+    EMIT_LINT,
+    EMIT_STACK,
+    EMIT_FOOTPRINT,
+    EMIT_SIGNATURES,
+    EMIT_MAX
+} opt_emit_e;
+
+typedef struct {
+    opt_emit_e      type;
+    char            *filename;
+} opt_emit_t;
+
+typedef struct {
+    char            *name;
+    unsigned int    start;
+    unsigned int    end;
+} opt_select_t;
+
+typedef struct {
+    char            *qvm_filename;
+    char            *map_filename;
+} opt_module_t;
+
 typedef struct {
-    char    *qvm_filename;
-    char    *map_filename;
-    char    *output_filename;
-    char    output_asm;
-    char    disassemble;
+    char            *qvm_filename;
+    char            *map_filename;
+    char            *output_filename;
+    char            *cache_dirname;
+    char            *signatures_filename;
+    char            *serve_path;
+    char            output_asm;
+    char            output_json;
+    char            stream;
+    char            fast_asm;
+    char            diff;
+    opt_emit_t      emits[OPT_EMITS_MAX];
+    unsigned int    emits_count;
+    opt_select_t    selects[OPT_SELECTS_MAX];
+    unsigned int    selects_count;
+    opt_module_t    modules[OPT_MODULES_MAX];
+    unsigned int    modules_count;
+    char            *maps[OPT_MODULES_MAX];
+    unsigned int    maps_count;
+    unsigned int    threads_count;
 } opt_t;
 
 opt_t   *opt_parse(int argc, char **argv);
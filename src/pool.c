@@ -0,0 +1,99 @@
+#include "qvmd.h"
+
+unsigned int    pool_threads_count(unsigned int threads_count);
+int             pool_run(unsigned int count, unsigned int threads_count, void *context, int (*func)(void *context, unsigned int index));
+static void     *pool_worker(void *arg);
+
+unsigned int pool_threads_count(unsigned int threads_count)
+{
+    long    cpus;
+
+    // use the threads count asked if any
+    if (threads_count)
+        return threads_count;
+
+    // use one thread per online cpu
+    if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+        return 1;
+    return cpus;
+}
+
+int pool_run(unsigned int count, unsigned int threads_count, void *context, int (*func)(void *context, unsigned int index))
+{
+    pool_t          pool;
+    pthread_t       *threads;
+    unsigned int    started = 0;
+
+    // get the threads count needed
+    threads_count = pool_threads_count(threads_count);
+    if (threads_count > count)
+        threads_count = count;
+
+    // run the jobs in the current thread if there is no need for more
+    if (threads_count <= 1) {
+        for (unsigned int i = 0; i < count; i++)
+            if (!func(context, i))
+                return 0;
+        return 1;
+    }
+
+    // initialize the pool
+    pool.count = count;
+    pool.next = 0;
+    pool.context = context;
+    pool.func = func;
+    pool.success = 1;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    // allocate the threads
+    if (!(threads = malloc(sizeof(*threads) * threads_count))) {
+        printf("Error: Couldn't allocate threads.\n");
+        pthread_mutex_destroy(&pool.lock);
+        return 0;
+    }
+
+    // start the workers
+    for (; started < threads_count; started++)
+        if (pthread_create(&threads[started], NULL, pool_worker, &pool))
+            break;
+
+    // work in the current thread if no worker could start
+    if (!started)
+        pool_worker(&pool);
+
+    // wait for all workers
+    for (unsigned int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    // free the pool
+    free(threads);
+    pthread_mutex_destroy(&pool.lock);
+
+    // return the jobs status
+    return pool.success;
+}
+
+static void *pool_worker(void *arg)
+{
+    pool_t          *pool = arg;
+    unsigned int    index;
+
+    // run the jobs until there is no more
+    while (1) {
+        // get the next job index
+        pthread_mutex_lock(&pool->lock);
+        index = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (index >= pool->count)
+            break;
+
+        // run the job
+        if (!pool->func(pool->context, index)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->success = 0;
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,20 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+typedef struct pool_s   pool_t;
+
+typedef struct pool_s {
+    pthread_mutex_t lock;
+    unsigned int    count;
+    unsigned int    next;
+    void            *context;
+    int             (*func)(void *context, unsigned int index);
+    char            success;
+} pool_t;
+
+unsigned int    pool_threads_count(unsigned int threads_count);
+int             pool_run(unsigned int count, unsigned int threads_count, void *context, int (*func)(void *context, unsigned int index));
+
+#endif
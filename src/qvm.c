@@ -1,113 +1,437 @@
 #include "qvmd.h"
 
+typedef struct {
+    unsigned int    returns_corrected;
+    unsigned int    jumppoints_removed;
+    int             calls_total;
+    int             calls_restored;
+    unsigned int    variadic_count;
+} qvm_analysis_t;
+
+typedef struct {
+    qvm_t               *qvm;
+    qvm_function_sccs_t *sccs;
+    unsigned int        level_start;
+    qvm_analysis_t      *analyses;
+} qvm_analysis_level_t;
+
 static qvm_t    *qvm_new(void);
 void            qvm_free(qvm_t *qvm);
-qvm_t           *qvm_load(char *filename, char *map_filename);
+static void     qvm_free_analysis(qvm_t *qvm);
+qvm_t           *qvm_load(char *filename, char *map_filename, opt_t *opt);
+int             qvm_load_function(qvm_t *qvm, qvm_function_t *func);
+void            qvm_unload_function(qvm_t *qvm, qvm_function_t *func);
+static int      qvm_load_stream(qvm_t *qvm);
+static int      qvm_load_function_analysis(qvm_t *qvm, qvm_function_t *func, qvm_analysis_t *analysis);
+static int      qvm_load_function_opblocks(qvm_t *qvm, qvm_function_t *func, unsigned int *opblocks_count);
 static int      qvm_load_file(qvm_t *qvm, char *filename);
 static int      qvm_load_map(qvm_t *qvm, char *map_filename);
-static void     qvm_load_map_entry(qvm_t *qvm, char *line);
+static int      qvm_load_map_entries(qvm_t *qvm, char *map_filename, qvm_map_table_t *map);
+static void     qvm_load_map_sections(qvm_t *qvm, qvm_map_table_t *map);
 static void     qvm_load_map_functions(qvm_t *qvm);
+static void     qvm_load_map_function(qvm_map_table_t *map, qvm_function_t *func);
+int             qvm_reload_map(qvm_t *qvm, char *map_filename, qvm_function_list_t **changed);
+static int      qvm_reload_map_entry(qvm_t *qvm, qvm_map_table_t *map, qvm_map_t *entry, qvm_function_list_t **changed);
+static int      qvm_reload_map_function(qvm_t *qvm, qvm_map_table_t *map, qvm_function_t *func, qvm_function_list_t **changed);
+static int      qvm_reload_map_globals(qvm_t *qvm, qvm_map_table_t *map, unsigned int address, qvm_function_list_t **changed);
+static int      qvm_reload_map_changed(qvm_t *qvm, qvm_function_list_t **changed, qvm_function_t *func);
 static int      qvm_load_opcodes(qvm_t *qvm);
+static int      qvm_load_opcodes_globals(qvm_t *qvm);
+static void     qvm_load_opcodes_global(qvm_t *qvm, unsigned int address, unsigned int min, unsigned int max);
 static int      qvm_load_functions(qvm_t *qvm);
 static void     qvm_load_functions_count(qvm_t *qvm);
 static void     qvm_load_functions_data(qvm_t *qvm);
+static int      qvm_load_selection(qvm_t *qvm, opt_select_t *selects, unsigned int selects_count);
 static int      qvm_load_jumppoints(qvm_t *qvm);
 static int      qvm_load_opblocks(qvm_t *qvm);
+static int      qvm_load_opblocks_range(qvm_t *qvm, unsigned int start, unsigned int end, qvm_opblock_t **opblocks, unsigned int *opblocks_count);
 static int      qvm_load_syscalls(qvm_t *qvm);
 static int      qvm_load_syscalls_usage(qvm_opblock_t *opb);
+static void     qvm_load_syscalls_table(qvm_t *qvm);
 static int      qvm_load_variables(qvm_t *qvm);
+static int      qvm_load_graph(qvm_t *qvm);
 static int      qvm_load_variables_usage(qvm_opblock_t *opb);
+static int      qvm_load_variables_constant(qvm_opblock_t *opb, qvm_opblock_t *operand);
+static int      qvm_load_variables_constants(qvm_t *qvm);
+static int      qvm_load_variables_globals(qvm_t *qvm);
+static int      qvm_load_variables_locals(qvm_t *qvm, qvm_function_t *func);
 static int      qvm_load_variables_sections(qvm_t *qvm);
 static void     qvm_load_variables_globals_size(qvm_t *qvm);
-static void     qvm_load_variables_locals_size(qvm_t *qvm);
 static int      qvm_load_variables_map(qvm_t *qvm, qvm_map_t *map);
-static int      qvm_load_variables_probs(qvm_t *qvm);
-static int      qvm_load_variables_literals(qvm_t *qvm);
-static void     qvm_load_variables_types(qvm_t *qvm);
-static int      qvm_load_returns(qvm_t *qvm);
-static int      qvm_load_calls(qvm_t *qvm);
-static int      qvm_load_calls_opb(qvm_opblock_t *opb);
-static int      qvm_load_variadic_functions(qvm_t *qvm);
+static int      qvm_load_variables_literals(qvm_t *qvm, unsigned int start, unsigned int end);
+static void     qvm_load_variables_ids(qvm_t *qvm);
+static int      qvm_load_functions_analysis(qvm_t *qvm, unsigned int threads_count);
+static int      qvm_load_functions_analysis_job(void *context, unsigned int index);
+static void     qvm_load_function_summary(qvm_function_t *func, qvm_opblock_t *last, qvm_analysis_t *analysis);
+static unsigned int qvm_load_returns_function(qvm_function_t *func, qvm_opblock_t *last, unsigned int *jumppoints_removed);
+static void     qvm_load_calls_opb(qvm_opblock_t *opb, qvm_analysis_t *analysis);
+static int      qvm_load_variadic_function(qvm_function_t *func);
+static void     qvm_load_args_function(qvm_function_t *func);
 
 static qvm_t *qvm_new(void)
 {
-    static qvm_t   qvm;
+    qvm_t   *qvm;
+
+    // allocate a new qvm
+    if (!(qvm = malloc(sizeof(*qvm)))) {
+        printf("Error: Couldn't allocate new qvm.\n");
+        return NULL;
+    }
 
     // initialize the qvm content
-    qvm.file = NULL;
-    qvm.header = NULL;
-    qvm.opcodes = NULL;
-    qvm.functions = NULL;
-    qvm.functions_count = 0;
-    qvm.syscalls = NULL;
-    qvm.syscalls_count = 0;
-    qvm.jumppoints = NULL;
-    qvm.opblocks = NULL;
-    qvm.globals = NULL;
-    qvm.globals_count = 0;
-    qvm.locals_count = 0;
-    qvm.map = NULL;
-    qvm.map_count = 0;
-    qvm.restored_calls_perc = 0.0f;
-    qvm.output_file = NULL;
+    qvm->file = NULL;
+    qvm->header = NULL;
+    qvm->opcodes = NULL;
+    qvm->functions = NULL;
+    qvm->functions_count = 0;
+    qvm->selected_count = 0;
+    qvm->syscalls = NULL;
+    qvm->syscalls_count = 0;
+    qvm->syscalls_table = NULL;
+    qvm->jumppoints = NULL;
+    qvm->jumppoints_count = 0;
+    qvm->jumppoints_index = NULL;
+    qvm->opblocks = NULL;
+    qvm->globals = NULL;
+    qvm->globals_count = 0;
+    qvm->locals_count = 0;
+    map_init(&qvm->map);
+    func_graph_init(&qvm->graph);
+    xref_init(&qvm->xrefs);
+    qvm->cache_dirname = NULL;
+    qvm->calls_total = 0;
+    qvm->calls_restored = 0;
+    qvm->restored_calls_perc = 0.0f;
+    qvm->cache = NULL;
+    qvm->stream = 0;
+    qvm->fast = 0;
 
     // init all qvm sections
     for (int i = S_CODE; i < S_MAX; i++) {
-        qvm.sections[i].content = NULL;
-        qvm.sections[i].length = 0;
+        qvm->sections[i].content = NULL;
+        qvm->sections[i].length = 0;
     }
 
     // return the qvm
-    return &qvm;
+    return qvm;
 }
 
 void qvm_free(qvm_t *qvm)
 {
-    // free the file if needed
-    if (qvm->file)
-        file_free(qvm->file);
+    // free the cached analysis or the analysis if needed
+    if (qvm->cache)
+        cache_free(qvm->cache);
+    else
+        qvm_free_analysis(qvm);
+
+    // free the map entries
+    map_free(&qvm->map);
+
+    // free the jumppoints index if needed
+    if (qvm->jumppoints_index)
+        free(qvm->jumppoints_index);
 
     // free the opcodes if needed
     if (qvm->opcodes)
         free(qvm->opcodes);
 
-    // free the opblocks if needed
-    if (qvm->opblocks)
-        opb_free(qvm->opblocks);
-
     // free the functions if needed
     if (qvm->functions)
         free(qvm->functions);
+
+    // free the file if needed
+    if (qvm->file)
+        file_free(qvm->file);
+
+    // free the qvm
+    free(qvm);
 }
 
-qvm_t *qvm_load(char *filename, char *map_filename)
+static void qvm_free_analysis(qvm_t *qvm)
 {
-    qvm_t   *qvm;
+    qvm_jumppoint_t *jmp;
+    qvm_function_t  *sysc;
+
+    // free all the opcodes opblocks
+    for (unsigned int i = 0; qvm->opcodes && i < qvm->header->instructions_count; i++)
+        free(qvm->opcodes[i].opblock);
+
+    // free the jumppoints and their opblocks
+    while ((jmp = qvm->jumppoints)) {
+        qvm->jumppoints = jmp->next;
+        free(jmp->opblock);
+        free(jmp);
+    }
+
+    // free the functions locals
+    for (unsigned int i = 0; qvm->functions && i < qvm->functions_count; i++)
+        var_free(qvm->functions[i].locals);
+
+    // free the syscalls
+    while ((sysc = qvm->syscalls)) {
+        qvm->syscalls = sysc->next;
+        free(sysc);
+    }
+
+    // free the globals
+    var_free(qvm->globals);
+
+    // free the calls, the variables parents and the cross references
+    func_graph_free(&qvm->graph);
+    xref_free(&qvm->xrefs);
+}
+
+qvm_t *qvm_load(char *filename, char *map_filename, opt_t *opt)
+{
+    qvm_t               *qvm;
+    unsigned long long  cache_key = 0;
 
     // create a new qvm
     if (!(qvm = qvm_new()))
         return NULL;
 
-    // load all qvm parts
-    if (!qvm_load_file(qvm, filename) ||
-        (map_filename && !qvm_load_map(qvm, map_filename)) ||
+    // set the cache directory
+    qvm->cache_dirname = opt->cache_dirname;
+
+    // load the qvm file
+    if (!qvm_load_file(qvm, filename)) {
+        qvm_free(qvm);
+        return NULL;
+    }
+
+    // load the analysis from the cache if possible, the stream and fast modes don't keep the analysis
+    if (opt->cache_dirname && !opt->stream && !opt->fast_asm) {
+        cache_key = cache_get_key(qvm, map_filename, opt->signatures_filename);
+        if (cache_load(qvm, opt->cache_dirname, cache_key)) {
+            if (!qvm_load_selection(qvm, opt->selects, opt->selects_count)) {
+                qvm_free(qvm);
+                return NULL;
+            }
+            return qvm;
+        }
+    }
+
+    // load the qvm parts needed by all functions
+    if ((map_filename && !qvm_load_map(qvm, map_filename)) ||
         !qvm_load_opcodes(qvm) ||
         !qvm_load_functions(qvm) ||
-        !qvm_load_jumppoints(qvm) ||
-        !qvm_load_opblocks(qvm) ||
+        !verify_functions(qvm) ||
+        (opt->signatures_filename && !sig_apply(qvm, opt->signatures_filename)) ||
+        !qvm_load_selection(qvm, opt->selects, opt->selects_count) ||
+        !qvm_load_jumppoints(qvm)) {
+        qvm_free(qvm);
+        return NULL;
+    }
+
+    // the fast assembly only needs the opcodes, the functions and the jumppoints
+    if (opt->fast_asm) {
+        qvm->fast = 1;
+        return qvm;
+    }
+
+    // load only the global analysis in stream mode
+    if (opt->stream) {
+        if (!qvm_load_stream(qvm)) {
+            qvm_free(qvm);
+            return NULL;
+        }
+        return qvm;
+    }
+
+    // load all other qvm parts, the functions not selected only get the global analysis
+    if (!qvm_load_opblocks(qvm) ||
         !qvm_load_syscalls(qvm) ||
         !qvm_load_variables(qvm) ||
-        !qvm_load_returns(qvm) ||
-        !qvm_load_calls(qvm) ||
-        !qvm_load_variadic_functions(qvm)) {
+        !qvm_load_graph(qvm) ||
+        !qvm_load_functions_analysis(qvm, opt->threads_count)) {
         qvm_free(qvm);
         return NULL;
     }
 
+    // save the analysis in the cache if needed, a partial analysis isn't saved
+    if (opt->cache_dirname && qvm->selected_count == qvm->functions_count)
+        cache_save(qvm, opt->cache_dirname, cache_key);
+
     // return the qvm
     return qvm;
 }
 
+int qvm_load_function(qvm_t *qvm, qvm_function_t *func)
+{
+    qvm_analysis_t  analysis;
+    unsigned int    locals_count;
+    int             success;
+
+    // the function is already analyzed if the qvm isn't streamed
+    if (!qvm->stream)
+        return 1;
+
+    // save the locals total computed by the global analysis
+    locals_count = qvm->locals_count;
+
+    // analyze the function again
+    memset(&analysis, 0, sizeof(analysis));
+    if (!(success = qvm_load_function_analysis(qvm, func, &analysis)))
+        qvm_unload_function(qvm, func);
+
+    // restore the locals total
+    qvm->locals_count = locals_count;
+
+    // return the status
+    return success;
+}
+
+void qvm_unload_function(qvm_t *qvm, qvm_function_t *func)
+{
+    qvm_opcode_t    *op;
+    qvm_jumppoint_t *jmp;
+
+    // the analysis is kept if the qvm isn't streamed
+    if (!qvm->stream)
+        return;
+
+    // browse all function opcodes
+    for (unsigned int i = func->address; i < func->address + func->op_size; i++) {
+        op = &qvm->opcodes[i];
+
+        // free the jumppoint opblock if any
+        if ((jmp = jumppoint_find(qvm, i)) && jmp->opblock) {
+            free(jmp->opblock);
+            jmp->opblock = NULL;
+        }
+
+        // check if there is an opblock
+        if (!op->opblock)
+            continue;
+
+        // give back the jumppoint parent removed by the returns analysis
+        if (op->opblock->return_goto && op->opblock->return_goto->jumppoint)
+            op->opblock->return_goto->jumppoint->parents_count++;
+
+        // free the opblock
+        free(op->opblock);
+        op->opblock = NULL;
+    }
+
+    // free the function locals
+    var_free(func->locals);
+
+    // reset the function analysis
+    func->locals = NULL;
+    func->locals_count = 0;
+    func->opblock_start = NULL;
+    func->opblock_end = NULL;
+    func->analyzed = 0;
+}
+
+static int qvm_load_stream(qvm_t *qvm)
+{
+    qvm_function_t  *func;
+    qvm_analysis_t  analysis;
+    unsigned int    opblocks_count = 0;
+
+    printf("Loading globals...");
+
+    // set the qvm as streamed
+    qvm->stream = 1;
+
+    // browse all functions for the global analysis only
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        func = &qvm->functions[i];
+        func->analyzed = 0;
+
+        // load the function opblocks with its calls, syscalls and globals usage
+        if (!qvm_load_function_opblocks(qvm, func, &opblocks_count))
+            return 0;
+
+        // free the function opblocks
+        qvm_unload_function(qvm, func);
+    }
+
+    // name syscalls from the syscalls table, then from map entries
+    qvm_load_syscalls_table(qvm);
+    qvm_load_map_functions(qvm);
+
+    // find all globals
+    if (!qvm_load_variables_globals(qvm))
+        return 0;
+
+    printf("Success: %i opblocks, %i syscalls and %i globals found.\n", opblocks_count, qvm->syscalls_count, qvm->globals_count);
+
+    // freeze the calls and the globals parents, the functions analysis finds them again
+    if (!qvm_load_graph(qvm))
+        return 0;
+
+    printf("Loading functions analysis...");
+
+    // analyze each selected function once to get the totals, one at a time to bound the memory
+    memset(&analysis, 0, sizeof(analysis));
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        func = &qvm->functions[i];
+        if (!func->selected)
+            continue;
+
+        // analyze the function
+        if (!qvm_load_function_analysis(qvm, func, &analysis))
+            return 0;
+
+        // free the function analysis
+        qvm_unload_function(qvm, func);
+    }
+
+    // save the % of restored calls
+    qvm->calls_total = analysis.calls_total;
+    qvm->calls_restored = analysis.calls_restored;
+    if (qvm->calls_total)
+        qvm->restored_calls_perc = (float)(qvm->calls_restored * 100) / (float)qvm->calls_total;
+
+    printf("Success: %i locals, %.2f%% of calls restored and %i variadic functions found.\n", qvm->locals_count, qvm->restored_calls_perc, analysis.variadic_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_function_analysis(qvm_t *qvm, qvm_function_t *func, qvm_analysis_t *analysis)
+{
+    qvm_opblock_t   *last = NULL;
+    unsigned int    opblocks_count = 0;
+
+    // set the function as analyzed
+    func->analyzed = 1;
+
+    // load the function opblocks and all its variables
+    if (!qvm_load_function_opblocks(qvm, func, &opblocks_count) || !qvm_load_variables_locals(qvm, func))
+        return 0;
+
+    // get the last opblock, the last function has no end like in the whole program analysis
+    if (func->id + 1 < qvm->functions_count)
+        for (last = func->opblock_start; last && last->next; last = last->next);
+
+    // correct the returns, restore the calls and find the function summary
+    qvm_load_function_summary(func, last, analysis);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_function_opblocks(qvm_t *qvm, qvm_function_t *func, unsigned int *opblocks_count)
+{
+    qvm_opblock_t   *opblocks = NULL;
+    qvm_opblock_t   *opb;
+
+    // load the function opblocks
+    if (!qvm_load_opblocks_range(qvm, func->address, func->address + func->op_size, &opblocks, opblocks_count))
+        return 0;
+
+    // load the syscalls and the variables used by the function
+    for (opb = opblocks; opb; opb = opb->next)
+        if (!qvm_load_syscalls_usage(opb) || !qvm_load_variables_usage(opb))
+            return 0;
+
+    // success
+    return 1;
+}
+
 static int qvm_load_file(qvm_t *qvm, char *filename)
 {
     printf("Loading qvm file...");
@@ -158,173 +482,426 @@ static int qvm_load_file(qvm_t *qvm, char *filename)
 
 int qvm_load_map(qvm_t *qvm, char *map_filename)
 {
-    file_t          *file;
-
     printf("Loading map...");
 
-    // read the map file
-    if (!(file = file_read(map_filename))) {
+    // load all map entries
+    if (!qvm_load_map_entries(qvm, map_filename, &qvm->map)) {
         printf("Warning: Couldn't read map file %s.\n", map_filename);
         return 1;
     }
 
-    // load all map entries
-    file_foreach_line(file, (void *)qvm, (void (*)(void *, char *))qvm_load_map_entry);
+    printf("Success: %i map entries found.\n", qvm->map.count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_map_entries(qvm_t *qvm, char *map_filename, qvm_map_table_t *map)
+{
+    file_t              *file;
+    unsigned long long  key = 0;
+
+    // initialize the map entries
+    map_init(map);
+
+    // map the map file, an empty file is read instead
+    if (!(file = file_map(map_filename)) && !(file = file_read(map_filename)))
+        return 0;
+
+    // load the parsed entries from the cache or parse them
+    if (qvm->cache_dirname)
+        key = hash_data(hash_str(HASH_INIT, "map"), file->content, file->size);
+    if (!qvm->cache_dirname || !map_cache_load(map, qvm->cache_dirname, key)) {
+        if (!map_parse(map, file->content, file->size)) {
+            map_free(map);
+            file_free(file);
+            return 0;
+        }
+
+        // save the parsed entries in the cache if needed
+        if (qvm->cache_dirname)
+            map_cache_save(map, qvm->cache_dirname, key);
+    }
 
     // free the file
     file_free(file);
 
-    printf("Success: %i map entries found.\n", qvm->map_count);
+    // place the entries in the qvm sections
+    qvm_load_map_sections(qvm, map);
+
+    // index the entries by address and name
+    if (!map_index(map)) {
+        map_free(map);
+        return 0;
+    }
 
     // success
     return 1;
 }
 
-static void qvm_load_map_entry(qvm_t *qvm, char *line)
+static void qvm_load_map_sections(qvm_t *qvm, qvm_map_table_t *map)
 {
-    int                 section_id;
-    unsigned int        address;
-    static qvm_map_t    *map = NULL;
-    qvm_map_t           *entry;
-    static unsigned int line_count = 0;
-
-    // increase the line count
-    line_count++;
-
-    // parse the section id
-    section_id = atoi(line);
-
-    // parse the address
-    while (isalnum(*line))
-        line++;
-    while (isspace(*line))
-        line++;
-    address = strtol(line, NULL, 16);
-
-    // parse the name
-    while (isalnum(*line))
-        line++;
-    while (isspace(*line))
-        line++;
-
-    // check if the name is too big
-    if (strlen(line) >= sizeof(map->name)) {
-        printf("Warning: Line %i of map file was ignored: Too long name.\n", line_count);
-        return;
+    qvm_map_t       *entry;
+    unsigned int    count = 0;
+
+    // browse all map entries
+    for (unsigned int i = 0; i < map->count; i++) {
+        entry = &map->entries[i];
+
+        // correct the address for literal and bss section
+        if (entry->section_id == S_LIT)
+            entry->address += qvm->sections[S_DATA].length;
+        else if (entry->section_id == S_BSS)
+            entry->address += qvm->sections[S_DATA].length + qvm->sections[S_LIT].length;
+
+        // check section address overflow
+        if (entry->section_id == S_LIT && entry->address > qvm->sections[S_DATA].length + qvm->sections[S_LIT].length) {
+            printf("Warning: Line %i of map file was ignored: Invalid literal address.\n", entry->line);
+            continue;
+        }
+        else if (entry->section_id == S_BSS && entry->address > qvm->sections[S_DATA].length + qvm->sections[S_LIT].length + qvm->sections[S_BSS].length) {
+            printf("Warning: Line %i of map file was ignored: Invalid bss address.\n", entry->line);
+            continue;
+        }
+
+        // keep the map entry
+        map->entries[count++] = *entry;
     }
+    map->count = count;
+}
 
-    // check if name is only alphanum char
-    if (!str_is_print(line, strlen(line) + 1)) {
-        printf("Warning: Line %i of map file was ignored: Invalid name.\n", line_count);
-        return;
+static void qvm_load_map_functions(qvm_t *qvm)
+{
+    qvm_function_t  *sysc;
+
+    // rename the functions
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        qvm_load_map_function(&qvm->map, &qvm->functions[i]);
+
+    // rename the syscalls
+    for (sysc = qvm->syscalls; sysc; sysc = sysc->next)
+        qvm_load_map_function(&qvm->map, sysc);
+}
+
+static void qvm_load_map_function(qvm_map_table_t *map, qvm_function_t *func)
+{
+    qvm_map_t   *entry;
+
+    // rename the function or syscall from all its map entries
+    for (unsigned int i = map_find_address(map, 1, func->address); i < map->count; i++) {
+        entry = map->sorted[i];
+        if (entry->section_id != S_CODE || entry->address != func->address)
+            break;
+        func_rename(func, entry->name);
     }
+}
 
-    // check if the section id is valid
-    if (section_id < 0 || section_id >= S_MAX) {
-        printf("Warning: Line %i of map file was ignored: Invalid section id.\n", line_count);
-        return;
+int qvm_reload_map(qvm_t *qvm, char *map_filename, qvm_function_list_t **changed)
+{
+    qvm_map_table_t map;
+    qvm_map_t       *entry;
+
+    printf("Reloading map...");
+
+    // the cached analysis can't be changed
+    if (qvm->cache) {
+        printf("Error: Couldn't reload the map of a cached analysis.\n");
+        return 0;
     }
 
-    // correct the address for literal and bss section
-    if (section_id == S_LIT)
-        address += qvm->sections[S_DATA].length;
-    else if (section_id == S_BSS)
-        address += qvm->sections[S_DATA].length + qvm->sections[S_LIT].length;
+    // load the new map entries if any
+    map_init(&map);
+    if (map_filename && !qvm_load_map_entries(qvm, map_filename, &map)) {
+        printf("Error: Couldn't read map file %s.\n", map_filename);
+        return 0;
+    }
 
-    // check section address overflow
-    if (section_id == S_LIT && address > qvm->sections[S_DATA].length + qvm->sections[S_LIT].length) {
-        printf("Warning: Line %i of map file was ignored: Invalid literal address.\n", line_count);
-        return;
+    // apply the entries removed from the old map
+    for (unsigned int i = 0; i < qvm->map.count; i++) {
+        entry = &qvm->map.entries[i];
+        if (!map_find(&map, entry) && !qvm_reload_map_entry(qvm, &map, entry, changed)) {
+            map_free(&map);
+            return 0;
+        }
     }
-    else if (section_id == S_BSS && address > qvm->sections[S_DATA].length + qvm->sections[S_LIT].length + qvm->sections[S_BSS].length) {
-        printf("Warning: Line %i of map file was ignored: Invalid bss address.\n", line_count);
-        return;
+
+    // apply the entries added to the new map
+    for (unsigned int i = 0; i < map.count; i++) {
+        entry = &map.entries[i];
+        if (!map_find(&qvm->map, entry) && !qvm_reload_map_entry(qvm, &map, entry, changed)) {
+            map_free(&map);
+            return 0;
+        }
     }
 
-    // create a new map entry
-    if (!(entry = map_new()))
-        return;
+    // replace the map entries
+    map_free(&qvm->map);
+    qvm->map = map;
 
-    // set the map entry values
-    entry->section_id = section_id;
-    entry->address = address;
-    sprintf(entry->name, "%s", line);
+    // number the variables again after the cuts
+    qvm_load_variables_ids(qvm);
 
-    // add new map entry
-    if (!map)
-        qvm->map = entry;
-    else
-        map->next = entry;
-    map = entry;
-    qvm->map_count++;
+    printf("Success: %i map entries found.\n", qvm->map.count);
+
+    // success
+    return 1;
 }
 
-static void qvm_load_map_functions(qvm_t *qvm)
+static int qvm_reload_map_entry(qvm_t *qvm, qvm_map_table_t *map, qvm_map_t *entry, qvm_function_list_t **changed)
 {
-    qvm_map_t       *map;
     qvm_function_t  *func;
 
-    // browse each map
-    for (map = qvm->map; map; map = map->next) {
-        // check if this is a function entry
-        if (map->section_id != S_CODE)
-            continue;
+    // check the section of the map entry
+    switch (entry->section_id) {
+        // if the section is not part of code or data
+        default:
+            return 1;
 
-        // check if the function address is valid
-        if (!(func = func_find(qvm, map->address)))
-            continue;
+        // rename the function or syscall again
+        case S_CODE:
+            if (!(func = func_find(qvm, entry->address)))
+                return 1;
+            return qvm_reload_map_function(qvm, map, func, changed);
 
-        // rename the function or syscall
-        func_rename(func, map->name);
+        // cut and rename the globals range again
+        case S_DATA:
+        case S_LIT:
+        case S_BSS:
+            return qvm_reload_map_globals(qvm, map, entry->address, changed);
     }
 }
 
+static int qvm_reload_map_function(qvm_t *qvm, qvm_map_table_t *map, qvm_function_t *func, qvm_function_list_t **changed)
+{
+    // rename the function from the new map entries only
+    func_rename_default(func);
+    qvm_load_map_function(map, func);
+
+    // the function, its callers and its callees print its name
+    if (!qvm_reload_map_changed(qvm, changed, func))
+        return 0;
+    for (unsigned int i = 0; i < func->calls.count; i++)
+        if (!qvm_reload_map_changed(qvm, changed, func->calls.functions[i]))
+            return 0;
+    for (unsigned int i = 0; i < func->called_by.count; i++)
+        if (!qvm_reload_map_changed(qvm, changed, func->called_by.functions[i]))
+            return 0;
+
+    // success
+    return 1;
+}
+
+static int qvm_reload_map_globals(qvm_t *qvm, qvm_map_table_t *map, unsigned int address, qvm_function_list_t **changed)
+{
+    qvm_variable_t  *base = NULL;
+    qvm_variable_t  *var;
+    unsigned int    end;
+
+    // find the variable found by the analysis containing the address
+    for (var = qvm->globals; var && var->address <= address; var = var->next)
+        if (!var->cut)
+            base = var;
+    if (!base)
+        return 1;
+
+    // free the variables cut in its range
+    while ((var = base->next) && var->cut) {
+        base->next = var->next;
+        free(var);
+        qvm->globals_count--;
+    }
+
+    // restore the variable size, name and status
+    end = var ? var->address : qvm->sections[S_DATA].length + qvm->sections[S_LIT].length + qvm->sections[S_BSS].length;
+    base->size = end - base->address;
+    var_rename_default(qvm, NULL, base);
+
+    // recut the variable if it is represented with 4 bytes
+    if (base->size > 4 && base->prob_size[4])
+        if (!var_cut(qvm, NULL, base->address + 4))
+            return 0;
+
+    // cut and rename the variables from the new map entries in the range
+    for (unsigned int i = map_find_address(map, 0, base->address); i < map->count && map->sorted[i]->address < end; i++)
+        if (!qvm_load_variables_map(qvm, map->sorted[i]))
+            return 0;
+
+    // cut the alphanumeric literals in the range
+    if (!qvm_load_variables_literals(qvm, base->address, end))
+        return 0;
+
+    // find the range variables default type
+    for (var = base; var && var->address < end; var = var->next)
+        var->type = type_from_var(var);
+
+    // the functions using the range print its variables
+    for (unsigned int i = 0; i < base->parents.count; i++)
+        if (!qvm_reload_map_changed(qvm, changed, base->parents.functions[i]))
+            return 0;
+
+    // success
+    return 1;
+}
+
+static int qvm_reload_map_changed(qvm_t *qvm, qvm_function_list_t **changed, qvm_function_t *func)
+{
+    // the syscalls are not printed
+    if (func->id >= qvm->functions_count)
+        return 1;
+
+    // add the function to the changed list
+    if (!func_list_add(changed, func))
+        return 0;
+
+    // success
+    return 1;
+}
+
 static int qvm_load_opcodes(qvm_t *qvm)
 {
-    unsigned int    curr_instr;
-    char            *raw_opcodes = qvm->sections[S_CODE].content;
-    char            *end_opcodes = qvm->sections[S_CODE].content + qvm->sections[S_CODE].length;
+    unsigned char   *code = (unsigned char *)qvm->sections[S_CODE].content;
+    unsigned int    length = qvm->sections[S_CODE].length;
+    unsigned int    count = qvm->header->instructions_count;
+    unsigned char   sizes[256];
+    unsigned int    masks[5] = { 0, 0xff, 0xffff, 0xffffff, 0xffffffff };
+    unsigned int    *starts;
+    unsigned int    offset = 0;
+    unsigned int    size;
+    unsigned int    i;
 
     printf("Loading opcodes...");
 
-    // allocate the opcodes
-    if (!(qvm->opcodes = malloc(sizeof(*qvm->opcodes) * qvm->header->instructions_count))) {
+    // each instruction takes at least one byte
+    if (count > length) {
+        printf("Error: Invalid instructions count %u for %u bytes of code.\n", count, length);
+        return 0;
+    }
+
+    // get the size of each instruction from its opcode byte, an invalid opcode has no size
+    memset(sizes, 0, sizeof(sizes));
+    for (int op = OP_UNDEF; op < OP_MAX; op++)
+        sizes[op] = 1 + qvm_opcodes_info[op].param_size;
+
+    // allocate the opcodes and the instructions offsets
+    qvm->opcodes = calloc(count + 1, sizeof(*qvm->opcodes));
+    starts = malloc(sizeof(*starts) * (count + 1));
+    if (!qvm->opcodes || !starts) {
         printf("Error: Couldn't allocates opcodes.\n");
+        free(starts);
         return 0;
     }
 
-    // browse all opcodes
-    for (curr_instr = 0; curr_instr < qvm->header->instructions_count && raw_opcodes < end_opcodes; curr_instr++) {
-        qvm_opcode_e    ope = *raw_opcodes++;
+    // find the offset of all instructions, stop at an invalid opcode or at the end of the code
+    for (i = 0; i < count && offset < length && (size = sizes[code[offset]]); i++) {
+        starts[i] = offset;
+        offset += size;
+    }
 
-        // check for invalid opcode
-        if (ope < OP_UNDEF || ope >= OP_MAX) {
-            printf("Error: Invalid opcode %i\n", ope);
-            return 0;
-        }
+    // check the instructions found
+    if (i < count || offset > length) {
+        if (offset < length && !sizes[code[offset]])
+            printf("Error: Invalid opcode %i at instruction %u.\n", code[offset], i);
+        else
+            printf("Error: Code section truncated at instruction %u.\n", offset > length ? i - 1 : i);
+        free(starts);
+        return 0;
+    }
 
-        // parse the opcode
-        qvm->opcodes[curr_instr].qvm = qvm;
-        qvm->opcodes[curr_instr].address = curr_instr;
-        qvm->opcodes[curr_instr].info = &qvm_opcodes_info[ope];
-        qvm->opcodes[curr_instr].opblock = NULL;
+    // gather the opcodes and their parameters, the 4 bytes after each opcode are masked by its parameter size
+    for (i = 0; i < count; i++) {
+        qvm_opcode_t    *op = &qvm->opcodes[i];
+        unsigned int    word = 0;
 
-        // parse the opcode parameters if any
-        if (qvm->opcodes[curr_instr].info->param_size == 4)
-            qvm->opcodes[curr_instr].value = *(int *)raw_opcodes;
-        else if (qvm->opcodes[curr_instr].info->param_size == 1)
-            qvm->opcodes[curr_instr].value = *raw_opcodes;
+        op->qvm = qvm;
+        op->address = i;
+        op->info = &qvm_opcodes_info[code[starts[i]]];
+        memcpy(&word, code + starts[i] + 1, starts[i] + 5 <= length ? 4 : length - starts[i] - 1);
+        op->value = (int)(word & masks[op->info->param_size]);
+    }
 
-        // go to the next opcode
-        raw_opcodes += qvm->opcodes[curr_instr].info->param_size;
+    // free the instructions offsets
+    free(starts);
+
+    // find the constants taking a global address
+    if (!qvm_load_opcodes_globals(qvm))
+        return 0;
+
+    printf("Success: %i opcodes found.\n", count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_opcodes_globals(qvm_t *qvm)
+{
+    qvm_opblock_info_t  *info;
+    qvm_opcode_t        *op;
+    unsigned int        *stack;
+    unsigned int        depth = 0;
+    unsigned int        operands[2];
+    unsigned int        data_length;
+
+    // allocate the stack of the opcodes pushing a value
+    if (!(stack = malloc(sizeof(*stack) * (qvm->header->instructions_count + 1)))) {
+        printf("Error: Couldn't allocate opcodes stack.\n");
+        return 0;
+    }
+
+    // get the length of all data sections, a constant operand inside may be a global address
+    data_length = qvm->sections[S_DATA].length + qvm->sections[S_LIT].length + qvm->sections[S_BSS].length;
+
+    // browse the opcodes like the opblocks, without building them so it is known before the analysis
+    for (unsigned int i = 0; i < qvm->header->instructions_count; i++) {
+        op = &qvm->opcodes[i];
+        info = &qvm_opblocks_info[op->info->opblock_id];
+
+        // pop the operands, the first one from the top of the stack
+        operands[0] = operands[1] = (unsigned int)-1;
+        if ((info->flags & (OPB_F_STACK_POP | OPB_F_STACK_2POP)) && depth)
+            operands[0] = stack[--depth];
+        if ((info->flags & OPB_F_STACK_2POP) && depth)
+            operands[1] = stack[--depth];
+
+        // a constant loaded, stored to or copied is a global address
+        if (info->id == OPB_LOAD)
+            qvm_load_opcodes_global(qvm, operands[0], 0, (unsigned int)-1);
+        if (info->id == OPB_ASSIGNATION || info->id == OPB_STRUCT_COPY)
+            qvm_load_opcodes_global(qvm, operands[1], 0, (unsigned int)-1);
+        if (info->id == OPB_STRUCT_COPY)
+            qvm_load_opcodes_global(qvm, operands[0], 0, (unsigned int)-1);
+
+        // a constant passed, stored, returned or added to inside the data sections is a global address, the small constants are too often plain numbers
+        if (info->id == OPB_FUNC_ARG || info->id == OPB_FUNC_RETURN || info->id == OPB_ASSIGNATION)
+            qvm_load_opcodes_global(qvm, operands[0], XREF_ADDRESS_MIN, data_length);
+        if (info->id == OPB_DOUBLE_OPERATION && (op->info->id == OP_ADD || op->info->id == OP_SUB)) {
+            qvm_load_opcodes_global(qvm, operands[0], XREF_ADDRESS_MIN, data_length);
+            qvm_load_opcodes_global(qvm, operands[1], XREF_ADDRESS_MIN, data_length);
+        }
+
+        // push the opcode if it gives a value
+        if (info->flags & OPB_F_STACK_PUSH)
+            stack[depth++] = i;
     }
 
-    printf("Success: %i opcodes found.\n", curr_instr);
+    // free the stack
+    free(stack);
 
     // success
     return 1;
 }
 
+static void qvm_load_opcodes_global(qvm_t *qvm, unsigned int address, unsigned int min, unsigned int max)
+{
+    qvm_opcode_t    *op;
+
+    // check if the operand is a constant in the range
+    if (address == (unsigned int)-1)
+        return;
+    op = &qvm->opcodes[address];
+    if (op->info->id == OP_CONST && (unsigned int)op->value >= min && (unsigned int)op->value < max)
+        op->global = 1;
+}
+
 static int qvm_load_functions(qvm_t *qvm)
 {
     printf("Loading functions...");
@@ -393,23 +970,69 @@ static void qvm_load_functions_data(qvm_t *qvm)
             // set the function qvm
             func->qvm = qvm;
 
-            // set the function address
+            // set the function id and address
+            func->id = func_count;
             func->address = curr_instr;
 
             // set the function name
-            if (!func->address)
-                sprintf(func->name, "vmMain");
-            else
-                sprintf(func->name, "sub_%x", func->address);
+            func_rename_default(func);
 
             // set the function stack size
             func->stack_size = op->value;
         }
 
-        // increase the function size if needed
-        if (func)
-            func->op_size++;
+        // increase the function size if needed
+        if (func)
+            func->op_size++;
+    }
+}
+
+static int qvm_load_selection(qvm_t *qvm, opt_select_t *selects, unsigned int selects_count)
+{
+    qvm_function_t  *func;
+    opt_select_t    *sel;
+
+    // select all functions by default
+    qvm->selected_count = qvm->functions_count;
+    if (!selects_count)
+        return 1;
+
+    printf("Loading selection...");
+
+    // browse all functions
+    qvm->selected_count = 0;
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        // get the current function
+        func = &qvm->functions[i];
+        func->selected = 0;
+
+        // check if the function name or its addresses are selected
+        for (unsigned int j = 0; j < selects_count && !func->selected; j++) {
+            sel = &selects[j];
+            if (sel->name)
+                func->selected = !strcmp(func->name, sel->name);
+            else
+                func->selected = sel->start < func->address + func->op_size && sel->end >= func->address;
+        }
+
+        // analyze only the selected functions
+        func->analyzed = func->selected;
+
+        // count the selected functions
+        if (func->selected)
+            qvm->selected_count++;
+    }
+
+    // check if there is a function selected
+    if (!qvm->selected_count) {
+        printf("Error: No function matches the selection.\n");
+        return 0;
     }
+
+    printf("Success: %i functions selected.\n", qvm->selected_count);
+
+    // success
+    return 1;
 }
 
 static int qvm_load_jumppoints(qvm_t *qvm) {
@@ -417,6 +1040,12 @@ static int qvm_load_jumppoints(qvm_t *qvm) {
 
     printf("Loading jumppoints...");
 
+    // allocate the jumppoints index by address
+    if (!(qvm->jumppoints_index = calloc(qvm->header->instructions_count + 1, sizeof(*qvm->jumppoints_index)))) {
+        printf("Error: Couldn't allocate jumppoints index.\n");
+        return 0;
+    }
+
     // browse all opcodes
     for (unsigned int curr_instr = 0; curr_instr < qvm->header->instructions_count; curr_instr++) {
         qvm_opcode_t    *op;
@@ -457,17 +1086,30 @@ static int qvm_load_jumppoints(qvm_t *qvm) {
 }
 
 static int qvm_load_opblocks(qvm_t *qvm)
+{
+    unsigned int    opblocks_count = 0;
+
+    printf("Loading opblocks...");
+
+    // load the opblocks of the whole program
+    if (!qvm_load_opblocks_range(qvm, 0, qvm->header->instructions_count, &qvm->opblocks, &opblocks_count))
+        return 0;
+
+    printf("Success: %i opblocks found.\n", opblocks_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_opblocks_range(qvm_t *qvm, unsigned int start, unsigned int end, qvm_opblock_t **opblocks, unsigned int *opblocks_count)
 {
     qvm_opblock_t   *stack = NULL;
     qvm_opblock_t   *final_opb = NULL;
     unsigned int    address_start = (unsigned int)-1;
-    unsigned int    opblocks_count = 0;
     qvm_function_t  *curr_func = NULL;
 
-    printf("Loading opblocks...");
-
-    // browse all opcodes
-    for (unsigned int curr_instr = 0; curr_instr < qvm->header->instructions_count; curr_instr++) {
+    // browse all opcodes of the range
+    for (unsigned int curr_instr = start; curr_instr < end; curr_instr++) {
         qvm_opcode_t    *op;
         qvm_opblock_t   *opb;
         qvm_jumppoint_t *jmp;
@@ -559,14 +1201,15 @@ static int qvm_load_opblocks(qvm_t *qvm)
             jmp_opb->info = &qvm_opblocks_info[OPB_JUMP_POINT];
             jmp_opb->jumppoint = jmp;
             jmp_opb->function = curr_func;
+            jmp->opblock = jmp_opb;
 
             // add it in first place if needed
             if (!final_opb)
-                qvm->opblocks = jmp_opb;
+                *opblocks = jmp_opb;
 
             // add the opblock to the list
             opb_add(jmp_opb, &final_opb);
-            opblocks_count++;
+            (*opblocks_count)++;
 
             // reset the opblock in function if needed
             if (opb->info->id == OPB_FUNC_ENTER)
@@ -586,19 +1229,20 @@ static int qvm_load_opblocks(qvm_t *qvm)
             // reset the start address for the next opblock
             address_start = (unsigned int)-1;
 
-            // if this is the first opblock save it in qvm
+            // if this is the first opblock save it
             if (!final_opb)
-                qvm->opblocks = opb;
+                *opblocks = opb;
 
             // add the opblock to the list
             opb_add(opb, &final_opb);
-            opblocks_count++;
+            (*opblocks_count)++;
         }
 
-        // link the direct function calls
-        if (opb->info->id == OPB_FUNC_CALL && opb->child->info->id == OPB_CONST)
+        // link the direct function calls, the syscalls are linked by the syscalls analysis
+        if (opb->info->id == OPB_FUNC_CALL && opb->child->info->id == OPB_CONST && (unsigned int)opb->child->opcode->value < qvm->header->instructions_count)
             if ((opb->function_called = func_find(qvm, opb->child->opcode->value)) && curr_func)
-                if (!func_list_add(&curr_func->calls, opb->function_called) || !func_list_add(&opb->function_called->called_by, curr_func))
+                if (!func_graph_add(&qvm->graph, &curr_func->calls, opb->function_called) || !func_graph_add(&qvm->graph, &opb->function_called->called_by, curr_func) ||
+                    !xref_add(&qvm->xrefs, &opb->function_called->xrefs, XREF_CALL, opb->opcode->address, curr_func))
                     return 0;
 
         // link the comparaisons to the jumppoints
@@ -629,8 +1273,6 @@ static int qvm_load_opblocks(qvm_t *qvm)
         return 0;
     }
 
-    printf("Success: %i opblocks found.\n", opblocks_count);
-
     // success
     return 1;
 }
@@ -643,16 +1285,22 @@ static int qvm_load_syscalls(qvm_t *qvm)
     if (!opb_foreach(qvm, qvm_load_syscalls_usage))
         return 0;
 
-    // rename syscalls from map entries
+    // name syscalls from the syscalls table, then from map entries
+    qvm_load_syscalls_table(qvm);
     qvm_load_map_functions(qvm);
 
-    printf("Success: %i syscalls found.\n", qvm->syscalls_count);
+    if (qvm->syscalls_table)
+        printf("Success: %i syscalls found, named from the %s table.\n", qvm->syscalls_count, qvm->syscalls_table->name);
+    else
+        printf("Success: %i syscalls found.\n", qvm->syscalls_count);
     return 1;
 }
 
 static int qvm_load_syscalls_usage(qvm_opblock_t *opb)
 {
     qvm_opblock_t   *call;
+    qvm_opblock_t   *tmp;
+    unsigned int    args_count = 0;
 
     // check if there is a call in the opblock
     if (!(call = opb_is_call(opb)))
@@ -667,15 +1315,48 @@ static int qvm_load_syscalls_usage(qvm_opblock_t *opb)
         if (!(call->function_called = func_add_syscall(opb->qvm, call->child->opcode->value)))
             return 0;
 
-    // add the calls and called_by
+    // add the calls, called_by and the call reference
     if (call->function)
-        if (!func_list_add(&call->function->calls, call->function_called) || !func_list_add(&call->function_called->called_by, call->function))
+        if (!func_graph_add(&opb->qvm->graph, &call->function->calls, call->function_called) || !func_graph_add(&opb->qvm->graph, &call->function_called->called_by, call->function) ||
+            !xref_add(&opb->qvm->xrefs, &call->function_called->xrefs, XREF_CALL, call->opcode->address, call->function))
             return 0;
 
+    // check if a syscall is called
+    if (call->function_called->id < opb->qvm->functions_count)
+        return 1;
+
+    // count the args pushed just before the call, until the first arg
+    for (tmp = opb->prev; tmp && tmp->info->id == OPB_FUNC_ARG; tmp = tmp->prev) {
+        args_count++;
+        if (tmp->opcode->value == 8)
+            break;
+    }
+
+    // keep the biggest args count of the syscall if it's not known from a table
+    if (!opb->qvm->syscalls_table && args_count > call->function_called->args_count)
+        call->function_called->args_count = args_count;
+
     // success
     return 1;
 }
 
+static void qvm_load_syscalls_table(qvm_t *qvm)
+{
+    qvm_function_t  *sysc;
+    qvm_syscall_t   *entry;
+
+    // select the syscalls table from the syscalls found and their args count
+    if (!(qvm->syscalls_table = syscalls_table_select(qvm)))
+        return;
+
+    // name the syscalls and set their args count from the table
+    for (sysc = qvm->syscalls; sysc; sysc = sysc->next) {
+        func_rename_default(sysc);
+        if ((entry = syscalls_find(qvm->syscalls_table, sysc->address)))
+            sysc->args_count = entry->args_count;
+    }
+}
+
 static int qvm_load_variables(qvm_t *qvm)
 {
     printf("Loading variables...");
@@ -684,6 +1365,41 @@ static int qvm_load_variables(qvm_t *qvm)
     if (!opb_foreach(qvm, qvm_load_variables_usage))
         return 0;
 
+    // find all globals
+    if (!qvm_load_variables_globals(qvm))
+        return 0;
+
+    // find all locals of the analyzed functions
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        if (qvm->functions[i].analyzed && !qvm_load_variables_locals(qvm, &qvm->functions[i]))
+            return 0;
+
+    printf("Success: %i globals and %i locals found.\n", qvm->globals_count, qvm->locals_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_graph(qvm_t *qvm)
+{
+    unsigned int    edges_count = qvm->graph.edges_count;
+
+    printf("Loading calls graph...");
+
+    // resolve the constants taking a global address, then remove the duplicated edges and references and store the arrays contiguously
+    if (!qvm_load_variables_constants(qvm) || !func_graph_freeze(&qvm->graph) || !xref_freeze(&qvm->xrefs))
+        return 0;
+
+    printf("Success: %u edges found, %u unique and %u cross references indexed.\n", edges_count, qvm->graph.adjacency_count, qvm->xrefs.xrefs_count);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_variables_globals(qvm_t *qvm)
+{
+    qvm_variable_t  *var;
+
     // load all variables from sections length
     if (!qvm_load_variables_sections(qvm))
         return 0;
@@ -691,25 +1407,54 @@ static int qvm_load_variables(qvm_t *qvm)
     // find all globals size
     qvm_load_variables_globals_size(qvm);
 
-    // find all locals size
-    qvm_load_variables_locals_size(qvm);
-
-    // recut variables from probs
-    if (!qvm_load_variables_probs(qvm))
-        return 0;
+    // recut all globals that are represented with 4 bytes
+    for (var = qvm->globals; var; var = var->next)
+        if (var->size > 4 && var->prob_size[4])
+            if (!var_cut(qvm, NULL, var->address + 4))
+                return 0;
 
     // find all globals name from map file
     if (!map_foreach(qvm, qvm_load_variables_map))
         return 0;
 
     // find the alphanumeric literals
-    if (!qvm_load_variables_literals(qvm))
+    if (!qvm_load_variables_literals(qvm, 0, UINT_MAX))
         return 0;
 
-    // find the variables types
-    qvm_load_variables_types(qvm);
+    // find all globals default type
+    for (var = qvm->globals; var; var = var->next)
+        var->type = type_from_var(var);
+
+    // success
+    return 1;
+}
 
-    printf("Success: %i globals and %i locals found.\n", qvm->globals_count, qvm->locals_count);
+static int qvm_load_variables_locals(qvm_t *qvm, qvm_function_t *func)
+{
+    qvm_variable_t  *var;
+
+    // find all locals size
+    for (var = func->locals; var && var->address < func->stack_size; var = var->next) {
+        if (var->next && var->next->address < func->stack_size)
+            var->size = var->next->address - var->address;
+        else
+            var->size = func->stack_size - var->address;
+    }
+
+    // set default args size
+    for (; var; var = var->next)
+        var->size = 4;
+
+    // recut all locals that are represented with 4 bytes
+    for (var = func->locals; var && var->address < func->stack_size; var = var->next) {
+        if (var->size > 4 && var->prob_size[4])
+            if (!var_cut(qvm, func, var->address + 4))
+                return 0;
+    }
+
+    // find all locals default type
+    for (var = func->locals; var && var->address < func->stack_size; var = var->next)
+        var->type = type_from_var(var);
 
     // success
     return 1;
@@ -717,10 +1462,16 @@ static int qvm_load_variables(qvm_t *qvm)
 
 static int qvm_load_variables_usage(qvm_opblock_t *opb)
 {
+    char    locals;
+
+    // check if the locals of the function are analyzed
+    locals = !opb->function || opb->function->analyzed;
+
     // check if there is a constant or a local address loaded by load opcode
     if (opb->info->id == OPB_LOAD)
-        if (opb->child->info->id == OPB_LOCAL_ADR || opb->child->info->id == OPB_CONST) {
-            if (!(opb->child->variable = var_get(opb->qvm, opb->child->info->id != OPB_CONST ? opb->function : NULL, opb->child->opcode->value, opb->opcode->value, opb->function)))
+        if ((opb->child->info->id == OPB_LOCAL_ADR && locals) || opb->child->info->id == OPB_CONST) {
+            if (!(opb->child->variable = var_get(opb->qvm, opb->child->info->id != OPB_CONST ? opb->function : NULL, opb->child->opcode->value, opb->opcode->value, opb->function)) ||
+                !xref_add(&opb->qvm->xrefs, &opb->child->variable->xrefs, XREF_READ, opb->opcode->address, opb->function))
                 return 0;
             if (opb->child->info->id == OPB_CONST)
                 opb->child->info = &qvm_opblocks_info[OPB_GLOBAL_ADR];
@@ -728,8 +1479,9 @@ static int qvm_load_variables_usage(qvm_opblock_t *opb)
 
     // check if there is a constant or a local address loaded by store opcode
     if (opb->info->id == OPB_ASSIGNATION)
-        if (opb->op2->info->id == OPB_LOCAL_ADR || opb->op2->info->id == OPB_CONST) {
-            if (!(opb->op2->variable = var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value, opb->opcode->value, opb->function)))
+        if ((opb->op2->info->id == OPB_LOCAL_ADR && locals) || opb->op2->info->id == OPB_CONST) {
+            if (!(opb->op2->variable = var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value, opb->opcode->value, opb->function)) ||
+                !xref_add(&opb->qvm->xrefs, &opb->op2->variable->xrefs, XREF_WRITE, opb->opcode->address, opb->function))
                 return 0;
             if (opb->op2->info->id == OPB_CONST)
                 opb->op2->info = &qvm_opblocks_info[OPB_GLOBAL_ADR];
@@ -737,25 +1489,36 @@ static int qvm_load_variables_usage(qvm_opblock_t *opb)
 
     // check if there is a constant or a local address loaded by block_copy opcode
     if (opb->info->id == OPB_STRUCT_COPY) {
-        if (opb->op1->info->id == OPB_CONST || opb->op1->info->id == OPB_LOCAL_ADR) {
-            if (!(opb->op1->variable = var_get(opb->qvm, opb->op1->info->id != OPB_CONST ? opb->function : NULL, opb->op1->opcode->value, 0, opb->function)))
+        if (opb->op1->info->id == OPB_CONST || (opb->op1->info->id == OPB_LOCAL_ADR && locals)) {
+            if (!(opb->op1->variable = var_get(opb->qvm, opb->op1->info->id != OPB_CONST ? opb->function : NULL, opb->op1->opcode->value, 0, opb->function)) ||
+                !xref_add(&opb->qvm->xrefs, &opb->op1->variable->xrefs, XREF_READ, opb->opcode->address, opb->function))
                 return 0;
             if (opb->op1->info->id == OPB_CONST)
                 opb->op1->info = &qvm_opblocks_info[OPB_GLOBAL_ADR];
-            var_get(opb->qvm, opb->op1->info->id != OPB_CONST ? opb->function : NULL, opb->op1->opcode->value + opb->opcode->value, 0, NULL);
+            if (locals)
+                var_get(opb->qvm, opb->op1->info->id != OPB_CONST ? opb->function : NULL, opb->op1->opcode->value + opb->opcode->value, 0, NULL);
         }
-        if (opb->op2->info->id == OPB_CONST || opb->op2->info->id == OPB_LOCAL_ADR) {
-            if (!(opb->op2->variable = var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value, 0, opb->function)))
+        if (opb->op2->info->id == OPB_CONST || (opb->op2->info->id == OPB_LOCAL_ADR && locals)) {
+            if (!(opb->op2->variable = var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value, 0, opb->function)) ||
+                !xref_add(&opb->qvm->xrefs, &opb->op2->variable->xrefs, XREF_WRITE, opb->opcode->address, opb->function))
                 return 0;
             if (opb->op2->info->id == OPB_CONST)
                 opb->op2->info = &qvm_opblocks_info[OPB_GLOBAL_ADR];
-            var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value + opb->opcode->value, 0, NULL);
+            if (locals)
+                var_get(opb->qvm, opb->op2->info->id != OPB_CONST ? opb->function : NULL, opb->op2->opcode->value + opb->opcode->value, 0, NULL);
         }
     }
 
-    // check if this is a local address
-    if (opb->info->id == OPB_LOCAL_ADR)
-        if (!(opb->variable = var_get(opb->qvm, opb->function, opb->opcode->value, 0, opb->function)))
+    // check if there is a constant operand passed, stored, returned or added to, it may take a global address
+    if (opb->info->id == OPB_FUNC_ARG || opb->info->id == OPB_FUNC_RETURN || opb->info->id == OPB_ASSIGNATION ||
+        (opb->info->id == OPB_DOUBLE_OPERATION && (opb->opcode->info->id == OP_ADD || opb->opcode->info->id == OP_SUB)))
+        if (!qvm_load_variables_constant(opb, opb->child) || !qvm_load_variables_constant(opb, opb->op1) || !qvm_load_variables_constant(opb, opb->op2))
+            return 0;
+
+    // check if this is a local address, the loaded, stored and copied ones already have their variable
+    if (opb->info->id == OPB_LOCAL_ADR && locals && !opb->variable)
+        if (!(opb->variable = var_get(opb->qvm, opb->function, opb->opcode->value, 0, opb->function)) ||
+            !xref_add(&opb->qvm->xrefs, &opb->variable->xrefs, XREF_ADDRESS, opb->opcode->address, opb->function))
                 return 0;
 
     // load the variables from the child if needed
@@ -774,6 +1537,65 @@ static int qvm_load_variables_usage(qvm_opblock_t *opb)
     return 1;
 }
 
+static int qvm_load_variables_constant(qvm_opblock_t *opb, qvm_opblock_t *operand)
+{
+    // keep the constant until all the globals are known
+    if (operand && operand->info->id == OPB_CONST)
+        return xref_add_constant(&opb->qvm->xrefs, operand->opcode->address, opb->function);
+
+    // success
+    return 1;
+}
+
+static int qvm_load_variables_constants(qvm_t *qvm)
+{
+    qvm_variable_t  **globals;
+    qvm_variable_t  *var;
+    qvm_xref_t      *constant;
+    unsigned int    count = 0;
+    unsigned int    start;
+    unsigned int    end;
+    unsigned int    middle;
+    unsigned int    value;
+
+    // put the globals sorted by address in an array
+    if (!(globals = malloc(sizeof(*globals) * (qvm->globals_count + 1)))) {
+        printf("Error: Couldn't allocate globals addresses.\n");
+        return 0;
+    }
+    for (var = qvm->globals; var; var = var->next)
+        globals[count++] = var;
+
+    // browse the constants kept by the variables usage
+    for (unsigned int i = 0; i < qvm->xrefs.constants_count; i++) {
+        constant = &qvm->xrefs.constants[i];
+        value = (unsigned int)qvm->opcodes[constant->address].value;
+
+        // find the global starting at the constant, the small constants are too often plain numbers
+        for (start = 0, end = count; start < end;) {
+            middle = start + (end - start) / 2;
+            if (globals[middle]->address < value)
+                start = middle + 1;
+            else
+                end = middle;
+        }
+        if (value < XREF_ADDRESS_MIN || start >= count || globals[start]->address != value)
+            continue;
+
+        // add the global address reference
+        if (!xref_add(&qvm->xrefs, &globals[start]->xrefs, XREF_ADDRESS, constant->address, constant->function)) {
+            free(globals);
+            return 0;
+        }
+    }
+
+    // free the globals array
+    free(globals);
+
+    // success
+    return 1;
+}
+
 static int qvm_load_variables_sections(qvm_t *qvm)
 {
     // get the data variable
@@ -806,30 +1628,6 @@ static void qvm_load_variables_globals_size(qvm_t *qvm)
     }
 }
 
-static void qvm_load_variables_locals_size(qvm_t *qvm)
-{
-    qvm_function_t  *func;
-    qvm_variable_t  *var;
-    
-    // search in all functions
-    for (unsigned int i = 0; i < qvm->functions_count; i++) {
-        // get the current function
-        func = &qvm->functions[i];
-
-        // search in all locals variable
-        for (var = func->locals; var && var->address < func->stack_size; var = var->next) {
-            if (var->next && var->next->address < func->stack_size)
-                var->size = var->next->address - var->address;
-            else
-                var->size = func->stack_size - var->address;
-        }
-
-        // set default args size
-        for (; var; var = var->next)
-            var->size = 4;
-    }
-}
-
 static int qvm_load_variables_map(qvm_t *qvm, qvm_map_t *map)
 {
     qvm_variable_t  *var;
@@ -858,54 +1656,32 @@ static int qvm_load_variables_map(qvm_t *qvm, qvm_map_t *map)
     return 1;
 }
 
-static int qvm_load_variables_probs(qvm_t *qvm)
-{
-    qvm_variable_t  *var;
-    qvm_function_t  *func;
-
-    // recut all globals that are represented with 4 bytes
-    for (var = qvm->globals; var; var = var->next)
-        if (var->size > 4 && var->prob_size[4])
-            if (!var_cut(qvm, NULL, var->address + 4))
-                return 0;
-
-    // browse all functions
-    for (unsigned int i = 0; i < qvm->functions_count; i++) {
-        // get the current function
-        func = &qvm->functions[i];
-
-        // recut all locals that are represented with 4 bytes
-        for (var = func->locals; var && var->address < func->stack_size; var = var->next) {
-            if (var->size > 4 && var->prob_size[4])
-                if (!var_cut(qvm, func, var->address + 4))
-                    return 0;
-        }
-    }
-
-    // success
-    return 1;
-}
-
-static int qvm_load_variables_literals(qvm_t *qvm)
+static int qvm_load_variables_literals(qvm_t *qvm, unsigned int start, unsigned int end)
 {
     qvm_variable_t  *var;
+    unsigned int    address;
 
     // find all alphanum literals
     for (unsigned int lit_address = 0; lit_address < qvm->sections[S_LIT].length; lit_address++) {
         if (str_is_print(qvm->sections[S_LIT].content + lit_address, qvm->sections[S_LIT].length - lit_address)) {
-            // cut the alphanum variable
-            if (!(var = var_cut(qvm, NULL, lit_address + qvm->sections[S_DATA].length)))
-                return 0;
+            // cut the alphanum variable if it is in the range
+            address = lit_address + qvm->sections[S_DATA].length;
+            if (address >= start && address < end) {
+                if (!(var = var_cut(qvm, NULL, address)))
+                    return 0;
 
-            // set the alphanum variable status
-            var->status = VS_LITERAL_TEXT;
+                // set the alphanum variable status
+                var->status = VS_LITERAL_TEXT;
+            }
 
             // go to the next literal variable
             lit_address += strlen(qvm->sections[S_LIT].content + lit_address);
 
-            // cut the end of the alphanum variable
-            if (!(var = var_cut(qvm, NULL, lit_address + qvm->sections[S_DATA].length + 1)))
-                return 0;
+            // cut the end of the alphanum variable if it is in the range
+            address = lit_address + qvm->sections[S_DATA].length + 1;
+            if (address >= start && address < end)
+                if (!(var = var_cut(qvm, NULL, address)))
+                    return 0;
         }
     }
 
@@ -913,97 +1689,156 @@ static int qvm_load_variables_literals(qvm_t *qvm)
     return 1;
 }
 
-static void qvm_load_variables_types(qvm_t *qvm)
+static void qvm_load_variables_ids(qvm_t *qvm)
 {
     qvm_variable_t  *var;
-    qvm_function_t  *func;
+    unsigned int    id = 0;
 
-    // find all globals default type
+    // number all the globals
     for (var = qvm->globals; var; var = var->next)
-        var->type = type_from_var(var);
-
-    // browse all functions
-    for (unsigned int i = 0; i < qvm->functions_count; i++) {
-        // get the current function
-        func = &qvm->functions[i];
+        var->id = id++;
 
-        // find all locals default type
-        for (var = func->locals; var && var->address < func->stack_size; var = var->next)
-            var->type = type_from_var(var);
-    }
+    // number all the locals
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        for (var = qvm->functions[i].locals; var; var = var->next)
+            var->id = id++;
 }
 
-static int qvm_load_returns(qvm_t *qvm)
+static int qvm_load_functions_analysis(qvm_t *qvm, unsigned int threads_count)
 {
-    qvm_function_t  *func;
-    qvm_opblock_t   *opb;
-    qvm_jumppoint_t *jmp;
-    unsigned int    returns_corrected = 0, jumppoints_removed = 0;
-    qvm_opblock_t   *removed;
+    qvm_function_sccs_t     sccs;
+    qvm_analysis_level_t    level;
+    qvm_analysis_t          analysis;
 
-    printf("Loading returns...");
+    printf("Loading functions analysis...");
 
-    // browse all functions
-    for (unsigned int i = 0; i < qvm->functions_count; i++) {
-        func = &qvm->functions[i];
+    // find the calls graph components, from the callees to the callers
+    if (!func_sccs_load(qvm, &sccs, NULL))
+        return 0;
 
-        // check if there is a return jump point
-        if (!func->opblock_end ||
-            !func->opblock_end->prev ||
-            !func->opblock_end->prev->prev ||
-            func->opblock_end->prev->prev->function != func ||
-            func->opblock_end->prev->prev->info->id != OPB_JUMP_POINT)
-            continue;
+    // allocate the analysis of each component
+    if (!(level.analyses = calloc(sccs.count + 1, sizeof(*level.analyses)))) {
+        printf("Error: Couldn't allocate functions analysis.\n");
+        func_sccs_free(&sccs);
+        return 0;
+    }
+    level.qvm = qvm;
+    level.sccs = &sccs;
+
+    // analyze the components level by level, the components of a level only call the lower levels
+    for (unsigned int i = 0; i < sccs.levels_count; i++) {
+        level.level_start = sccs.levels[i];
+        if (!pool_run(sccs.levels[i + 1] - sccs.levels[i], threads_count, &level, qvm_load_functions_analysis_job)) {
+            free(level.analyses);
+            func_sccs_free(&sccs);
+            return 0;
+        }
+    }
 
-        // save the jumppoint
-        jmp = func->opblock_end->prev->prev->jumppoint;
-
-        // browse all function opblocks
-        for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
-            if (opb->info->id == OPB_FUNC_RETURN)
-                if (opb->next && opb->next->info->id == OPB_JUMP)
-                    if (opb->next->jumppoint == jmp) {
-                        opb->return_goto = opb->next;
-                        opb->next = opb->next->next;
-                        opb->next->prev = opb;
-                        opb->return_goto->next = NULL;
-                        opb->return_goto->prev = opb;
-                        returns_corrected++;
-                        if (!--jmp->parents_count) {
-                            removed = func->opblock_end->prev->prev;
-                            removed->prev->next = removed->next;
-                            removed->next->prev = removed->prev;
-                            jumppoints_removed++;
-                        }
-                    }
+    // sum the components analysis
+    memset(&analysis, 0, sizeof(analysis));
+    for (unsigned int i = 0; i < sccs.count; i++) {
+        analysis.returns_corrected += level.analyses[i].returns_corrected;
+        analysis.jumppoints_removed += level.analyses[i].jumppoints_removed;
+        analysis.calls_total += level.analyses[i].calls_total;
+        analysis.calls_restored += level.analyses[i].calls_restored;
+        analysis.variadic_count += level.analyses[i].variadic_count;
     }
 
-    printf("Success: %i returns corrected and %i jumppoints removed.\n", returns_corrected, jumppoints_removed);
+    // save the % of restored calls
+    qvm->calls_total = analysis.calls_total;
+    qvm->calls_restored = analysis.calls_restored;
+    if (qvm->calls_total)
+        qvm->restored_calls_perc = (float)(qvm->calls_restored * 100) / (float)qvm->calls_total;
+
+    printf("Success: %i components in %i levels, %i returns corrected, %i jumppoints removed, %.2f%% of calls restored and %i variadic functions found.\n",
+        sccs.count, sccs.levels_count, analysis.returns_corrected, analysis.jumppoints_removed, qvm->restored_calls_perc, analysis.variadic_count);
+
+    // free the components
+    free(level.analyses);
+    func_sccs_free(&sccs);
 
     // success
     return 1;
 }
 
-static int qvm_load_calls(qvm_t *qvm)
+static int qvm_load_functions_analysis_job(void *context, unsigned int index)
 {
-    printf("Loading calls...");
+    qvm_analysis_level_t    *level = context;
+    qvm_function_sccs_t     *sccs = level->sccs;
+    unsigned int            scc = level->level_start + index;
+    qvm_function_t          *func;
+
+    // analyze the analyzed functions of the component
+    for (unsigned int i = sccs->starts[scc]; i < sccs->starts[scc + 1]; i++) {
+        func = &level->qvm->functions[sccs->functions[i]];
+        if (func->analyzed)
+            qvm_load_function_summary(func, func->opblock_end ? func->opblock_end->prev : NULL, &level->analyses[scc]);
+    }
 
-    qvm->calls_total = 0;
-    qvm->calls_restored = 0;
+    // success
+    return 1;
+}
 
-    // load each calls from opblocks
-    opb_foreach(qvm, qvm_load_calls_opb);
+static void qvm_load_function_summary(qvm_function_t *func, qvm_opblock_t *last, qvm_analysis_t *analysis)
+{
+    qvm_opblock_t   *opb;
 
-    // save the % of restored calls
-    qvm->restored_calls_perc = (float)(qvm->calls_restored * 100) / (float)qvm->calls_total;
+    // correct the returns
+    analysis->returns_corrected += qvm_load_returns_function(func, last, &analysis->jumppoints_removed);
 
-    printf("Success: %.2f%% of calls restored.\n", qvm->restored_calls_perc);
+    // restore the calls
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
+        qvm_load_calls_opb(opb, analysis);
 
-    // success
-    return 1;
+    // find the variadic function
+    analysis->variadic_count += qvm_load_variadic_function(func);
+
+    // find the arguments count
+    qvm_load_args_function(func);
+}
+
+static unsigned int qvm_load_returns_function(qvm_function_t *func, qvm_opblock_t *last, unsigned int *jumppoints_removed)
+{
+    qvm_opblock_t   *opb;
+    qvm_jumppoint_t *jmp;
+    unsigned int    returns_corrected = 0;
+    qvm_opblock_t   *removed;
+
+    // check if there is a return jump point before the last opblock
+    if (!last ||
+        !last->prev ||
+        last->prev->function != func ||
+        last->prev->info->id != OPB_JUMP_POINT)
+        return 0;
+
+    // save the jumppoint
+    jmp = last->prev->jumppoint;
+
+    // browse all function opblocks
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
+        if (opb->info->id == OPB_FUNC_RETURN)
+            if (opb->next && opb->next->info->id == OPB_JUMP)
+                if (opb->next->jumppoint == jmp) {
+                    opb->return_goto = opb->next;
+                    opb->next = opb->next->next;
+                    opb->next->prev = opb;
+                    opb->return_goto->next = NULL;
+                    opb->return_goto->prev = opb;
+                    returns_corrected++;
+                    if (!--jmp->parents_count) {
+                        removed = last->prev;
+                        removed->prev->next = removed->next;
+                        removed->next->prev = removed->prev;
+                        (*jumppoints_removed)++;
+                    }
+                }
+
+    // return the returns corrected count
+    return returns_corrected;
 }
 
-static int qvm_load_calls_opb(qvm_opblock_t *opb)
+static void qvm_load_calls_opb(qvm_opblock_t *opb, qvm_analysis_t *analysis)
 {
     qvm_opblock_t   *tmp;
     qvm_opblock_t   *call;
@@ -1012,23 +1847,27 @@ static int qvm_load_calls_opb(qvm_opblock_t *opb)
     // save the current opblock
     curr = opb;
 
+    // check if the function is analyzed
+    if (curr->function && !curr->function->analyzed)
+        return;
+
     // go to the next opblock
     opb = opb->next;
 
     // check if the next opblock exist
     if (!opb)
-        return 1;
+        return;
 
     // check if the opblock is an arg
     if (opb->info->id != OPB_FUNC_ARG)
-        return 1;
+        return;
 
     // check if the opblock is the first arg
     if (opb->opcode->value != 8)
-        return 1;
+        return;
 
     // increase the total of calls
-    opb->qvm->calls_total++;
+    analysis->calls_total++;
 
     // go to the next opblock
     tmp = opb->next;
@@ -1039,11 +1878,11 @@ static int qvm_load_calls_opb(qvm_opblock_t *opb)
 
     // check if we found an opblock
     if (!tmp)
-        return 1;
+        return;
 
     // check if the opblock contain a call
     if (!(call = opb_is_call(tmp)))
-        return 1;
+        return;
         
     // save the call function arg
     call->function_arg = opb;
@@ -1054,64 +1893,56 @@ static int qvm_load_calls_opb(qvm_opblock_t *opb)
     tmp->prev = opb->prev;
 
     // increase the total of calls restored
-    opb->qvm->calls_restored++;
+    analysis->calls_restored++;
 
     // change the value of the current opblock
     curr->next = tmp;
 
-    // success
-    return 1;
 }
 
-static int qvm_load_variadic_functions(qvm_t *qvm)
+static int qvm_load_variadic_function(qvm_function_t *func)
 {
-    qvm_function_t  *func;
     qvm_opblock_t   *opb;
-    char            va_found;
-    unsigned int    va_func_count = 0;
-
-    printf("Loading variadic functions...");
-
-    // browse all functions
-    for (unsigned int i = 0; i < qvm->functions_count; i++) {
-        // get the current function
-        func = &qvm->functions[i];
-
-        // reset the boolean
-        va_found = 0;
-
-        // find all va_start calls
-        for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
-            if (opb->info->id == OPB_ASSIGNATION && opb->opcode->value == 4)
-                if ((opb->op2->info->id == OPB_LOCAL_ADR) || (opb->op2->info->id == OPB_GLOBAL_ADR))
-                    if (opb->op1->info->id == OPB_LOCAL_ADR && opb->op1->variable->status == VS_ARG) {
-                        opb->info = &qvm_opblocks_info[OPB_VA_START];
-                        opb->op2->variable->type = &qvm_types[T_VA_LIST];
-                        opb->op1->variable->variadic = 1;
-                        // TODO: propagate va_list variable
-                        va_found = 1;
-                    }
+    char            va_found = 0;
+
+    // find all va_start calls
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
+        if (opb->info->id == OPB_ASSIGNATION && opb->opcode->value == 4)
+            if ((opb->op2->info->id == OPB_LOCAL_ADR) || (opb->op2->info->id == OPB_GLOBAL_ADR))
+                if (opb->op1->info->id == OPB_LOCAL_ADR && opb->op1->variable->status == VS_ARG) {
+                    opb->info = &qvm_opblocks_info[OPB_VA_START];
+                    opb->op2->variable->type = &qvm_types[T_VA_LIST];
+                    opb->op1->variable->variadic = 1;
+                    // TODO: propagate va_list variable
+                    va_found = 1;
+                }
 
-        // if the function is not variadic go to the next one
-        if (!va_found)
-            continue;
+    // if the function is not variadic there is nothing else to do
+    if (!va_found)
+        return 0;
 
-        // set the funciton as variadic
-        func->variadic = 1;
+    // set the funciton as variadic
+    func->variadic = 1;
 
-        // count the variadic functions
-        va_func_count++;
+    // find all va_stop calls
+    for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
+        if (opb->info->id == OPB_ASSIGNATION && opb->opcode->value == 4)
+            if (opb->op2->info->id == OPB_LOCAL_ADR && opb->op2->variable->status == VS_LOCAL && opb->op2->variable->type->id == T_VA_LIST)
+                if (opb->op1->info->id == OPB_CONST && !opb->op1->opcode->value)
+                    opb->info = &qvm_opblocks_info[OPB_VA_END];
 
-        // find all va_stop calls
-        for (opb = func->opblock_start; opb && opb != func->opblock_end; opb = opb->next)
-            if (opb->info->id == OPB_ASSIGNATION && opb->opcode->value == 4)
-                if (opb->op2->info->id == OPB_LOCAL_ADR && opb->op2->variable->status == VS_LOCAL && opb->op2->variable->type->id == T_VA_LIST)
-                    if (opb->op1->info->id == OPB_CONST && !opb->op1->opcode->value)
-                        opb->info = &qvm_opblocks_info[OPB_VA_END];
-    }
+    // the function is variadic
+    return 1;
+}
 
-    printf("Success: %i variadic functions found.\n", va_func_count);
+static void qvm_load_args_function(qvm_function_t *func)
+{
+    qvm_variable_t  *var;
+    unsigned int    args_count = 0;
 
-    // success
-    return 1;
+    // the arguments count is the highest argument used by the function
+    for (var = func->locals; var; var = var->next)
+        if (var->status == VS_ARG && (var->address - func->stack_size - 8) / 4 + 1 > args_count)
+            args_count = (var->address - func->stack_size - 8) / 4 + 1;
+    func->args_count = args_count;
 }
@@ -11,11 +11,17 @@ typedef struct qvm_s                                        qvm_t;
 #include "opcodes.h"
 #include "opblocks.h"
 #include "functions.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "verify.h"
+#include "signatures.h"
 #include "jumppoints.h"
 #include "variables.h"
 #include "map.h"
+#include "syscalls.h"
 #include "strings.h"
 #include "sections.h"
+#include "cache.h"
 
 typedef struct __attribute__((__packed__)) qvm_header_s {
     int             magic;
@@ -36,24 +42,48 @@ typedef struct qvm_s {
     qvm_opcode_t    *opcodes;
     qvm_function_t  *functions;
     unsigned int    functions_count;
+    unsigned int    selected_count;
     qvm_function_t  *syscalls;
     unsigned int    syscalls_count;
+    qvm_syscalls_table_t *syscalls_table;
     qvm_jumppoint_t *jumppoints;
+    unsigned int    jumppoints_count;
+    qvm_jumppoint_t **jumppoints_index;
     qvm_opblock_t   *opblocks;
     qvm_variable_t  *globals;
     unsigned int    globals_count;
     unsigned int    locals_count;
-    qvm_map_t       *map;
-    unsigned int    map_count;
+    qvm_map_table_t map;
+    qvm_function_graph_t graph;
+    qvm_xref_index_t xrefs;
     int             calls_total;
     int             calls_restored;
     float           restored_calls_perc;
-    file_t          *output_file;
+    qvm_cache_t     *cache;
+    char            *cache_dirname;
+    char            stream;
+    char            fast;
 } qvm_t;
 
-qvm_t   *qvm_load(char *filename, char *map_filename);
+qvm_t   *qvm_load(char *filename, char *map_filename, opt_t *opt);
+int     qvm_load_function(qvm_t *qvm, qvm_function_t *func);
+void    qvm_unload_function(qvm_t *qvm, qvm_function_t *func);
 void    qvm_free(qvm_t *qvm);
+int     qvm_reload_map(qvm_t *qvm, char *map_filename, qvm_function_list_t **changed);
 int     qvm_disassemble(qvm_t *qvm, char *filename);
+void    qvm_disassemble_range(file_t *file, qvm_t *qvm, unsigned int start, unsigned int end);
 int     qvm_decompile(qvm_t *qvm, char *filename);
+void    qvm_decompile_function(file_t *file, qvm_function_t *func);
+int     qvm_decompile_split(qvm_t *qvm, char *dirname, unsigned int threads_count);
+int     qvm_json(qvm_t *qvm, char *filename);
+int     qvm_hot(qvm_t *qvm, char *filename);
+int     qvm_lint(qvm_t *qvm, char *filename);
+int     qvm_stack(qvm_t *qvm, char *filename);
+int     qvm_footprint(qvm_t *qvm, char *filename);
+int     qvm_signatures(qvm_t *qvm, char *filename);
+int     qvm_emit(qvm_t *qvm, opt_emit_t *emits, unsigned int emits_count, unsigned int threads_count);
+int     qvm_serve(opt_t *opt);
+int     qvm_modules(opt_t *opt);
+int     qvm_diff(opt_t *opt);
 
 #endif
@@ -12,17 +12,27 @@ int main(int argc, char **argv)
     if (!(opt = opt_parse(argc, argv)))
         return 1;
 
+    // serve the requests if needed
+    if (opt->serve_path)
+        return !qvm_serve(opt);
+
+    // diff an old and a new qvm if needed
+    if (opt->diff)
+        return !qvm_diff(opt);
+
+    // load and emit several qvms together if needed
+    if (opt->modules_count > 1)
+        return !qvm_modules(opt);
+
     // load the qvm
-    if (!(qvm = qvm_load(opt->qvm_filename, opt->map_filename)))
+    if (!(qvm = qvm_load(opt->qvm_filename, opt->map_filename, opt)))
         return 1;
 
-    // disassemble the qvm
-    if (opt->disassemble)
-        qvm_disassemble(qvm, opt->output_filename);
-
-    // decompile the qvm
-    if (!opt->disassemble)
-        qvm_decompile(qvm, opt->output_filename);
+    // emit all the outputs
+    if (!qvm_emit(qvm, opt->emits, opt->emits_count, opt->threads_count)) {
+        qvm_free(qvm);
+        return 1;
+    }
 
     // free the qvm
     qvm_free(qvm);
@@ -13,5 +13,7 @@
 #include "opcodes.h"
 #include "opblocks.h"
 #include "functions.h"
+#include "hash.h"
+#include "pool.h"
 
 #endif
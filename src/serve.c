@@ -0,0 +1,746 @@
+#include "qvmd.h"
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SERVE_MODULES_MAX   8
+#define SERVE_LINE_MAX      4096
+#define SERVE_ARGS_MAX      4
+
+typedef struct {
+    qvm_t           *qvm;
+    char            qvm_filename[PATH_MAX];
+    char            map_filename[PATH_MAX];
+    unsigned int    used;
+} qvm_serve_module_t;
+
+typedef struct {
+    opt_t               *opt;
+    qvm_serve_module_t  modules[SERVE_MODULES_MAX];
+    unsigned int        tick;
+    char                quit;
+} qvm_serve_t;
+
+int                         qvm_serve(opt_t *opt);
+static int                  qvm_serve_socket(qvm_serve_t *serve, char *path);
+static void                 qvm_serve_client(qvm_serve_t *serve, int in_fd, int out_fd);
+static int                  qvm_serve_request(qvm_serve_t *serve, int fd, char *line);
+static qvm_serve_module_t   *qvm_serve_find(qvm_serve_t *serve, char *qvm_filename);
+static qvm_serve_module_t   *qvm_serve_load(qvm_serve_t *serve, char *qvm_filename, char *map_filename);
+static int                  qvm_serve_reload_map(qvm_serve_module_t *module, int fd, char *map_filename);
+static void                 qvm_serve_unload(qvm_serve_module_t *module);
+static qvm_function_t       *qvm_serve_function(qvm_t *qvm, char *name);
+static int                  qvm_serve_reply(int fd, char *status, char *data, size_t size);
+static int                  qvm_serve_reply_file(int fd, file_t *file);
+static int                  qvm_serve_error(int fd, char *format, ...);
+static int                  qvm_serve_load_cmd(qvm_serve_t *serve, int fd, char **args, int args_count);
+static int                  qvm_serve_unload_cmd(qvm_serve_t *serve, int fd, char **args, int args_count);
+static int                  qvm_serve_list_cmd(qvm_serve_t *serve, int fd);
+static int                  qvm_serve_decompile_cmd(qvm_t *qvm, int fd, char *name);
+static int                  qvm_serve_disassemble_cmd(qvm_t *qvm, int fd, char *name);
+static int                  qvm_serve_xrefs_cmd(qvm_t *qvm, int fd, char *name);
+static int                  qvm_serve_cfg_cmd(qvm_t *qvm, int fd, char *name);
+static int                  qvm_serve_dataflow_cmd(qvm_t *qvm, int fd, char *name);
+static void                 qvm_serve_dataflow_block(file_t *file, qvm_dataflow_locals_t *locals, qvm_dataflow_t *reaching, qvm_dataflow_t *liveness, unsigned int block);
+static int                  qvm_serve_rename_cmd(qvm_t *qvm, int fd, char *name, char *new_name);
+
+int qvm_serve(opt_t *opt)
+{
+    qvm_serve_t serve;
+    int         out_fd;
+    int         ret = 1;
+
+    // initialize the server
+    memset(&serve, 0, sizeof(serve));
+    serve.opt = opt;
+
+    // a closed client must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // preload the qvms given on the command line if any
+    for (unsigned int i = 0; i < opt->modules_count; i++)
+        if (!qvm_serve_load(&serve, opt->modules[i].qvm_filename, opt->modules[i].map_filename))
+            return 0;
+
+    // serve on the standard input and output
+    if (!strcmp(opt->serve_path, "-")) {
+        // keep the standard output for the replies and send the logs to the error output
+        if ((out_fd = dup(1)) == -1 || dup2(2, 1) == -1) {
+            printf("Error: Couldn't redirect the standard output.\n");
+            ret = 0;
+        }
+        else {
+            qvm_serve_client(&serve, 0, out_fd);
+            close(out_fd);
+        }
+    }
+
+    // serve on a unix socket
+    else
+        ret = qvm_serve_socket(&serve, opt->serve_path);
+
+    // free all the loaded modules
+    for (unsigned int i = 0; i < SERVE_MODULES_MAX; i++)
+        qvm_serve_unload(&serve.modules[i]);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_socket(qvm_serve_t *serve, char *path)
+{
+    struct sockaddr_un  addr;
+    int                 sock;
+    int                 client;
+
+    // check the socket path size
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Error: Socket path %s is too long.\n", path);
+        return 0;
+    }
+
+    // create the socket
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        printf("Error: Couldn't create the socket.\n");
+        return 0;
+    }
+
+    // bind the socket on its path
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(sock, 8) == -1) {
+        printf("Error: Couldn't listen on %s.\n", path);
+        close(sock);
+        return 0;
+    }
+    printf("Serving on %s...\n", path);
+
+    // serve the clients one after the other
+    while (!serve->quit) {
+        if ((client = accept(sock, NULL, NULL)) == -1)
+            continue;
+        qvm_serve_client(serve, client, client);
+        close(client);
+    }
+
+    // close and remove the socket
+    close(sock);
+    unlink(path);
+
+    // success
+    return 1;
+}
+
+static void qvm_serve_client(qvm_serve_t *serve, int in_fd, int out_fd)
+{
+    char    line[SERVE_LINE_MAX];
+    size_t  length = 0;
+    ssize_t size;
+    char    *end;
+    char    skip = 0;
+
+    // read the requests until the end of the input
+    while (!serve->quit && (size = read(in_fd, line + length, sizeof(line) - length - 1)) > 0) {
+        length += size;
+        line[length] = 0;
+
+        // handle all the complete requests
+        while (!serve->quit && (end = strchr(line, '\n'))) {
+            *end = 0;
+            if (end > line && end[-1] == '\r')
+                end[-1] = 0;
+            if (!skip)
+                qvm_serve_request(serve, out_fd, line);
+            skip = 0;
+            length -= end + 1 - line;
+            memmove(line, end + 1, length + 1);
+        }
+
+        // drop a request too long for the buffer
+        if (length == sizeof(line) - 1) {
+            if (!skip)
+                qvm_serve_error(out_fd, "request too long");
+            skip = 1;
+            length = 0;
+        }
+    }
+}
+
+static int qvm_serve_request(qvm_serve_t *serve, int fd, char *line)
+{
+    char                *args[SERVE_ARGS_MAX];
+    int                 args_count = 0;
+    char                *cmd;
+    char                *save;
+    qvm_serve_module_t  *module;
+
+    // split the request in words
+    if (!(cmd = strtok_r(line, " \t", &save)))
+        return 1;
+    while (args_count < SERVE_ARGS_MAX && (args[args_count] = strtok_r(NULL, " \t", &save)))
+        args_count++;
+
+    // handle the commands without module
+    if (!strcmp(cmd, "quit")) {
+        serve->quit = 1;
+        return qvm_serve_reply(fd, "ok", NULL, 0);
+    }
+    if (!strcmp(cmd, "list"))
+        return qvm_serve_list_cmd(serve, fd);
+    if (!strcmp(cmd, "load"))
+        return qvm_serve_load_cmd(serve, fd, args, args_count);
+    if (!strcmp(cmd, "unload"))
+        return qvm_serve_unload_cmd(serve, fd, args, args_count);
+
+    // check the module commands arguments
+    if ((!strcmp(cmd, "decompile") || !strcmp(cmd, "disassemble") || !strcmp(cmd, "xrefs") || !strcmp(cmd, "cfg") || !strcmp(cmd, "dataflow")) && args_count != 2)
+        return qvm_serve_error(fd, "usage: %s <qvm> <symbol>", cmd);
+    else if (!strcmp(cmd, "rename") && args_count != 3)
+        return qvm_serve_error(fd, "usage: rename <qvm> <old> <new>");
+    else if (strcmp(cmd, "decompile") && strcmp(cmd, "disassemble") && strcmp(cmd, "xrefs") && strcmp(cmd, "cfg") && strcmp(cmd, "dataflow") && strcmp(cmd, "rename"))
+        return qvm_serve_error(fd, "unknown command %s", cmd);
+
+    // get the module, load it without map if needed
+    if (!(module = qvm_serve_find(serve, args[0])) && !(module = qvm_serve_load(serve, args[0], NULL)))
+        return qvm_serve_error(fd, "couldn't load %s", args[0]);
+    module->used = ++serve->tick;
+
+    // run the module command
+    if (!strcmp(cmd, "decompile"))
+        return qvm_serve_decompile_cmd(module->qvm, fd, args[1]);
+    if (!strcmp(cmd, "disassemble"))
+        return qvm_serve_disassemble_cmd(module->qvm, fd, args[1]);
+    if (!strcmp(cmd, "xrefs"))
+        return qvm_serve_xrefs_cmd(module->qvm, fd, args[1]);
+    if (!strcmp(cmd, "cfg"))
+        return qvm_serve_cfg_cmd(module->qvm, fd, args[1]);
+    if (!strcmp(cmd, "dataflow"))
+        return qvm_serve_dataflow_cmd(module->qvm, fd, args[1]);
+    return qvm_serve_rename_cmd(module->qvm, fd, args[1], args[2]);
+}
+
+static qvm_serve_module_t *qvm_serve_find(qvm_serve_t *serve, char *qvm_filename)
+{
+    // search the loaded module
+    for (unsigned int i = 0; i < SERVE_MODULES_MAX; i++)
+        if (serve->modules[i].qvm && !strcmp(serve->modules[i].qvm_filename, qvm_filename))
+            return &serve->modules[i];
+
+    // we didn't find it
+    return NULL;
+}
+
+static qvm_serve_module_t *qvm_serve_load(qvm_serve_t *serve, char *qvm_filename, char *map_filename)
+{
+    qvm_serve_module_t  *module;
+    opt_t               opt;
+
+    // check the filenames size
+    if (strlen(qvm_filename) >= PATH_MAX || (map_filename && strlen(map_filename) >= PATH_MAX))
+        return NULL;
+
+    // reuse the module slot or take the least recently used one
+    if (!(module = qvm_serve_find(serve, qvm_filename))) {
+        module = &serve->modules[0];
+        for (unsigned int i = 1; i < SERVE_MODULES_MAX && module->qvm; i++)
+            if (!serve->modules[i].qvm || serve->modules[i].used < module->used)
+                module = &serve->modules[i];
+    }
+    qvm_serve_unload(module);
+
+    // save the filenames, the qvm keeps a pointer on them
+    strcpy(module->qvm_filename, qvm_filename);
+    strcpy(module->map_filename, map_filename ? map_filename : "");
+
+    // load the whole qvm analysis
+    opt = *serve->opt;
+    opt.selects_count = 0;
+    opt.stream = 0;
+    if (!(module->qvm = qvm_load(module->qvm_filename, map_filename ? module->map_filename : NULL, &opt)))
+        return NULL;
+    module->used = ++serve->tick;
+
+    // return the module
+    return module;
+}
+
+static void qvm_serve_unload(qvm_serve_module_t *module)
+{
+    // free the module qvm if needed
+    if (module->qvm)
+        qvm_free(module->qvm);
+    module->qvm = NULL;
+}
+
+static qvm_function_t *qvm_serve_function(qvm_t *qvm, char *name)
+{
+    unsigned int    address;
+    char            *end;
+    qvm_function_t  *func;
+
+    // find the function by name
+    if ((func = func_find_name(qvm, name)) && func < qvm->functions + qvm->functions_count)
+        return func;
+
+    // find the function containing the address
+    address = strtoul(name, &end, 0);
+    if (end == name || *end)
+        return NULL;
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        if (address >= qvm->functions[i].address && address < qvm->functions[i].address + qvm->functions[i].op_size)
+            return &qvm->functions[i];
+
+    // we didn't find it
+    return NULL;
+}
+
+static int qvm_serve_reply(int fd, char *status, char *data, size_t size)
+{
+    char    header[64];
+    int     length;
+
+    // write the reply header and data
+    length = snprintf(header, sizeof(header), "%s %zu\n", status, size);
+    if (write(fd, header, length) != length)
+        return 0;
+    while (size) {
+        if ((length = write(fd, data, size)) <= 0)
+            return 0;
+        data += length;
+        size -= length;
+    }
+
+    // success
+    return 1;
+}
+
+static int qvm_serve_reply_file(int fd, file_t *file)
+{
+    off_t   size;
+    char    *data;
+    int     ret;
+
+    // get the file content size
+    file_flush(file);
+    if ((size = lseek(file->fd, 0, SEEK_CUR)) == (off_t)-1)
+        return qvm_serve_error(fd, "couldn't read the reply");
+
+    // read the file content
+    if (!(data = malloc(size + 1))) {
+        printf("Error: Couldn't allocate reply.\n");
+        return qvm_serve_error(fd, "couldn't allocate the reply");
+    }
+    if (pread(file->fd, data, size, 0) != size) {
+        free(data);
+        return qvm_serve_error(fd, "couldn't read the reply");
+    }
+
+    // send the file content
+    ret = qvm_serve_reply(fd, "ok", data, size);
+    free(data);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_error(int fd, char *format, ...)
+{
+    va_list arg_list;
+    char    message[1024];
+    int     length;
+
+    // format the error message
+    va_start(arg_list, format);
+    length = vsnprintf(message, sizeof(message), format, arg_list);
+    va_end(arg_list);
+    if (length < 0)
+        length = 0;
+    else if ((size_t)length >= sizeof(message))
+        length = sizeof(message) - 1;
+
+    // send the error
+    qvm_serve_reply(fd, "error", message, length);
+
+    // the request failed
+    return 0;
+}
+
+static int qvm_serve_load_cmd(qvm_serve_t *serve, int fd, char **args, int args_count)
+{
+    qvm_serve_module_t  *module;
+    char                *map_filename;
+
+    // check the arguments
+    if (args_count < 1 || args_count > 2)
+        return qvm_serve_error(fd, "usage: load <qvm> [map]");
+    map_filename = args_count == 2 ? args[1] : NULL;
+
+    // apply the new map on the loaded analysis if possible
+    if ((module = qvm_serve_find(serve, args[0])) && !module->qvm->cache) {
+        module->used = ++serve->tick;
+        return qvm_serve_reload_map(module, fd, map_filename);
+    }
+
+    // load the module again with its map
+    if (!(module = qvm_serve_load(serve, args[0], map_filename)))
+        return qvm_serve_error(fd, "couldn't load %s", args[0]);
+
+    // success
+    return qvm_serve_reply(fd, "ok", NULL, 0);
+}
+
+static int qvm_serve_reload_map(qvm_serve_module_t *module, int fd, char *map_filename)
+{
+    qvm_function_list_t *changed = NULL;
+    qvm_function_list_t *list;
+    file_t              *file;
+    int                 ret;
+
+    // check the map filename size
+    if (map_filename && strlen(map_filename) >= PATH_MAX)
+        return qvm_serve_error(fd, "couldn't read map file %s", map_filename);
+
+    // apply the map differences
+    if (!qvm_reload_map(module->qvm, map_filename, &changed)) {
+        func_list_free(changed);
+        return qvm_serve_error(fd, "couldn't read map file %s", map_filename);
+    }
+    strcpy(module->map_filename, map_filename ? map_filename : "");
+
+    // create the reply file
+    if (!(file = file_create_tmp())) {
+        func_list_free(changed);
+        return qvm_serve_error(fd, "couldn't create the reply");
+    }
+
+    // print the functions to emit again
+    for (list = changed; list; list = list->next)
+        file_print(file, "%s\n", list->function->name);
+    func_list_free(changed);
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_unload_cmd(qvm_serve_t *serve, int fd, char **args, int args_count)
+{
+    qvm_serve_module_t  *module;
+
+    // check the arguments
+    if (args_count != 1)
+        return qvm_serve_error(fd, "usage: unload <qvm>");
+
+    // free the module
+    if (!(module = qvm_serve_find(serve, args[0])))
+        return qvm_serve_error(fd, "%s isn't loaded", args[0]);
+    qvm_serve_unload(module);
+
+    // success
+    return qvm_serve_reply(fd, "ok", NULL, 0);
+}
+
+static int qvm_serve_list_cmd(qvm_serve_t *serve, int fd)
+{
+    file_t              *file;
+    int                 ret;
+    qvm_serve_module_t  *module;
+
+    // create the reply file
+    if (!(file = file_create_tmp()))
+        return qvm_serve_error(fd, "couldn't create the reply");
+
+    // print one line per loaded module
+    for (unsigned int i = 0; i < SERVE_MODULES_MAX; i++) {
+        module = &serve->modules[i];
+        if (module->qvm)
+            file_print(file, "%s\t%s\t%u\n", module->qvm_filename, module->map_filename, module->qvm->functions_count);
+    }
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_decompile_cmd(qvm_t *qvm, int fd, char *name)
+{
+    qvm_function_t  *func;
+    file_t          *file;
+    int             ret;
+
+    // find the function
+    if (!(func = qvm_serve_function(qvm, name)))
+        return qvm_serve_error(fd, "unknown function %s", name);
+
+    // create the reply file
+    if (!(file = file_create_tmp()))
+        return qvm_serve_error(fd, "couldn't create the reply");
+
+    // decompile the function
+    qvm_decompile_function(file, func);
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_disassemble_cmd(qvm_t *qvm, int fd, char *name)
+{
+    qvm_function_t  *func;
+    unsigned int    start;
+    unsigned int    end;
+    char            *cursor;
+    file_t          *file;
+    int             ret;
+
+    // parse the address range
+    start = strtoul(name, &cursor, 0);
+    if (cursor != name && *cursor == '-') {
+        end = strtoul(cursor + 1, &cursor, 0);
+        if (*cursor || end < start)
+            return qvm_serve_error(fd, "invalid range %s", name);
+    }
+
+    // or get the function range
+    else if ((func = qvm_serve_function(qvm, name))) {
+        start = func->address;
+        end = func->address + func->op_size;
+    }
+    else
+        return qvm_serve_error(fd, "unknown function %s", name);
+
+    // create the reply file
+    if (!(file = file_create_tmp()))
+        return qvm_serve_error(fd, "couldn't create the reply");
+
+    // disassemble the range
+    qvm_disassemble_range(file, qvm, start, end);
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_xrefs_cmd(qvm_t *qvm, int fd, char *name)
+{
+    qvm_function_t  *func;
+    qvm_variable_t  *var = NULL;
+    qvm_xref_array_t *xrefs;
+    file_t          *file;
+    int             ret;
+
+    // find the function or the global variable
+    if (!(func = func_find_name(qvm, name)) && !(var = var_find_name(qvm->globals, name)))
+        return qvm_serve_error(fd, "unknown symbol %s", name);
+
+    // create the reply file
+    if (!(file = file_create_tmp()))
+        return qvm_serve_error(fd, "couldn't create the reply");
+
+    // print the function calls and callers
+    if (func) {
+        for (unsigned int i = 0; i < func->calls.count; i++)
+            file_print(file, "calls\t%s\n", func->calls.functions[i]->name);
+        for (unsigned int i = 0; i < func->called_by.count; i++)
+            file_print(file, "called_by\t%s\n", func->called_by.functions[i]->name);
+    }
+
+    // print the functions using the variable
+    else {
+        for (unsigned int i = 0; i < var->parents.count; i++)
+            file_print(file, "used_by\t%s\n", var->parents.functions[i]->name);
+    }
+
+    // print the instructions reading, writing, taking the address or calling the symbol
+    xrefs = func ? &func->xrefs : &var->xrefs;
+    for (unsigned int i = 0; i < xrefs->count; i++)
+        file_print(file, "%s\t0x%x\t%s\n", qvm_xrefs_names[xrefs->xrefs[i].kind], xrefs->xrefs[i].address,
+            xrefs->xrefs[i].function ? xrefs->xrefs[i].function->name : "");
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_cfg_cmd(qvm_t *qvm, int fd, char *name)
+{
+    qvm_function_t  *func;
+    qvm_cfg_t       cfg;
+    qvm_cfg_block_t *block;
+    file_t          *file;
+    int             ret;
+
+    // find the function
+    if (!(func = qvm_serve_function(qvm, name)))
+        return qvm_serve_error(fd, "unknown function %s", name);
+
+    // build the function control flow graph
+    if (!cfg_load(&cfg, func))
+        return qvm_serve_error(fd, "couldn't build the control flow graph of %s", name);
+
+    // create the reply file
+    if (!(file = file_create_tmp())) {
+        cfg_free(&cfg);
+        return qvm_serve_error(fd, "couldn't create the reply");
+    }
+
+    // print one line per block with its opcodes range, its successors and its predecessors
+    for (unsigned int i = 0; i < cfg.blocks_count; i++) {
+        block = &cfg.blocks[i];
+        file_print(file, "block\t%u\t0x%x\t0x%x\tsuccs=", i, block->start, block->end);
+        for (unsigned int j = 0; j < block->succs_count; j++)
+            file_print(file, j ? ",%u" : "%u", cfg.succs[block->succs_start + j]);
+        file_print(file, "\tpreds=");
+        for (unsigned int j = 0; j < block->preds_count; j++)
+            file_print(file, j ? ",%u" : "%u", cfg.preds[block->preds_start + j]);
+        file_print(file, "%s%s\n", block->exit ? "\texit" : "", block->indirect ? "\tindirect" : "");
+    }
+
+    // send the reply
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+    cfg_free(&cfg);
+
+    // return the status
+    return ret;
+}
+
+static int qvm_serve_dataflow_cmd(qvm_t *qvm, int fd, char *name)
+{
+    qvm_function_t          *func;
+    qvm_cfg_t               cfg;
+    qvm_dataflow_locals_t   locals;
+    qvm_dataflow_t          reaching;
+    qvm_dataflow_t          liveness;
+    file_t                  *file = NULL;
+    int                     ret;
+
+    // find the function
+    if (!(func = qvm_serve_function(qvm, name)))
+        return qvm_serve_error(fd, "unknown function %s", name);
+
+    // build the function graph, its locals and solve their reaching definitions and liveness
+    if (!cfg_load(&cfg, func))
+        return qvm_serve_error(fd, "couldn't build the control flow graph of %s", name);
+    if (!cfg_load_dominators(&cfg) || !dataflow_locals_load(&locals, &cfg)) {
+        cfg_free(&cfg);
+        return qvm_serve_error(fd, "couldn't load the locals of %s", name);
+    }
+    if (!dataflow_reaching(&reaching, &locals)) {
+        dataflow_locals_free(&locals);
+        cfg_free(&cfg);
+        return qvm_serve_error(fd, "couldn't solve the data flow of %s", name);
+    }
+    if (!dataflow_liveness(&liveness, &locals)) {
+        dataflow_free(&reaching);
+        dataflow_locals_free(&locals);
+        cfg_free(&cfg);
+        return qvm_serve_error(fd, "couldn't solve the data flow of %s", name);
+    }
+
+    // print one line per block with its live locals and its reaching definitions
+    if ((file = file_create_tmp())) {
+        for (unsigned int i = 0; i < cfg.blocks_count; i++)
+            qvm_serve_dataflow_block(file, &locals, &reaching, &liveness, i);
+        file_print(file, "solved\t%u\t%u\n", reaching.iterations, liveness.iterations);
+    }
+
+    // free the data flow
+    dataflow_free(&reaching);
+    dataflow_free(&liveness);
+    dataflow_locals_free(&locals);
+    cfg_free(&cfg);
+
+    // send the reply
+    if (!file)
+        return qvm_serve_error(fd, "couldn't create the reply");
+    ret = qvm_serve_reply_file(fd, file);
+    file_free(file);
+
+    // return the status
+    return ret;
+}
+
+static void qvm_serve_dataflow_block(file_t *file, qvm_dataflow_locals_t *locals, qvm_dataflow_t *reaching, qvm_dataflow_t *liveness, unsigned int block)
+{
+    qvm_bitset_t    *set;
+    char            first;
+
+    // print the block range
+    file_print(file, "block\t%u\t0x%x\t0x%x", block, locals->cfg->blocks[block].start, locals->cfg->blocks[block].end);
+
+    // print the locals live at the block start and end
+    set = dataflow_set(liveness, liveness->in, block);
+    file_print(file, "\tlive_in=");
+    first = 1;
+    for (unsigned int i = 0; i < locals->locals_count; i++)
+        if (dataflow_has(set, i)) {
+            file_print(file, first ? "%s" : ",%s", locals->locals[i]->name);
+            first = 0;
+        }
+    set = dataflow_set(liveness, liveness->out, block);
+    file_print(file, "\tlive_out=");
+    first = 1;
+    for (unsigned int i = 0; i < locals->locals_count; i++)
+        if (dataflow_has(set, i)) {
+            file_print(file, first ? "%s" : ",%s", locals->locals[i]->name);
+            first = 0;
+        }
+
+    // print the definitions reaching the block start
+    set = dataflow_set(reaching, reaching->in, block);
+    file_print(file, "\treaching=");
+    first = 1;
+    for (unsigned int i = 0; i < locals->defs_count; i++)
+        if (dataflow_has(set, i)) {
+            file_print(file, first ? "%s@0x%x" : ",%s@0x%x", locals->locals[locals->defs_locals[i]]->name, locals->defs[i]->opcode->address);
+            first = 0;
+        }
+    file_print(file, "\n");
+}
+
+static int qvm_serve_rename_cmd(qvm_t *qvm, int fd, char *name, char *new_name)
+{
+    qvm_function_t  *func;
+    qvm_variable_t  *var;
+
+    // check the new name is free
+    if (func_find_name(qvm, new_name) || var_find_name(qvm->globals, new_name))
+        return qvm_serve_error(fd, "%s already exists", new_name);
+
+    // rename the function
+    if ((func = func_find_name(qvm, name))) {
+        func_rename(func, new_name);
+        if (strcmp(func->name, new_name))
+            return qvm_serve_error(fd, "couldn't rename %s", name);
+    }
+
+    // or rename the global variable
+    else if ((var = var_find_name(qvm->globals, name))) {
+        var_rename(var, new_name);
+        if (strcmp(var->name, new_name))
+            return qvm_serve_error(fd, "couldn't rename %s", name);
+    }
+    else
+        return qvm_serve_error(fd, "unknown symbol %s", name);
+
+    // success
+    return qvm_serve_reply(fd, "ok", NULL, 0);
+}
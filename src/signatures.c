@@ -0,0 +1,292 @@
+#include "qvmd.h"
+
+/*
+    The signatures database names the functions of a qvm without map from
+    the qvms that had one. A function signature is its fingerprint, which
+    hashes its opcodes with the jumps relative to it and without the calls
+    and globals addresses, with the shape of its control flow graph. The
+    database file is an open addressing hash table of fixed size records,
+    kept half empty, so it is mapped and searched in place. A signature
+    found with two names is kept as ambiguous and names nothing, and a
+    signature matching several functions of the qvm names none of them.
+*/
+
+typedef struct {
+    unsigned int        magic;
+    unsigned int        version;
+    unsigned int        count;
+    unsigned int        size;
+} sig_header_t;
+
+typedef struct {
+    unsigned long long  fingerprint;
+    unsigned long long  shape;
+    unsigned int        op_size;
+    unsigned int        flags;
+    char                name[64];
+} sig_entry_t;
+
+typedef struct {
+    unsigned int        slot;
+    qvm_function_t      *function;
+} sig_match_t;
+
+int                 sig_apply(qvm_t *qvm, char *filename);
+int                 qvm_signatures(qvm_t *qvm, char *filename);
+static file_t       *sig_open(char *filename);
+static int          sig_key(qvm_function_t *func, sig_entry_t *key);
+static unsigned int sig_probe(sig_header_t *header, sig_entry_t *entries, sig_entry_t *key);
+static int          sig_insert(sig_header_t *header, sig_entry_t *entries, sig_entry_t *entry);
+static int          sig_compare_matches(const void *a, const void *b);
+
+int sig_apply(qvm_t *qvm, char *filename)
+{
+    file_t          *file;
+    sig_header_t    *header;
+    sig_entry_t     *entries;
+    sig_entry_t     key;
+    sig_match_t     *matches;
+    qvm_function_t  *func;
+    unsigned int    matches_count = 0;
+    unsigned int    named = 0;
+    unsigned int    count;
+    unsigned int    slot;
+
+    printf("Loading signatures...");
+
+    // map the signatures database
+    if (!(file = sig_open(filename))) {
+        printf("Error: Invalid signatures file %s.\n", filename);
+        return 0;
+    }
+    header = (sig_header_t *)file->content;
+    entries = (sig_entry_t *)(header + 1);
+
+    // allocate the matches
+    if (!(matches = malloc(sizeof(*matches) * (qvm->functions_count + 1)))) {
+        printf("Error: Couldn't allocate signatures matches.\n");
+        file_free(file);
+        return 0;
+    }
+
+    // find the signature of the functions without a name, vmMain is always the first one
+    for (unsigned int i = 1; i < qvm->functions_count; i++) {
+        func = &qvm->functions[i];
+        if (func->op_size < SIG_FUNCTION_MIN || !func_is_default(func))
+            continue;
+        if (!sig_key(func, &key)) {
+            free(matches);
+            file_free(file);
+            return 0;
+        }
+
+        // keep the signatures with only one name
+        if ((slot = sig_probe(header, entries, &key)) == SIG_NONE || entries[slot].flags != SIG_F_USED ||
+            !memchr(entries[slot].name, 0, sizeof(entries[slot].name)))
+            continue;
+        matches[matches_count].slot = slot;
+        matches[matches_count].function = func;
+        matches_count++;
+    }
+
+    // group the functions matching the same signature
+    qsort(matches, matches_count, sizeof(*matches), sig_compare_matches);
+
+    // name the functions alone to match their signature, if the name isn't already taken
+    for (unsigned int i = 0; i < matches_count; i += count) {
+        for (count = 1; i + count < matches_count && matches[i + count].slot == matches[i].slot; count++);
+        if (count > 1 || func_find_name(qvm, entries[matches[i].slot].name))
+            continue;
+        func_rename(matches[i].function, entries[matches[i].slot].name);
+        named++;
+    }
+
+    // free the matches and the database
+    free(matches);
+    printf("Success: %u functions named from %u signatures.\n", named, header->count);
+    file_free(file);
+
+    // success
+    return 1;
+}
+
+int qvm_signatures(qvm_t *qvm, char *filename)
+{
+    char            tmp_filename[PATH_MAX + 16];
+    file_t          *file = NULL;
+    sig_header_t    *old_header = NULL;
+    sig_entry_t     *old_entries = NULL;
+    sig_header_t    header;
+    sig_entry_t     *entries;
+    sig_entry_t     entry;
+    qvm_function_t  *func;
+    unsigned int    added = 0;
+    int             success;
+
+    // map the existing database if any, the functions are added to it
+    if (access(filename, F_OK) != -1) {
+        if (!(file = sig_open(filename))) {
+            printf("Saving signatures to %s...Error: Invalid signatures file.\n", filename);
+            return 0;
+        }
+        old_header = (sig_header_t *)file->content;
+        old_entries = (sig_entry_t *)(old_header + 1);
+    }
+
+    // size the hash table to keep it half empty
+    header.magic = SIG_MAGIC;
+    header.version = SIG_VERSION;
+    header.count = 0;
+    header.size = 16;
+    while (header.size < ((old_header ? old_header->count : 0) + qvm->functions_count) * 2)
+        header.size <<= 1;
+
+    // allocate the hash table
+    if (!(entries = calloc(header.size, sizeof(*entries)))) {
+        printf("Saving signatures to %s...Error: Couldn't allocate signatures.\n", filename);
+        if (file)
+            file_free(file);
+        return 0;
+    }
+
+    // insert the existing signatures
+    for (unsigned int i = 0; old_header && i < old_header->size; i++)
+        if (old_entries[i].flags & SIG_F_USED)
+            sig_insert(&header, entries, &old_entries[i]);
+    if (file)
+        file_free(file);
+
+    // add the signatures of the named functions
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        func = &qvm->functions[i];
+        if (func->op_size < SIG_FUNCTION_MIN || func_is_default(func))
+            continue;
+        if (!sig_key(func, &entry)) {
+            free(entries);
+            return 0;
+        }
+        entry.flags = SIG_F_USED;
+        snprintf(entry.name, sizeof(entry.name), "%s", func->name);
+        added += sig_insert(&header, entries, &entry);
+    }
+
+    // create a temporary file
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%i", filename, (int)getpid());
+    if (!(file = file_create(tmp_filename))) {
+        printf("Saving signatures to %s...Error: Couldn't create file.\n", filename);
+        free(entries);
+        return 0;
+    }
+
+    // write the header and the hash table
+    success = file_write(file, &header, sizeof(header)) && file_write(file, entries, sizeof(*entries) * header.size);
+    success = file_flush(file) && success;
+    file_free(file);
+    free(entries);
+
+    // replace the database atomically
+    if (!success || rename(tmp_filename, filename) == -1) {
+        printf("Saving signatures to %s...Error: Couldn't write file.\n", filename);
+        unlink(tmp_filename);
+        return 0;
+    }
+
+    printf("Saving signatures to %s...Success: %u functions added, %u signatures in total.\n", filename, added, header.count);
+
+    // success
+    return 1;
+}
+
+static file_t *sig_open(char *filename)
+{
+    file_t          *file;
+    sig_header_t    *header;
+
+    // map the database file
+    if (!(file = file_map(filename)))
+        return NULL;
+
+    // check the header, the hash table size is a power of two with a free slot at least
+    header = (sig_header_t *)file->content;
+    if (file->size < sizeof(*header) ||
+        header->magic != SIG_MAGIC ||
+        header->version != SIG_VERSION ||
+        !header->size || (header->size & (header->size - 1)) ||
+        header->count >= header->size ||
+        file->size != sizeof(*header) + (size_t)header->size * sizeof(sig_entry_t)) {
+        file_free(file);
+        return NULL;
+    }
+
+    // return the mapped database
+    return file;
+}
+
+static int sig_key(qvm_function_t *func, sig_entry_t *key)
+{
+    qvm_cfg_t   cfg;
+
+    // hash the function opcodes
+    memset(key, 0, sizeof(*key));
+    key->fingerprint = func_fingerprint(func);
+    key->op_size = func->op_size;
+
+    // hash the control flow graph shape
+    if (!cfg_load(&cfg, func))
+        return 0;
+    key->shape = cfg_shape(&cfg);
+    cfg_free(&cfg);
+
+    // success
+    return 1;
+}
+
+static unsigned int sig_probe(sig_header_t *header, sig_entry_t *entries, sig_entry_t *key)
+{
+    unsigned int    mask = header->size - 1;
+    unsigned int    slot = (unsigned int)(key->fingerprint ^ key->shape) & mask;
+
+    // find the slot of the signature or the free slot where it goes
+    for (unsigned int i = 0; i < header->size; i++, slot = (slot + 1) & mask) {
+        if (!(entries[slot].flags & SIG_F_USED))
+            return slot;
+        if (entries[slot].fingerprint == key->fingerprint && entries[slot].shape == key->shape && entries[slot].op_size == key->op_size)
+            return slot;
+    }
+
+    // the hash table is full
+    return SIG_NONE;
+}
+
+static int sig_insert(sig_header_t *header, sig_entry_t *entries, sig_entry_t *entry)
+{
+    unsigned int    slot;
+
+    // the hash table is sized to never be full
+    if ((slot = sig_probe(header, entries, entry)) == SIG_NONE)
+        return 0;
+
+    // add the new signature
+    if (!(entries[slot].flags & SIG_F_USED)) {
+        entries[slot] = *entry;
+        entries[slot].name[sizeof(entries[slot].name) - 1] = 0;
+        header->count++;
+        return 1;
+    }
+
+    // a signature with another name is ambiguous
+    if (strncmp(entries[slot].name, entry->name, sizeof(entry->name)) || (entry->flags & SIG_F_AMBIGUOUS))
+        entries[slot].flags |= SIG_F_AMBIGUOUS;
+    return 0;
+}
+
+static int sig_compare_matches(const void *a, const void *b)
+{
+    const sig_match_t   *ma = a;
+    const sig_match_t   *mb = b;
+
+    // compare the slots, then the addresses
+    if (ma->slot != mb->slot)
+        return ma->slot < mb->slot ? -1 : 1;
+    return ma->function->address < mb->function->address ? -1 : ma->function->address > mb->function->address;
+}
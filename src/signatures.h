@@ -0,0 +1,16 @@
+#ifndef SIGNATURES_H
+#define SIGNATURES_H
+
+#define SIG_MAGIC           0x534d5651
+#define SIG_VERSION         3
+#define SIG_NONE            (unsigned int)-1
+#define SIG_FUNCTION_MIN    8
+
+typedef enum {
+    SIG_F_USED = 1,
+    SIG_F_AMBIGUOUS = 2
+} qvm_signature_f;
+
+int     sig_apply(qvm_t *qvm, char *filename);
+
+#endif
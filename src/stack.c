@@ -0,0 +1,311 @@
+#include "qvmd.h"
+
+#define STACK_NONE          (unsigned int)-1
+#define STACK_ENGINE_SIZE   0x10000
+#define STACK_CHAINS_COUNT  16
+
+/*
+    The stack usage report gives the worst program stack depth reached from
+    each entry point, summing the frames of the heaviest direct call chain.
+    The calls graph components are done from the callees to the callers, so
+    a function only needs the depth of its callees. A recursion cycle is
+    counted once with all its frames and reported, since its real depth
+    depends on the data. The entry points are vmMain and the functions with
+    no direct caller, which are the possible targets of the indirect calls.
+    The indirect calls are one more node of the graph calling all of them,
+    so a chain goes on through its deepest target and the recursions
+    through function pointers are found like the direct ones. The depth is
+    compared to the program stack of the engine, and a recursive worst
+    chain has no bound.
+*/
+
+typedef struct {
+    unsigned int    depth;
+    unsigned int    next;
+    unsigned int    component;
+    unsigned int    cycle;
+    char            recursive;
+    char            indirect;
+} qvm_stack_function_t;
+
+typedef struct {
+    unsigned int            id;
+    unsigned int            total;
+} qvm_stack_entry_t;
+
+typedef struct {
+    qvm_t                   *qvm;
+    qvm_stack_function_t    *functions;
+    char                    *indirect;
+    qvm_stack_entry_t       *entries;
+    unsigned int            entries_count;
+    unsigned int            cycles_count;
+    unsigned int            indirect_depth;
+} qvm_stack_t;
+
+int                 qvm_stack(qvm_t *qvm, char *filename);
+static void         qvm_stack_component(qvm_stack_t *stack, qvm_function_sccs_t *sccs, unsigned int scc);
+static int          qvm_stack_cycle(qvm_stack_t *stack, qvm_function_sccs_t *sccs, unsigned int scc);
+static int          qvm_stack_indirect(qvm_function_t *func);
+static unsigned int qvm_stack_frame(qvm_stack_t *stack, unsigned int id);
+static char         *qvm_stack_name(qvm_stack_t *stack, unsigned int id);
+static void         qvm_stack_chain(file_t *file, qvm_stack_t *stack, qvm_stack_entry_t *entry);
+static void         qvm_stack_cycles(file_t *file, qvm_stack_t *stack, qvm_function_sccs_t *sccs);
+static int          qvm_stack_compare(const void *a, const void *b);
+
+int qvm_stack(qvm_t *qvm, char *filename)
+{
+    qvm_stack_t             stack;
+    qvm_stack_entry_t       *entry;
+    qvm_function_sccs_t     sccs;
+    file_t                  *file;
+    unsigned int            worst = 0;
+    char                    *status;
+
+    // allocate the functions depth, the indirect calls node included, and the entry points
+    memset(&stack, 0, sizeof(stack));
+    stack.qvm = qvm;
+    if (!(stack.functions = calloc(qvm->functions_count + 2, sizeof(*stack.functions))) ||
+        !(stack.indirect = calloc(qvm->functions_count + 1, sizeof(*stack.indirect))) ||
+        !(stack.entries = malloc(sizeof(*stack.entries) * (qvm->functions_count + 1)))) {
+        printf("Reporting stack usage to %s...Error: Couldn't allocate functions depth.\n", filename);
+        free(stack.functions);
+        free(stack.indirect);
+        return 0;
+    }
+
+    // find the functions making indirect calls
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        stack.indirect[i] = qvm_stack_indirect(&qvm->functions[i]);
+
+    // find the calls graph components with the indirect calls, from the callees to the callers
+    if (!func_sccs_load(qvm, &sccs, stack.indirect)) {
+        free(stack.functions);
+        free(stack.indirect);
+        free(stack.entries);
+        return 0;
+    }
+
+    // get the depth of each function, the callees components first
+    for (unsigned int i = 0; i < sccs.count; i++) {
+        for (unsigned int j = sccs.starts[i]; j < sccs.starts[i + 1]; j++)
+            stack.functions[sccs.functions[j]].component = i;
+        qvm_stack_component(&stack, &sccs, i);
+    }
+
+    // the entry points are vmMain and the possible targets of the indirect calls, the indirect calls node goes to the deepest one
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        if (i && qvm->functions[i].called_by.count)
+            continue;
+        entry = &stack.entries[stack.entries_count++];
+        entry->id = i;
+        entry->total = stack.functions[i].depth;
+    }
+    stack.indirect_depth = stack.functions[qvm->functions_count].depth;
+
+    // rank the entry points by total depth, any recursive entry point has no bound
+    qsort(stack.entries, stack.entries_count, sizeof(*stack.entries), qvm_stack_compare);
+    status = "ok";
+    if (stack.entries_count) {
+        worst = stack.entries[0].total;
+        if (worst > STACK_ENGINE_SIZE)
+            status = "exceeded";
+    }
+    for (unsigned int i = 0; i < stack.entries_count; i++)
+        if (stack.functions[stack.entries[i].id].recursive)
+            status = "unbounded";
+
+    // create the output file
+    if (!(file = file_create(filename))) {
+        printf("Reporting stack usage to %s...Error: Couldn't create file.\n", filename);
+        free(stack.functions);
+        free(stack.indirect);
+        free(stack.entries);
+        func_sccs_free(&sccs);
+        return 0;
+    }
+
+    // print the report header
+    file_print(file, "/*\n");
+    file_print(file, "\tQVM Decompiler " QVMD_VERSION " by zen\n\n");
+    file_print(file, "\tEntry points: %u\n", stack.entries_count);
+    file_print(file, "\tRecursion cycles: %u\n", stack.cycles_count);
+    file_print(file, "\tIndirect calls depth: 0x%x\n", stack.indirect_depth);
+    file_print(file, "\tWorst depth: 0x%x\n", worst);
+    file_print(file, "\tEngine stack: 0x%x\n", STACK_ENGINE_SIZE);
+    file_print(file, "\tStatus: %s\n", status);
+    file_print(file, "*/\n\n");
+
+    // print the entry points ranked by total depth
+    file_print(file, "// entry points: total depth, name, frame, recursive, indirect calls\n");
+    for (unsigned int i = 0; i < stack.entries_count; i++) {
+        entry = &stack.entries[i];
+        file_print(file, "0x%x\t%s\t0x%x\t%s\t%s\n", entry->total, qvm->functions[entry->id].name, qvm->functions[entry->id].stack_size,
+            stack.functions[entry->id].recursive ? "yes" : "no", stack.functions[entry->id].indirect ? "yes" : "no");
+    }
+
+    // print the heaviest call chains
+    file_print(file, "\n// heaviest chains: total depth, functions with their frame\n");
+    for (unsigned int i = 0; i < stack.entries_count && i < STACK_CHAINS_COUNT; i++)
+        qvm_stack_chain(file, &stack, &stack.entries[i]);
+
+    // print the recursion cycles
+    file_print(file, "\n// recursion cycles: frames, functions\n");
+    qvm_stack_cycles(file, &stack, &sccs);
+
+    // free the created file and the depths
+    file_free(file);
+    free(stack.functions);
+    free(stack.indirect);
+    free(stack.entries);
+    func_sccs_free(&sccs);
+
+    printf("Reporting stack usage to %s...Success: %u entry points, %u recursion cycles and 0x%x bytes at worst.\n", filename, stack.entries_count, stack.cycles_count, worst);
+
+    // success
+    return 1;
+}
+
+static void qvm_stack_component(qvm_stack_t *stack, qvm_function_sccs_t *sccs, unsigned int scc)
+{
+    qvm_t                   *qvm = stack->qvm;
+    qvm_stack_function_t    *callee;
+    unsigned int            id;
+    unsigned int            callee_id;
+    unsigned int            frames = 0;
+    unsigned int            depth = 0;
+    unsigned int            next = STACK_NONE;
+    char                    cycle;
+    char                    recursive;
+    char                    indirect = 0;
+
+    // a recursion cycle is counted once with all its frames
+    if ((recursive = cycle = qvm_stack_cycle(stack, sccs, scc)))
+        stack->cycles_count++;
+
+    // sum the component frames and find its deepest callee outside of it, the indirect calls node has no frame
+    for (unsigned int i = sccs->starts[scc]; i < sccs->starts[scc + 1]; i++) {
+        id = sccs->functions[i];
+        frames += qvm_stack_frame(stack, id);
+        indirect |= id < qvm->functions_count && stack->indirect[id];
+        for (unsigned int j = 0; j < func_sccs_callees_count(qvm, stack->indirect, id); j++) {
+            if ((callee_id = func_sccs_callee(qvm, stack->indirect, id, j)) == FUNC_SCCS_NONE)
+                continue;
+
+            // skip the calls inside the recursion cycle
+            callee = &stack->functions[callee_id];
+            if (callee->component == scc)
+                continue;
+            recursive |= callee->recursive;
+            indirect |= callee->indirect;
+            if (next == STACK_NONE || callee->depth > depth) {
+                depth = callee->depth;
+                next = callee_id;
+            }
+        }
+    }
+
+    // set the depth of the component functions, a function out of a cycle only has its own frame
+    for (unsigned int i = sccs->starts[scc]; i < sccs->starts[scc + 1]; i++) {
+        id = sccs->functions[i];
+        stack->functions[id].depth = (cycle ? frames : qvm_stack_frame(stack, id)) + depth;
+        stack->functions[id].cycle = cycle ? frames : 0;
+        stack->functions[id].next = next;
+        stack->functions[id].recursive = recursive;
+        stack->functions[id].indirect = indirect;
+    }
+}
+
+static int qvm_stack_cycle(qvm_stack_t *stack, qvm_function_sccs_t *sccs, unsigned int scc)
+{
+    unsigned int    id = sccs->functions[sccs->starts[scc]];
+    qvm_function_t  *func;
+
+    // a component of several functions is a cycle
+    if (sccs->starts[scc + 1] - sccs->starts[scc] > 1)
+        return 1;
+
+    // the indirect calls node alone doesn't call itself
+    if (id >= stack->qvm->functions_count)
+        return 0;
+    func = &stack->qvm->functions[id];
+
+    // a function alone is a cycle only if it calls itself
+    for (unsigned int i = 0; i < func->calls.count; i++)
+        if (func->calls.functions[i] == func)
+            return 1;
+
+    // not a cycle
+    return 0;
+}
+
+static int qvm_stack_indirect(qvm_function_t *func)
+{
+    qvm_opcode_t    *op;
+
+    // an indirect call doesn't call a constant address
+    for (unsigned int i = func->address + 1; i < func->address + func->op_size; i++) {
+        op = &func->qvm->opcodes[i];
+        if (op->info->id == OP_CALL && op[-1].info->id != OP_CONST)
+            return 1;
+    }
+
+    // no indirect call
+    return 0;
+}
+
+static unsigned int qvm_stack_frame(qvm_stack_t *stack, unsigned int id)
+{
+    // the indirect calls node has no frame
+    return id < stack->qvm->functions_count ? stack->qvm->functions[id].stack_size : 0;
+}
+
+static char *qvm_stack_name(qvm_stack_t *stack, unsigned int id)
+{
+    // the indirect calls node has no function
+    return id < stack->qvm->functions_count ? stack->qvm->functions[id].name : "indirect";
+}
+
+static void qvm_stack_chain(file_t *file, qvm_stack_t *stack, qvm_stack_entry_t *entry)
+{
+    // follow the deepest callee of each function, a recursion cycle is entered once with all its frames
+    file_print(file, "0x%x\t", entry->total);
+    for (unsigned int id = entry->id; id != STACK_NONE; id = stack->functions[id].next) {
+        file_print(file, "%s%s(0x%x", id != entry->id ? " > " : "", qvm_stack_name(stack, id), qvm_stack_frame(stack, id));
+        if (stack->functions[id].cycle)
+            file_print(file, ", cycle 0x%x", stack->functions[id].cycle);
+        file_print(file, ")");
+    }
+    file_print(file, "\n");
+}
+
+static void qvm_stack_cycles(file_t *file, qvm_stack_t *stack, qvm_function_sccs_t *sccs)
+{
+    unsigned int    frames;
+
+    // browse the recursion cycles
+    for (unsigned int i = 0; i < sccs->count; i++) {
+        if (!qvm_stack_cycle(stack, sccs, i))
+            continue;
+
+        // print the frames and the functions of the cycle
+        frames = 0;
+        for (unsigned int j = sccs->starts[i]; j < sccs->starts[i + 1]; j++)
+            frames += qvm_stack_frame(stack, sccs->functions[j]);
+        file_print(file, "0x%x\t", frames);
+        for (unsigned int j = sccs->starts[i]; j < sccs->starts[i + 1]; j++)
+            file_print(file, "%s%s", j > sccs->starts[i] ? ", " : "", qvm_stack_name(stack, sccs->functions[j]));
+        file_print(file, "\n");
+    }
+}
+
+static int qvm_stack_compare(const void *a, const void *b)
+{
+    const qvm_stack_entry_t *ea = a;
+    const qvm_stack_entry_t *eb = b;
+
+    // the deepest first, then by address
+    if (ea->total != eb->total)
+        return ea->total > eb->total ? -1 : 1;
+    return ea->id < eb->id ? -1 : ea->id > eb->id;
+}
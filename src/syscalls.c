@@ -0,0 +1,507 @@
+#include "qvmd.h"
+
+/*
+    The syscalls of a QVM are called with the negative address -1 - id,
+    where id is the engine import number. The tables are indexed by that
+    id, so the compiler lays them out as a direct lookup: finding a syscall
+    is one bounds check and one load, without hashing or probing.
+*/
+
+#define SYSC(address)   [-1 - (address)]
+
+qvm_syscalls_table_t        *syscalls_table_get(int id);
+int                         syscalls_table_id(qvm_syscalls_table_t *table);
+qvm_syscall_t               *syscalls_find(qvm_syscalls_table_t *table, unsigned int address);
+qvm_syscalls_table_t        *syscalls_table_select(qvm_t *qvm);
+static int                  syscalls_table_score(qvm_syscalls_table_t *table, qvm_t *qvm);
+
+static qvm_syscall_t        qvm_syscalls_game[] = {
+    SYSC(-1) = { "trap_Print", 1 },
+    SYSC(-2) = { "trap_Error", 1 },
+    SYSC(-3) = { "trap_Milliseconds", 0 },
+    SYSC(-4) = { "trap_Cvar_Register", 4 },
+    SYSC(-5) = { "trap_Cvar_Update", 1 },
+    SYSC(-6) = { "trap_Cvar_Set", 2 },
+    SYSC(-7) = { "trap_Cvar_VariableIntegerValue", 1 },
+    SYSC(-8) = { "trap_Cvar_VariableStringBuffer", 3 },
+    SYSC(-9) = { "trap_Argc", 0 },
+    SYSC(-10) = { "trap_Argv", 3 },
+    SYSC(-11) = { "trap_FS_FOpenFile", 3 },
+    SYSC(-12) = { "trap_FS_Read", 3 },
+    SYSC(-13) = { "trap_FS_Write", 3 },
+    SYSC(-14) = { "trap_FS_FCloseFile", 1 },
+    SYSC(-15) = { "trap_SendConsoleCommand", 2 },
+    SYSC(-16) = { "trap_LocateGameData", 5 },
+    SYSC(-17) = { "trap_DropClient", 2 },
+    SYSC(-18) = { "trap_SendServerCommand", 2 },
+    SYSC(-19) = { "trap_SetConfigstring", 2 },
+    SYSC(-20) = { "trap_GetConfigstring", 3 },
+    SYSC(-21) = { "trap_GetUserinfo", 3 },
+    SYSC(-22) = { "trap_SetUserinfo", 2 },
+    SYSC(-23) = { "trap_GetServerinfo", 2 },
+    SYSC(-24) = { "trap_SetBrushModel", 2 },
+    SYSC(-25) = { "trap_Trace", 7 },
+    SYSC(-26) = { "trap_PointContents", 2 },
+    SYSC(-27) = { "trap_InPVS", 2 },
+    SYSC(-28) = { "trap_InPVSIgnorePortals", 2 },
+    SYSC(-29) = { "trap_AdjustAreaPortalState", 2 },
+    SYSC(-30) = { "trap_AreasConnected", 2 },
+    SYSC(-31) = { "trap_LinkEntity", 1 },
+    SYSC(-32) = { "trap_UnlinkEntity", 1 },
+    SYSC(-33) = { "trap_EntitiesInBox", 4 },
+    SYSC(-34) = { "trap_EntityContact", 3 },
+    SYSC(-35) = { "trap_BotAllocateClient", 0 },
+    SYSC(-36) = { "trap_BotFreeClient", 1 },
+    SYSC(-37) = { "trap_GetUsercmd", 2 },
+    SYSC(-38) = { "trap_GetEntityToken", 2 },
+    SYSC(-39) = { "trap_FS_GetFileList", 4 },
+    SYSC(-40) = { "trap_DebugPolygonCreate", 3 },
+    SYSC(-41) = { "trap_DebugPolygonDelete", 1 },
+    SYSC(-42) = { "trap_RealTime", 1 },
+    SYSC(-43) = { "trap_SnapVector", 1 },
+    SYSC(-44) = { "trap_TraceCapsule", 7 },
+    SYSC(-45) = { "trap_EntityContactCapsule", 3 },
+    SYSC(-46) = { "trap_FS_Seek", 3 },
+    SYSC(-101) = { "memset", 3 },
+    SYSC(-102) = { "memcpy", 3 },
+    SYSC(-103) = { "strncpy", 3 },
+    SYSC(-104) = { "sin", 1 },
+    SYSC(-105) = { "cos", 1 },
+    SYSC(-106) = { "atan2", 2 },
+    SYSC(-107) = { "sqrt", 1 },
+    SYSC(-111) = { "floor", 1 },
+    SYSC(-112) = { "ceil", 1 },
+    SYSC(-113) = { "testPrintInt", 2 },
+    SYSC(-114) = { "testPrintFloat", 2 },
+    SYSC(-201) = { "trap_BotLibSetup", 0 },
+    SYSC(-202) = { "trap_BotLibShutdown", 0 },
+    SYSC(-203) = { "trap_BotLibVarSet", 2 },
+    SYSC(-204) = { "trap_BotLibVarGet", 3 },
+    SYSC(-205) = { "trap_BotLibDefine", 1 },
+    SYSC(-206) = { "trap_BotLibStartFrame", 1 },
+    SYSC(-207) = { "trap_BotLibLoadMap", 1 },
+    SYSC(-208) = { "trap_BotLibUpdateEntity", 2 },
+    SYSC(-209) = { "trap_BotLibTest", 4 },
+    SYSC(-210) = { "trap_BotGetSnapshotEntity", 2 },
+    SYSC(-211) = { "trap_BotGetServerCommand", 3 },
+    SYSC(-212) = { "trap_BotUserCommand", 2 },
+    SYSC(-301) = { "trap_AAS_EnableRoutingArea", 2 },
+    SYSC(-302) = { "trap_AAS_BBoxAreas", 4 },
+    SYSC(-303) = { "trap_AAS_AreaInfo", 2 },
+    SYSC(-304) = { "trap_AAS_EntityInfo", 2 },
+    SYSC(-305) = { "trap_AAS_Initialized", 0 },
+    SYSC(-306) = { "trap_AAS_PresenceTypeBoundingBox", 3 },
+    SYSC(-307) = { "trap_AAS_Time", 0 },
+    SYSC(-308) = { "trap_AAS_PointAreaNum", 1 },
+    SYSC(-309) = { "trap_AAS_TraceAreas", 5 },
+    SYSC(-310) = { "trap_AAS_PointContents", 1 },
+    SYSC(-311) = { "trap_AAS_NextBSPEntity", 1 },
+    SYSC(-312) = { "trap_AAS_ValueForBSPEpairKey", 4 },
+    SYSC(-313) = { "trap_AAS_VectorForBSPEpairKey", 3 },
+    SYSC(-314) = { "trap_AAS_FloatForBSPEpairKey", 3 },
+    SYSC(-315) = { "trap_AAS_IntForBSPEpairKey", 3 },
+    SYSC(-316) = { "trap_AAS_AreaReachability", 1 },
+    SYSC(-317) = { "trap_AAS_AreaTravelTimeToGoalArea", 4 },
+    SYSC(-318) = { "trap_AAS_Swimming", 1 },
+    SYSC(-319) = { "trap_AAS_PredictClientMovement", 13 },
+    SYSC(-401) = { "trap_EA_Say", 2 },
+    SYSC(-402) = { "trap_EA_SayTeam", 2 },
+    SYSC(-403) = { "trap_EA_Command", 2 },
+    SYSC(-404) = { "trap_EA_Action", 2 },
+    SYSC(-405) = { "trap_EA_Gesture", 1 },
+    SYSC(-406) = { "trap_EA_Talk", 1 },
+    SYSC(-407) = { "trap_EA_Attack", 1 },
+    SYSC(-408) = { "trap_EA_Use", 1 },
+    SYSC(-409) = { "trap_EA_Respawn", 1 },
+    SYSC(-410) = { "trap_EA_Crouch", 1 },
+    SYSC(-411) = { "trap_EA_MoveUp", 1 },
+    SYSC(-412) = { "trap_EA_MoveDown", 1 },
+    SYSC(-413) = { "trap_EA_MoveForward", 1 },
+    SYSC(-414) = { "trap_EA_MoveBack", 1 },
+    SYSC(-415) = { "trap_EA_MoveLeft", 1 },
+    SYSC(-416) = { "trap_EA_MoveRight", 1 },
+    SYSC(-417) = { "trap_EA_SelectWeapon", 2 },
+    SYSC(-418) = { "trap_EA_Jump", 1 },
+    SYSC(-419) = { "trap_EA_DelayedJump", 1 },
+    SYSC(-420) = { "trap_EA_Move", 3 },
+    SYSC(-421) = { "trap_EA_View", 2 },
+    SYSC(-422) = { "trap_EA_EndRegular", 2 },
+    SYSC(-423) = { "trap_EA_GetInput", 3 },
+    SYSC(-424) = { "trap_EA_ResetInput", 1 },
+    SYSC(-501) = { "trap_BotLoadCharacter", 2 },
+    SYSC(-502) = { "trap_BotFreeCharacter", 1 },
+    SYSC(-503) = { "trap_Characteristic_Float", 2 },
+    SYSC(-504) = { "trap_Characteristic_BFloat", 4 },
+    SYSC(-505) = { "trap_Characteristic_Integer", 2 },
+    SYSC(-506) = { "trap_Characteristic_BInteger", 4 },
+    SYSC(-507) = { "trap_Characteristic_String", 4 },
+    SYSC(-508) = { "trap_BotAllocChatState", 0 },
+    SYSC(-509) = { "trap_BotFreeChatState", 1 },
+    SYSC(-510) = { "trap_BotQueueConsoleMessage", 3 },
+    SYSC(-511) = { "trap_BotRemoveConsoleMessage", 2 },
+    SYSC(-512) = { "trap_BotNextConsoleMessage", 2 },
+    SYSC(-513) = { "trap_BotNumConsoleMessages", 1 },
+    SYSC(-514) = { "trap_BotInitialChat", 11 },
+    SYSC(-515) = { "trap_BotReplyChat", 12 },
+    SYSC(-516) = { "trap_BotChatLength", 1 },
+    SYSC(-517) = { "trap_BotEnterChat", 3 },
+    SYSC(-518) = { "trap_StringContains", 3 },
+    SYSC(-519) = { "trap_BotFindMatch", 3 },
+    SYSC(-520) = { "trap_BotMatchVariable", 4 },
+    SYSC(-521) = { "trap_UnifyWhiteSpaces", 1 },
+    SYSC(-522) = { "trap_BotReplaceSynonyms", 2 },
+    SYSC(-523) = { "trap_BotLoadChatFile", 3 },
+    SYSC(-524) = { "trap_BotSetChatGender", 2 },
+    SYSC(-525) = { "trap_BotSetChatName", 3 },
+    SYSC(-526) = { "trap_BotResetGoalState", 1 },
+    SYSC(-527) = { "trap_BotResetAvoidGoals", 1 },
+    SYSC(-528) = { "trap_BotPushGoal", 2 },
+    SYSC(-529) = { "trap_BotPopGoal", 1 },
+    SYSC(-530) = { "trap_BotEmptyGoalStack", 1 },
+    SYSC(-531) = { "trap_BotDumpAvoidGoals", 1 },
+    SYSC(-532) = { "trap_BotDumpGoalStack", 1 },
+    SYSC(-533) = { "trap_BotGoalName", 3 },
+    SYSC(-534) = { "trap_BotGetTopGoal", 2 },
+    SYSC(-535) = { "trap_BotGetSecondGoal", 2 },
+    SYSC(-536) = { "trap_BotChooseLTGItem", 4 },
+    SYSC(-537) = { "trap_BotChooseNBGItem", 6 },
+    SYSC(-538) = { "trap_BotTouchingGoal", 2 },
+    SYSC(-539) = { "trap_BotItemGoalInVisButNotVisible", 4 },
+    SYSC(-540) = { "trap_BotGetLevelItemGoal", 3 },
+    SYSC(-541) = { "trap_BotAvoidGoalTime", 2 },
+    SYSC(-542) = { "trap_BotInitLevelItems", 0 },
+    SYSC(-543) = { "trap_BotUpdateEntityItems", 0 },
+    SYSC(-544) = { "trap_BotLoadItemWeights", 2 },
+    SYSC(-545) = { "trap_BotFreeItemWeights", 1 },
+    SYSC(-546) = { "trap_BotSaveGoalFuzzyLogic", 2 },
+    SYSC(-547) = { "trap_BotAllocGoalState", 1 },
+    SYSC(-548) = { "trap_BotFreeGoalState", 1 },
+    SYSC(-549) = { "trap_BotResetMoveState", 1 },
+    SYSC(-550) = { "trap_BotMoveToGoal", 4 },
+    SYSC(-551) = { "trap_BotMoveInDirection", 4 },
+    SYSC(-552) = { "trap_BotResetAvoidReach", 1 },
+    SYSC(-553) = { "trap_BotResetLastAvoidReach", 1 },
+    SYSC(-554) = { "trap_BotReachabilityArea", 2 },
+    SYSC(-555) = { "trap_BotMovementViewTarget", 5 },
+    SYSC(-556) = { "trap_BotAllocMoveState", 0 },
+    SYSC(-557) = { "trap_BotFreeMoveState", 1 },
+    SYSC(-558) = { "trap_BotInitMoveState", 2 },
+    SYSC(-559) = { "trap_BotChooseBestFightWeapon", 2 },
+    SYSC(-560) = { "trap_BotGetWeaponInfo", 3 },
+    SYSC(-561) = { "trap_BotLoadWeaponWeights", 2 },
+    SYSC(-562) = { "trap_BotAllocWeaponState", 0 },
+    SYSC(-563) = { "trap_BotFreeWeaponState", 1 },
+    SYSC(-564) = { "trap_BotResetWeaponState", 1 },
+    SYSC(-565) = { "trap_GeneticParentsAndChildSelection", 5 },
+    SYSC(-566) = { "trap_BotInterbreedGoalFuzzyLogic", 3 },
+    SYSC(-567) = { "trap_BotMutateGoalFuzzyLogic", 2 },
+    SYSC(-568) = { "trap_BotGetNextCampSpotGoal", 2 },
+    SYSC(-569) = { "trap_BotGetMapLocationGoal", 2 },
+    SYSC(-570) = { "trap_BotNumInitialChats", 2 },
+    SYSC(-571) = { "trap_BotGetChatMessage", 3 },
+    SYSC(-572) = { "trap_BotRemoveFromAvoidGoals", 2 },
+    SYSC(-573) = { "trap_BotPredictVisiblePosition", 5 },
+    SYSC(-574) = { "trap_BotSetAvoidGoalTime", 3 },
+    SYSC(-575) = { "trap_BotAddAvoidSpot", 4 },
+    SYSC(-576) = { "trap_AAS_AlternativeRouteGoals", 8 },
+    SYSC(-577) = { "trap_AAS_PredictRoute", 11 },
+    SYSC(-578) = { "trap_AAS_PointReachabilityAreaIndex", 1 },
+    SYSC(-579) = { "trap_BotLibLoadSource", 1 },
+    SYSC(-580) = { "trap_BotLibFreeSource", 1 },
+    SYSC(-581) = { "trap_BotLibReadToken", 2 },
+    SYSC(-582) = { "trap_BotLibSourceFileAndLine", 3 },
+};
+
+static qvm_syscall_t        qvm_syscalls_cgame[] = {
+    SYSC(-1) = { "trap_Print", 1 },
+    SYSC(-2) = { "trap_Error", 1 },
+    SYSC(-3) = { "trap_Milliseconds", 0 },
+    SYSC(-4) = { "trap_Cvar_Register", 4 },
+    SYSC(-5) = { "trap_Cvar_Update", 1 },
+    SYSC(-6) = { "trap_Cvar_Set", 2 },
+    SYSC(-7) = { "trap_Cvar_VariableStringBuffer", 3 },
+    SYSC(-8) = { "trap_Argc", 0 },
+    SYSC(-9) = { "trap_Argv", 3 },
+    SYSC(-10) = { "trap_Args", 2 },
+    SYSC(-11) = { "trap_FS_FOpenFile", 3 },
+    SYSC(-12) = { "trap_FS_Read", 3 },
+    SYSC(-13) = { "trap_FS_Write", 3 },
+    SYSC(-14) = { "trap_FS_FCloseFile", 1 },
+    SYSC(-15) = { "trap_SendConsoleCommand", 1 },
+    SYSC(-16) = { "trap_AddCommand", 1 },
+    SYSC(-17) = { "trap_SendClientCommand", 1 },
+    SYSC(-18) = { "trap_UpdateScreen", 0 },
+    SYSC(-19) = { "trap_CM_LoadMap", 1 },
+    SYSC(-20) = { "trap_CM_NumInlineModels", 0 },
+    SYSC(-21) = { "trap_CM_InlineModel", 1 },
+    SYSC(-22) = { "trap_CM_LoadModel", 1 },
+    SYSC(-23) = { "trap_CM_TempBoxModel", 2 },
+    SYSC(-24) = { "trap_CM_PointContents", 2 },
+    SYSC(-25) = { "trap_CM_TransformedPointContents", 4 },
+    SYSC(-26) = { "trap_CM_BoxTrace", 7 },
+    SYSC(-27) = { "trap_CM_TransformedBoxTrace", 9 },
+    SYSC(-28) = { "trap_CM_MarkFragments", 7 },
+    SYSC(-29) = { "trap_S_StartSound", 4 },
+    SYSC(-30) = { "trap_S_StartLocalSound", 2 },
+    SYSC(-31) = { "trap_S_ClearLoopingSounds", 1 },
+    SYSC(-32) = { "trap_S_AddLoopingSound", 4 },
+    SYSC(-33) = { "trap_S_UpdateEntityPosition", 2 },
+    SYSC(-34) = { "trap_S_Respatialize", 4 },
+    SYSC(-35) = { "trap_S_RegisterSound", 2 },
+    SYSC(-36) = { "trap_S_StartBackgroundTrack", 2 },
+    SYSC(-37) = { "trap_R_LoadWorldMap", 1 },
+    SYSC(-38) = { "trap_R_RegisterModel", 1 },
+    SYSC(-39) = { "trap_R_RegisterSkin", 1 },
+    SYSC(-40) = { "trap_R_RegisterShader", 1 },
+    SYSC(-41) = { "trap_R_ClearScene", 0 },
+    SYSC(-42) = { "trap_R_AddRefEntityToScene", 1 },
+    SYSC(-43) = { "trap_R_AddPolyToScene", 3 },
+    SYSC(-44) = { "trap_R_AddLightToScene", 5 },
+    SYSC(-45) = { "trap_R_RenderScene", 1 },
+    SYSC(-46) = { "trap_R_SetColor", 1 },
+    SYSC(-47) = { "trap_R_DrawStretchPic", 9 },
+    SYSC(-48) = { "trap_R_ModelBounds", 3 },
+    SYSC(-49) = { "trap_R_LerpTag", 6 },
+    SYSC(-50) = { "trap_GetGlconfig", 1 },
+    SYSC(-51) = { "trap_GetGameState", 1 },
+    SYSC(-52) = { "trap_GetCurrentSnapshotNumber", 2 },
+    SYSC(-53) = { "trap_GetSnapshot", 2 },
+    SYSC(-54) = { "trap_GetServerCommand", 1 },
+    SYSC(-55) = { "trap_GetCurrentCmdNumber", 0 },
+    SYSC(-56) = { "trap_GetUserCmd", 2 },
+    SYSC(-57) = { "trap_SetUserCmdValue", 2 },
+    SYSC(-58) = { "trap_R_RegisterShaderNoMip", 1 },
+    SYSC(-59) = { "trap_MemoryRemaining", 0 },
+    SYSC(-60) = { "trap_R_RegisterFont", 3 },
+    SYSC(-61) = { "trap_Key_IsDown", 1 },
+    SYSC(-62) = { "trap_Key_GetCatcher", 0 },
+    SYSC(-63) = { "trap_Key_SetCatcher", 1 },
+    SYSC(-64) = { "trap_Key_GetKey", 1 },
+    SYSC(-65) = { "trap_PC_AddGlobalDefine", 1 },
+    SYSC(-66) = { "trap_PC_LoadSource", 1 },
+    SYSC(-67) = { "trap_PC_FreeSource", 1 },
+    SYSC(-68) = { "trap_PC_ReadToken", 2 },
+    SYSC(-69) = { "trap_PC_SourceFileAndLine", 3 },
+    SYSC(-70) = { "trap_S_StopBackgroundTrack", 0 },
+    SYSC(-71) = { "trap_RealTime", 1 },
+    SYSC(-72) = { "trap_SnapVector", 1 },
+    SYSC(-73) = { "trap_RemoveCommand", 1 },
+    SYSC(-74) = { "trap_R_LightForPoint", 4 },
+    SYSC(-75) = { "trap_CIN_PlayCinematic", 6 },
+    SYSC(-76) = { "trap_CIN_StopCinematic", 1 },
+    SYSC(-77) = { "trap_CIN_RunCinematic", 1 },
+    SYSC(-78) = { "trap_CIN_DrawCinematic", 1 },
+    SYSC(-79) = { "trap_CIN_SetExtents", 5 },
+    SYSC(-80) = { "trap_R_RemapShader", 3 },
+    SYSC(-81) = { "trap_S_AddRealLoopingSound", 4 },
+    SYSC(-82) = { "trap_S_StopLoopingSound", 1 },
+    SYSC(-83) = { "trap_CM_TempCapsuleModel", 2 },
+    SYSC(-84) = { "trap_CM_CapsuleTrace", 7 },
+    SYSC(-85) = { "trap_CM_TransformedCapsuleTrace", 9 },
+    SYSC(-86) = { "trap_R_AddAdditiveLightToScene", 5 },
+    SYSC(-87) = { "trap_GetEntityToken", 2 },
+    SYSC(-88) = { "trap_R_AddPolysToScene", 4 },
+    SYSC(-89) = { "trap_R_inPVS", 2 },
+    SYSC(-90) = { "trap_FS_Seek", 3 },
+    SYSC(-101) = { "memset", 3 },
+    SYSC(-102) = { "memcpy", 3 },
+    SYSC(-103) = { "strncpy", 3 },
+    SYSC(-104) = { "sin", 1 },
+    SYSC(-105) = { "cos", 1 },
+    SYSC(-106) = { "atan2", 2 },
+    SYSC(-107) = { "sqrt", 1 },
+    SYSC(-108) = { "floor", 1 },
+    SYSC(-109) = { "ceil", 1 },
+    SYSC(-110) = { "testPrintInt", 2 },
+    SYSC(-111) = { "testPrintFloat", 2 },
+    SYSC(-112) = { "acos", 1 },
+};
+
+static qvm_syscall_t        qvm_syscalls_ui[] = {
+    SYSC(-1) = { "trap_Error", 1 },
+    SYSC(-2) = { "trap_Print", 1 },
+    SYSC(-3) = { "trap_Milliseconds", 0 },
+    SYSC(-4) = { "trap_Cvar_Set", 2 },
+    SYSC(-5) = { "trap_Cvar_VariableValue", 1 },
+    SYSC(-6) = { "trap_Cvar_VariableStringBuffer", 3 },
+    SYSC(-7) = { "trap_Cvar_SetValue", 2 },
+    SYSC(-8) = { "trap_Cvar_Reset", 1 },
+    SYSC(-9) = { "trap_Cvar_Create", 3 },
+    SYSC(-10) = { "trap_Cvar_InfoStringBuffer", 3 },
+    SYSC(-11) = { "trap_Argc", 0 },
+    SYSC(-12) = { "trap_Argv", 3 },
+    SYSC(-13) = { "trap_Cmd_ExecuteText", 2 },
+    SYSC(-14) = { "trap_FS_FOpenFile", 3 },
+    SYSC(-15) = { "trap_FS_Read", 3 },
+    SYSC(-16) = { "trap_FS_Write", 3 },
+    SYSC(-17) = { "trap_FS_FCloseFile", 1 },
+    SYSC(-18) = { "trap_FS_GetFileList", 4 },
+    SYSC(-19) = { "trap_R_RegisterModel", 1 },
+    SYSC(-20) = { "trap_R_RegisterSkin", 1 },
+    SYSC(-21) = { "trap_R_RegisterShaderNoMip", 1 },
+    SYSC(-22) = { "trap_R_ClearScene", 0 },
+    SYSC(-23) = { "trap_R_AddRefEntityToScene", 1 },
+    SYSC(-24) = { "trap_R_AddPolyToScene", 3 },
+    SYSC(-25) = { "trap_R_AddLightToScene", 5 },
+    SYSC(-26) = { "trap_R_RenderScene", 1 },
+    SYSC(-27) = { "trap_R_SetColor", 1 },
+    SYSC(-28) = { "trap_R_DrawStretchPic", 9 },
+    SYSC(-29) = { "trap_UpdateScreen", 0 },
+    SYSC(-30) = { "trap_CM_LerpTag", 6 },
+    SYSC(-31) = { "trap_CM_LoadModel", 1 },
+    SYSC(-32) = { "trap_S_RegisterSound", 2 },
+    SYSC(-33) = { "trap_S_StartLocalSound", 2 },
+    SYSC(-34) = { "trap_Key_KeynumToStringBuf", 3 },
+    SYSC(-35) = { "trap_Key_GetBindingBuf", 3 },
+    SYSC(-36) = { "trap_Key_SetBinding", 2 },
+    SYSC(-37) = { "trap_Key_IsDown", 1 },
+    SYSC(-38) = { "trap_Key_GetOverstrikeMode", 0 },
+    SYSC(-39) = { "trap_Key_SetOverstrikeMode", 1 },
+    SYSC(-40) = { "trap_Key_ClearStates", 0 },
+    SYSC(-41) = { "trap_Key_GetCatcher", 0 },
+    SYSC(-42) = { "trap_Key_SetCatcher", 1 },
+    SYSC(-43) = { "trap_GetClipboardData", 2 },
+    SYSC(-44) = { "trap_GetGlconfig", 1 },
+    SYSC(-45) = { "trap_GetClientState", 1 },
+    SYSC(-46) = { "trap_GetConfigString", 3 },
+    SYSC(-47) = { "trap_LAN_GetPingQueueCount", 0 },
+    SYSC(-48) = { "trap_LAN_ClearPing", 1 },
+    SYSC(-49) = { "trap_LAN_GetPing", 4 },
+    SYSC(-50) = { "trap_LAN_GetPingInfo", 3 },
+    SYSC(-51) = { "trap_Cvar_Register", 4 },
+    SYSC(-52) = { "trap_Cvar_Update", 1 },
+    SYSC(-53) = { "trap_MemoryRemaining", 0 },
+    SYSC(-54) = { "trap_GetCDKey", 2 },
+    SYSC(-55) = { "trap_SetCDKey", 1 },
+    SYSC(-56) = { "trap_R_RegisterFont", 3 },
+    SYSC(-57) = { "trap_R_ModelBounds", 3 },
+    SYSC(-58) = { "trap_PC_AddGlobalDefine", 1 },
+    SYSC(-59) = { "trap_PC_LoadSource", 1 },
+    SYSC(-60) = { "trap_PC_FreeSource", 1 },
+    SYSC(-61) = { "trap_PC_ReadToken", 2 },
+    SYSC(-62) = { "trap_PC_SourceFileAndLine", 3 },
+    SYSC(-63) = { "trap_S_StopBackgroundTrack", 0 },
+    SYSC(-64) = { "trap_S_StartBackgroundTrack", 2 },
+    SYSC(-65) = { "trap_RealTime", 1 },
+    SYSC(-66) = { "trap_LAN_GetServerCount", 1 },
+    SYSC(-67) = { "trap_LAN_GetServerAddressString", 4 },
+    SYSC(-68) = { "trap_LAN_GetServerInfo", 4 },
+    SYSC(-69) = { "trap_LAN_MarkServerVisible", 3 },
+    SYSC(-70) = { "trap_LAN_UpdateVisiblePings", 1 },
+    SYSC(-71) = { "trap_LAN_ResetPings", 1 },
+    SYSC(-72) = { "trap_LAN_LoadCachedServers", 0 },
+    SYSC(-73) = { "trap_LAN_SaveCachedServers", 0 },
+    SYSC(-74) = { "trap_LAN_AddServer", 3 },
+    SYSC(-75) = { "trap_LAN_RemoveServer", 2 },
+    SYSC(-76) = { "trap_CIN_PlayCinematic", 6 },
+    SYSC(-77) = { "trap_CIN_StopCinematic", 1 },
+    SYSC(-78) = { "trap_CIN_RunCinematic", 1 },
+    SYSC(-79) = { "trap_CIN_DrawCinematic", 1 },
+    SYSC(-80) = { "trap_CIN_SetExtents", 5 },
+    SYSC(-81) = { "trap_R_RemapShader", 3 },
+    SYSC(-82) = { "trap_VerifyCDKey", 2 },
+    SYSC(-83) = { "trap_LAN_ServerStatus", 3 },
+    SYSC(-84) = { "trap_LAN_GetServerPing", 2 },
+    SYSC(-85) = { "trap_LAN_ServerIsVisible", 2 },
+    SYSC(-86) = { "trap_LAN_CompareServers", 5 },
+    SYSC(-87) = { "trap_FS_Seek", 3 },
+    SYSC(-88) = { "trap_SetPbClStatus", 1 },
+    SYSC(-101) = { "memset", 3 },
+    SYSC(-102) = { "memcpy", 3 },
+    SYSC(-103) = { "strncpy", 3 },
+    SYSC(-104) = { "sin", 1 },
+    SYSC(-105) = { "cos", 1 },
+    SYSC(-106) = { "atan2", 2 },
+    SYSC(-107) = { "sqrt", 1 },
+    SYSC(-108) = { "floor", 1 },
+    SYSC(-109) = { "ceil", 1 },
+};
+
+qvm_syscalls_table_t        qvm_syscalls_tables[SYSCALLS_TABLES_COUNT] = {
+    { "game", qvm_syscalls_game, sizeof(qvm_syscalls_game) / sizeof(*qvm_syscalls_game) },
+    { "cgame", qvm_syscalls_cgame, sizeof(qvm_syscalls_cgame) / sizeof(*qvm_syscalls_cgame) },
+    { "ui", qvm_syscalls_ui, sizeof(qvm_syscalls_ui) / sizeof(*qvm_syscalls_ui) },
+};
+
+qvm_syscalls_table_t *syscalls_table_get(int id)
+{
+    // check the table id
+    if (id < 0 || id >= SYSCALLS_TABLES_COUNT)
+        return NULL;
+
+    // return the table
+    return &qvm_syscalls_tables[id];
+}
+
+int syscalls_table_id(qvm_syscalls_table_t *table)
+{
+    // no table has no id
+    if (!table)
+        return -1;
+
+    // return the table index
+    return (int)(table - qvm_syscalls_tables);
+}
+
+qvm_syscall_t *syscalls_find(qvm_syscalls_table_t *table, unsigned int address)
+{
+    unsigned int    index;
+
+    // check if there is a table
+    if (!table)
+        return NULL;
+
+    // get the table index from the syscall address, the addresses out of the table wrap above its size
+    index = -1 - address;
+    if (index >= table->size || !table->syscalls[index].name)
+        return NULL;
+
+    // return the syscall
+    return &table->syscalls[index];
+}
+
+qvm_syscalls_table_t *syscalls_table_select(qvm_t *qvm)
+{
+    qvm_syscalls_table_t    *table = NULL;
+    int                     score;
+    int                     best = 0;
+    char                    tie = 0;
+
+    // browse all tables
+    for (int i = 0; i < SYSCALLS_TABLES_COUNT; i++) {
+        score = syscalls_table_score(&qvm_syscalls_tables[i], qvm);
+
+        // keep the best table, two tables with the same score can't be told apart
+        if (score > best) {
+            table = &qvm_syscalls_tables[i];
+            best = score;
+            tie = 0;
+        }
+        else if (score && score == best)
+            tie = 1;
+    }
+
+    // return the table if there is only one best table
+    return tie ? NULL : table;
+}
+
+static int syscalls_table_score(qvm_syscalls_table_t *table, qvm_t *qvm)
+{
+    qvm_function_t  *sysc;
+    qvm_syscall_t   *entry;
+    int             score = 0;
+
+    // browse all syscalls
+    for (sysc = qvm->syscalls; sysc; sysc = sysc->next) {
+        // all the syscalls must be in the table
+        if (!(entry = syscalls_find(table, sysc->address)))
+            return 0;
+
+        // count the syscalls called with the table args count, a call not restored pushes no args
+        if (entry->args_count == sysc->args_count)
+            score++;
+    }
+
+    // a table with no syscall matching is not used
+    return score;
+}
@@ -0,0 +1,27 @@
+#ifndef SYSCALLS_H
+#define SYSCALLS_H
+
+#define SYSCALLS_TABLES_COUNT   3
+
+typedef struct qvm_syscall_s        qvm_syscall_t;
+typedef struct qvm_syscalls_table_s qvm_syscalls_table_t;
+
+typedef struct qvm_syscall_s {
+    char            *name;
+    unsigned int    args_count;
+} qvm_syscall_t;
+
+typedef struct qvm_syscalls_table_s {
+    char            *name;
+    qvm_syscall_t   *syscalls;
+    unsigned int    size;
+} qvm_syscalls_table_t;
+
+extern qvm_syscalls_table_t qvm_syscalls_tables[SYSCALLS_TABLES_COUNT];
+
+qvm_syscall_t           *syscalls_find(qvm_syscalls_table_t *table, unsigned int address);
+qvm_syscalls_table_t    *syscalls_table_get(int id);
+int                     syscalls_table_id(qvm_syscalls_table_t *table);
+qvm_syscalls_table_t    *syscalls_table_select(qvm_t *qvm);
+
+#endif
@@ -3,9 +3,12 @@
 static qvm_variable_t   *var_new(void);
 qvm_variable_t          *var_get(qvm_t *qvm, qvm_function_t *function, unsigned int address, unsigned int size, qvm_function_t *parent);
 qvm_variable_t          *var_find(qvm_variable_t *list, unsigned int address);
+qvm_variable_t          *var_find_name(qvm_variable_t *list, char *name);
 static qvm_variable_t   *var_create(qvm_t *qvm, qvm_function_t *function, unsigned int address, unsigned int used_size, qvm_function_t *parent);
 void                    var_rename(qvm_variable_t *var, char *name);
+void                    var_rename_default(qvm_t *qvm, qvm_function_t *function, qvm_variable_t *var);
 qvm_variable_t          *var_cut(qvm_t *qvm, qvm_function_t *function, unsigned int address);
+void                    var_free(qvm_variable_t *list);
 
 static qvm_variable_t *var_new(void)
 {
@@ -18,6 +21,7 @@ static qvm_variable_t *var_new(void)
     }
 
     // initialize the variable
+    var->id = 0;
     *var->name = 0;
     var->address = 0;
     var->prob_size[1] = 0;
@@ -26,8 +30,13 @@ static qvm_variable_t *var_new(void)
     var->size = 0;
     var->content = NULL;
     var->next = NULL;
-    var->parents = NULL;
+    var->parents.functions = NULL;
+    var->parents.count = 0;
+    var->xrefs.xrefs = NULL;
+    var->xrefs.count = 0;
+    var->type = NULL;
     var->variadic = 0;
+    var->cut = 0;
 
     // return the variable
     return var;
@@ -47,8 +56,8 @@ qvm_variable_t *var_get(qvm_t *qvm, qvm_function_t *function, unsigned int addre
         if (!(var = var_create(qvm, function, address, size, parent)))
             return NULL;
     } else {
-        // add the variable parent
-        if (parent && !func_list_add(&var->parents, parent))
+        // add the global variable parent, the locals parent is their function
+        if (parent && !function && !func_graph_add(&qvm->graph, &var->parents, parent))
             return NULL;
     }
 
@@ -67,6 +76,17 @@ qvm_variable_t *var_find(qvm_variable_t *list, unsigned int address)
     return NULL;
 }
 
+qvm_variable_t *var_find_name(qvm_variable_t *list, char *name)
+{
+    // find the variable from name
+    for (; list; list = list->next)
+        if (!strcmp(list->name, name))
+            return list;
+
+    // we didn't find it
+    return NULL;
+}
+
 static qvm_variable_t *var_find_prev(qvm_variable_t *list, unsigned int address)
 {
     qvm_variable_t  *prev = NULL;
@@ -100,37 +120,15 @@ static qvm_variable_t *var_create(qvm_t *qvm, qvm_function_t *function, unsigned
     if (!(var = var_new()))
         return NULL;
 
-    // set the variable address
+    // set the variable id and address
+    var->id = qvm->globals_count + qvm->locals_count;
     var->address = address;
 
     // get the variables list
     list = function ? &function->locals : &qvm->globals;
 
     // set the variable name and status
-    if (function) {
-        if (address >= function->stack_size) {
-            sprintf(var->name, "arg_%i", (address - function->stack_size - 8) / 4);
-            var->status = VS_ARG;
-        }
-        else {
-            sprintf(var->name, "local_%x", address);
-            var->status = VS_LOCAL;
-        }
-    }
-    else {
-        if (address < qvm->sections[S_DATA].length) {
-            sprintf(var->name, "global_%x", address);
-            var->status = VS_GLOBAL;
-        }
-        else if (address < qvm->sections[S_DATA].length + qvm->sections[S_LIT].length) {
-            sprintf(var->name, "lit_%x", address);
-            var->status = VS_LITERAL;
-        }
-        else {
-            sprintf(var->name, "bss_%x", address);
-            var->status = VS_BSS;
-        }
-    }
+    var_rename_default(qvm, function, var);
 
     // set the variable content if needed
     if (!function && address < qvm->sections[S_DATA].length + qvm->sections[S_LIT].length)
@@ -157,11 +155,9 @@ static qvm_variable_t *var_create(qvm_t *qvm, qvm_function_t *function, unsigned
         prev->next = var;
     }
 
-    // set the variable parent
-    if (parent && !func_list_add(&var->parents, parent)) {
-        free(var);
+    // set the global variable parent, the locals parent is their function
+    if (parent && !function && !func_graph_add(&qvm->graph, &var->parents, parent))
         return NULL;
-    }
 
     // return the variable
     return var;
@@ -179,6 +175,37 @@ void var_rename(qvm_variable_t *var, char *name)
     sprintf(var->name, "%s", name);
 }
 
+void var_rename_default(qvm_t *qvm, qvm_function_t *function, qvm_variable_t *var)
+{
+    unsigned int    address = var->address;
+
+    // set the variable name and status from its address
+    if (function) {
+        if (address >= function->stack_size) {
+            sprintf(var->name, "arg_%i", (address - function->stack_size - 8) / 4);
+            var->status = VS_ARG;
+        }
+        else {
+            sprintf(var->name, "local_%x", address);
+            var->status = VS_LOCAL;
+        }
+    }
+    else {
+        if (address < qvm->sections[S_DATA].length) {
+            sprintf(var->name, "global_%x", address);
+            var->status = VS_GLOBAL;
+        }
+        else if (address < qvm->sections[S_DATA].length + qvm->sections[S_LIT].length) {
+            sprintf(var->name, "lit_%x", address);
+            var->status = VS_LITERAL;
+        }
+        else {
+            sprintf(var->name, "bss_%x", address);
+            var->status = VS_BSS;
+        }
+    }
+}
+
 qvm_variable_t *var_cut(qvm_t *qvm, qvm_function_t *function, unsigned int address)
 {
     qvm_variable_t *var;
@@ -197,8 +224,9 @@ qvm_variable_t *var_cut(qvm_t *qvm, qvm_function_t *function, unsigned int addre
                 if (!(new_var = var_create(qvm, function, address, 0, NULL)))
                     return NULL;
 
-                // set the new var size
+                // set the new var size and mark it as cut
                 new_var->size = var->size - (address - var->address);
+                new_var->cut = 1;
 
                 // change the variable size
                 var->size = address - var->address;
@@ -213,3 +241,14 @@ qvm_variable_t *var_cut(qvm_t *qvm, qvm_function_t *function, unsigned int addre
     printf("Error: Couldn't find variable %0x to cut it.\n", address);
     return NULL;
 }
+
+void var_free(qvm_variable_t *list)
+{
+    qvm_variable_t  *next;
+
+    // free all the variables, their parents and references are in the qvm
+    for (; list; list = next) {
+        next = list->next;
+        free(list);
+    }
+}
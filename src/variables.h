@@ -17,21 +17,27 @@ typedef enum {
 } qvm_variable_status_e;
 
 typedef struct qvm_variable_s {
+    unsigned int            id;
     char                    name[64];
     unsigned int            address;
     unsigned int            prob_size[5];
     unsigned int            size;
     char                    *content;
     qvm_variable_t          *next;
-    qvm_function_list_t     *parents;
+    qvm_function_array_t    parents;
+    qvm_xref_array_t        xrefs;
     qvm_variable_status_e   status;
     qvm_type_t              *type;
     char                    variadic;
+    char                    cut;
 } qvm_variable_t;
 
 qvm_variable_t  *var_get(qvm_t *qvm, qvm_function_t *function, unsigned int address, unsigned int size, qvm_function_t *parent);
 qvm_variable_t  *var_find(qvm_variable_t *list, unsigned int address);
+qvm_variable_t  *var_find_name(qvm_variable_t *list, char *name);
 void            var_rename(qvm_variable_t *var, char *name);
+void            var_rename_default(qvm_t *qvm, qvm_function_t *function, qvm_variable_t *var);
 qvm_variable_t  *var_cut(qvm_t *qvm, qvm_function_t *function, unsigned int address);
+void            var_free(qvm_variable_t *list);
 
 #endif
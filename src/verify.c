@@ -0,0 +1,198 @@
+#include "qvmd.h"
+
+/*
+    The verifier follows the operand stack height of each instruction of a
+    function along all its paths, like the engine will execute them. Each
+    opcode pops and pushes the operands of its opblock, a function starts
+    with an empty stack and must leave it empty once its return value is
+    popped. An instruction reached twice must have the same height, so a
+    worklist only visits each instruction once. The jumps without a constant
+    target go through the switch jump tables, their targets are the
+    instructions not reached otherwise and start from the jump height. A
+    function is rejected at its first underflow, overflow of the engine
+    stack, height mismatch or branch out of it, and the max depth is kept.
+*/
+
+int         verify_functions(qvm_t *qvm);
+int         verify_function(qvm_verify_t *verify, qvm_function_t *func);
+static int  verify_opcode(qvm_verify_t *verify, unsigned int i);
+static int  verify_branch(qvm_verify_t *verify, unsigned int from, unsigned int address, unsigned int height);
+static int  verify_merge(qvm_verify_t *verify, unsigned int from, unsigned int i, unsigned int height);
+
+int verify_functions(qvm_t *qvm)
+{
+    qvm_verify_t    verify;
+    unsigned int    size = 0;
+    unsigned int    depth = 0;
+
+    printf("Verifying functions...");
+
+    // allocate the heights and the worklist for the largest function
+    for (unsigned int i = 0; i < qvm->functions_count; i++)
+        if (qvm->functions[i].op_size > size)
+            size = qvm->functions[i].op_size;
+    memset(&verify, 0, sizeof(verify));
+    if (!(verify.heights = malloc(sizeof(*verify.heights) * (size + 1))) ||
+        !(verify.worklist = malloc(sizeof(*verify.worklist) * (size + 1)))) {
+        printf("Error: Couldn't allocate operand stack heights.\n");
+        free(verify.heights);
+        return 0;
+    }
+
+    // verify each function and keep the deepest
+    for (unsigned int i = 0; i < qvm->functions_count; i++) {
+        if (!verify_function(&verify, &qvm->functions[i])) {
+            free(verify.heights);
+            free(verify.worklist);
+            return 0;
+        }
+        if (qvm->functions[i].opstack_depth > depth)
+            depth = qvm->functions[i].opstack_depth;
+    }
+
+    // free the heights and the worklist
+    free(verify.heights);
+    free(verify.worklist);
+
+    printf("Success: %u functions verified, operand stack depth %u at most.\n", qvm->functions_count, depth);
+
+    // success
+    return 1;
+}
+
+int verify_function(qvm_verify_t *verify, qvm_function_t *func)
+{
+    unsigned int    i;
+
+    // no instruction is reached yet, the first one starts with an empty stack
+    verify->function = func;
+    verify->worklist_count = 0;
+    verify->indirect = VERIFY_NONE;
+    verify->depth = 0;
+    for (i = 0; i < func->op_size; i++)
+        verify->heights[i] = VERIFY_NONE;
+    if (func->op_size) {
+        verify->heights[0] = 0;
+        verify->worklist[verify->worklist_count++] = 0;
+    }
+
+    while (verify->worklist_count) {
+        // follow all the paths of the reached instructions
+        while (verify->worklist_count)
+            if (!verify_opcode(verify, verify->worklist[--verify->worklist_count]))
+                return 0;
+
+        // the instructions not reached yet are jump tables targets if there is an indirect jump, else dead code
+        if (verify->indirect == VERIFY_NONE)
+            break;
+        for (i = 0; i < func->op_size && verify->heights[i] != VERIFY_NONE; i++);
+        if (i < func->op_size) {
+            verify->heights[i] = verify->indirect;
+            verify->worklist[verify->worklist_count++] = i;
+        }
+    }
+
+    // save the max depth of the function
+    func->opstack_depth = verify->depth;
+
+    // success
+    return 1;
+}
+
+static int verify_opcode(qvm_verify_t *verify, unsigned int i)
+{
+    qvm_function_t      *func = verify->function;
+    qvm_opcode_t        *op = &func->qvm->opcodes[func->address + i];
+    qvm_opblock_info_t  *info = &qvm_opblocks_info[op->info->opblock_id];
+    unsigned int        height = verify->heights[i];
+    unsigned int        pops = 0;
+
+    // pop the operands of the opcode
+    if (info->flags & OPB_F_STACK_POP)
+        pops += 1;
+    if (info->flags & OPB_F_STACK_2POP)
+        pops += 2;
+    if (height < pops) {
+        printf("Error: Operand stack underflow at 0x%x in %s.\n", op->address, func->name);
+        return 0;
+    }
+    height -= pops;
+
+    // push its result
+    if (info->flags & OPB_F_STACK_PUSH) {
+        if (++height > VERIFY_OPSTACK_SIZE) {
+            printf("Error: Operand stack overflow at 0x%x in %s.\n", op->address, func->name);
+            return 0;
+        }
+        if (height > verify->depth)
+            verify->depth = height;
+    }
+
+    // a return pops the return value from an otherwise empty stack
+    if (op->info->id == OP_LEAVE) {
+        if (height) {
+            printf("Error: Operand stack not empty at return 0x%x in %s, %u operands left.\n", op->address, func->name, height);
+            return 0;
+        }
+        return 1;
+    }
+
+    // a jump goes to its constant target only, the indirect jumps share the same height
+    if (op->info->id == OP_JUMP) {
+        if (i && op[-1].info->id == OP_CONST)
+            return verify_branch(verify, i, op[-1].value, height);
+        if (verify->indirect != VERIFY_NONE && verify->indirect != height) {
+            printf("Error: Operand stack height mismatch at indirect jump 0x%x in %s, %u and %u.\n", op->address, func->name, verify->indirect, height);
+            return 0;
+        }
+        verify->indirect = height;
+        return 1;
+    }
+
+    // a compare also goes to its target
+    if (op->info->opblock_id == OPB_COMPARE && !verify_branch(verify, i, op->value, height))
+        return 0;
+
+    // go to the next instruction, the function can't fall out of its end
+    if (i + 1 >= func->op_size) {
+        printf("Error: Function %s falls out of its end at 0x%x.\n", func->name, op->address);
+        return 0;
+    }
+    return verify_merge(verify, i, i + 1, height);
+}
+
+static int verify_branch(qvm_verify_t *verify, unsigned int from, unsigned int address, unsigned int height)
+{
+    qvm_function_t  *func = verify->function;
+
+    // the target must be inside the function
+    if (address < func->address || address >= func->address + func->op_size) {
+        printf("Error: Branch out of function at 0x%x in %s to 0x%x.\n", func->address + from, func->name, address);
+        return 0;
+    }
+
+    // merge the height at the target
+    return verify_merge(verify, from, address - func->address, height);
+}
+
+static int verify_merge(qvm_verify_t *verify, unsigned int from, unsigned int i, unsigned int height)
+{
+    qvm_function_t  *func = verify->function;
+
+    // a new instruction reached gets the height and is followed later
+    if (verify->heights[i] == VERIFY_NONE) {
+        verify->heights[i] = height;
+        verify->worklist[verify->worklist_count++] = i;
+        return 1;
+    }
+
+    // an instruction already reached must have the same height
+    if (verify->heights[i] != height) {
+        printf("Error: Operand stack height mismatch at 0x%x in %s, %u from 0x%x and %u before.\n",
+            func->address + i, func->name, height, func->address + from, verify->heights[i]);
+        return 0;
+    }
+
+    // success
+    return 1;
+}
@@ -0,0 +1,21 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#define VERIFY_NONE         (unsigned int)-1
+#define VERIFY_OPSTACK_SIZE 256
+
+typedef struct qvm_verify_s qvm_verify_t;
+
+typedef struct qvm_verify_s {
+    qvm_function_t  *function;
+    unsigned int    *heights;
+    unsigned int    *worklist;
+    unsigned int    worklist_count;
+    unsigned int    indirect;
+    unsigned int    depth;
+} qvm_verify_t;
+
+int     verify_functions(qvm_t *qvm);
+int     verify_function(qvm_verify_t *verify, qvm_function_t *func);
+
+#endif
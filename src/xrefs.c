@@ -0,0 +1,172 @@
+#include "qvmd.h"
+#include <stdint.h>
+
+void        xref_init(qvm_xref_index_t *index);
+int         xref_add(qvm_xref_index_t *index, qvm_xref_array_t *array, qvm_xref_e kind, unsigned int address, qvm_function_t *function);
+int         xref_add_constant(qvm_xref_index_t *index, unsigned int address, qvm_function_t *function);
+int         xref_freeze(qvm_xref_index_t *index);
+static int  xref_compare_entries(const void *a, const void *b);
+void        xref_free(qvm_xref_index_t *index);
+
+char    *qvm_xrefs_names[XREF_MAX] = {
+    "read",
+    "write",
+    "address",
+    "call"
+};
+
+/*
+    The cross references index records the instructions reading, writing or
+    taking the address of each variable, and calling each function or
+    syscall. Like the calls graph, the references are appended to a flat
+    vector while the variables usage and the calls are found, then frozen:
+    they are sorted by target and by instruction to remove the duplicates,
+    and each target array points to its own range of one contiguous block.
+    The constants that may be a global address are kept aside until all the
+    globals are known, then resolved to the global taking their address.
+*/
+
+void xref_init(qvm_xref_index_t *index)
+{
+    index->entries = NULL;
+    index->entries_count = 0;
+    index->entries_size = 0;
+    index->xrefs = NULL;
+    index->xrefs_count = 0;
+    index->constants = NULL;
+    index->constants_count = 0;
+    index->constants_size = 0;
+    index->frozen = 0;
+}
+
+int xref_add(qvm_xref_index_t *index, qvm_xref_array_t *array, qvm_xref_e kind, unsigned int address, qvm_function_t *function)
+{
+    qvm_xref_entry_t    *entries;
+    unsigned int        size;
+
+    // a frozen index already has all its references, a streamed function finds them again
+    if (index->frozen)
+        return 1;
+
+    // grow the entries vector if needed
+    if (index->entries_count >= index->entries_size) {
+        size = index->entries_size ? index->entries_size * 2 : 1024;
+        if (!(entries = realloc(index->entries, sizeof(*entries) * size))) {
+            printf("Error: Couldn't allocate more cross references.\n");
+            return 0;
+        }
+        index->entries = entries;
+        index->entries_size = size;
+    }
+
+    // append the reference
+    index->entries[index->entries_count].array = array;
+    index->entries[index->entries_count].xref.address = address;
+    index->entries[index->entries_count].xref.kind = kind;
+    index->entries[index->entries_count].xref.function = function;
+    index->entries_count++;
+
+    // success
+    return 1;
+}
+
+int xref_add_constant(qvm_xref_index_t *index, unsigned int address, qvm_function_t *function)
+{
+    qvm_xref_t      *constants;
+    unsigned int    size;
+
+    // a frozen index already has all its references, a streamed function finds them again
+    if (index->frozen)
+        return 1;
+
+    // grow the constants vector if needed
+    if (index->constants_count >= index->constants_size) {
+        size = index->constants_size ? index->constants_size * 2 : 1024;
+        if (!(constants = realloc(index->constants, sizeof(*constants) * size))) {
+            printf("Error: Couldn't allocate more cross references.\n");
+            return 0;
+        }
+        index->constants = constants;
+        index->constants_size = size;
+    }
+
+    // append the constant instruction, its global is resolved before the index is frozen
+    index->constants[index->constants_count].address = address;
+    index->constants[index->constants_count].kind = XREF_ADDRESS;
+    index->constants[index->constants_count].function = function;
+    index->constants_count++;
+
+    // success
+    return 1;
+}
+
+int xref_freeze(qvm_xref_index_t *index)
+{
+    qvm_xref_entry_t    *entry;
+    unsigned int        count = 0;
+
+    // sort the references by target, instruction and kind to find the duplicates
+    qsort(index->entries, index->entries_count, sizeof(*index->entries), xref_compare_entries);
+
+    // keep one reference of each duplicates
+    for (unsigned int i = 0; i < index->entries_count; i++) {
+        entry = &index->entries[i];
+        if (count && !xref_compare_entries(&index->entries[count - 1], entry))
+            continue;
+        index->entries[count++] = *entry;
+    }
+
+    // allocate the references block
+    if (!(index->xrefs = malloc(sizeof(*index->xrefs) * (count + 1)))) {
+        printf("Error: Couldn't allocate cross references.\n");
+        return 0;
+    }
+    index->xrefs_count = count;
+
+    // give each target its range of the references block
+    for (unsigned int i = 0; i < count; i++) {
+        entry = &index->entries[i];
+        if (!i || index->entries[i - 1].array != entry->array) {
+            entry->array->xrefs = &index->xrefs[i];
+            entry->array->count = 0;
+        }
+        index->xrefs[i] = entry->xref;
+        entry->array->count++;
+    }
+
+    // free the entries and the constants vectors, the index can't change anymore
+    free(index->entries);
+    index->entries = NULL;
+    index->entries_count = 0;
+    index->entries_size = 0;
+    free(index->constants);
+    index->constants = NULL;
+    index->constants_count = 0;
+    index->constants_size = 0;
+    index->frozen = 1;
+
+    // success
+    return 1;
+}
+
+static int xref_compare_entries(const void *a, const void *b)
+{
+    const qvm_xref_entry_t  *ea = a;
+    const qvm_xref_entry_t  *eb = b;
+
+    // compare the targets, then the instructions, then the kinds
+    if (ea->array != eb->array)
+        return (uintptr_t)ea->array < (uintptr_t)eb->array ? -1 : 1;
+    if (ea->xref.address != eb->xref.address)
+        return ea->xref.address < eb->xref.address ? -1 : 1;
+    return ea->xref.kind < eb->xref.kind ? -1 : ea->xref.kind > eb->xref.kind;
+}
+
+void xref_free(qvm_xref_index_t *index)
+{
+    // free the entries, the constants and the references block
+    free(index->entries);
+    free(index->constants);
+    free(index->xrefs);
+    xref_init(index);
+}
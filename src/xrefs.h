@@ -0,0 +1,57 @@
+#ifndef XREFS_H
+#define XREFS_H
+
+#define XREF_ADDRESS_MIN    0x100
+
+typedef struct qvm_xref_s           qvm_xref_t;
+typedef struct qvm_xref_array_s     qvm_xref_array_t;
+typedef struct qvm_xref_entry_s     qvm_xref_entry_t;
+typedef struct qvm_xref_index_s     qvm_xref_index_t;
+
+typedef struct qvm_xref_array_s {
+    qvm_xref_t          *xrefs;
+    unsigned int        count;
+} qvm_xref_array_t;
+
+#include "functions.h"
+
+typedef enum {
+    XREF_READ,
+    XREF_WRITE,
+    XREF_ADDRESS,
+    XREF_CALL,
+    XREF_MAX
+} qvm_xref_e;
+
+typedef struct qvm_xref_s {
+    unsigned int        address;
+    qvm_xref_e          kind;
+    qvm_function_t      *function;
+} qvm_xref_t;
+
+typedef struct qvm_xref_entry_s {
+    qvm_xref_array_t    *array;
+    qvm_xref_t          xref;
+} qvm_xref_entry_t;
+
+typedef struct qvm_xref_index_s {
+    qvm_xref_entry_t    *entries;
+    unsigned int        entries_count;
+    unsigned int        entries_size;
+    qvm_xref_t          *xrefs;
+    unsigned int        xrefs_count;
+    qvm_xref_t          *constants;
+    unsigned int        constants_count;
+    unsigned int        constants_size;
+    char                frozen;
+} qvm_xref_index_t;
+
+void    xref_init(qvm_xref_index_t *index);
+int     xref_add(qvm_xref_index_t *index, qvm_xref_array_t *array, qvm_xref_e kind, unsigned int address, qvm_function_t *function);
+int     xref_add_constant(qvm_xref_index_t *index, unsigned int address, qvm_function_t *function);
+int     xref_freeze(qvm_xref_index_t *index);
+void    xref_free(qvm_xref_index_t *index);
+
+extern char *qvm_xrefs_names[XREF_MAX];
+
+#endif